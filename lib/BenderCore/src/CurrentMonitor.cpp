@@ -0,0 +1,54 @@
+#include "CurrentMonitor.h"
+
+CurrentEvent CurrentMonitor::sample(uint32_t timeMs, uint32_t currentMa, bool moving) {
+  fast += ((int32_t)(currentMa << FixedShift) - fast) >> FastShift;
+  if (!moving) {
+    slow = fast;
+    wasMoving = false;
+    overloading = false;
+    stalling = false;
+    reported = false;
+    return CURRENT_NORMAL;
+  }
+  if (!wasMoving) {
+    wasMoving = true;
+    movingSinceMs = timeMs;
+  }
+  uint32_t now = filteredMa();
+  if (now > peak) {
+    peak = now;
+  }
+
+  CurrentEvent event = CURRENT_NORMAL;
+  if (now > limits.overloadMa) {
+    if (!overloading) {
+      overloading = true;
+      overloadSinceMs = timeMs;
+    }
+    if (timeMs - overloadSinceMs >= limits.overloadMs) {
+      event = CURRENT_OVERLOAD;
+    }
+  } else {
+    overloading = false;
+  }
+  if (timeMs - movingSinceMs < limits.settleMs) {
+    slow = fast; // The running average starts from the running current, not the standstill one
+  } else if (fast - slow > (int32_t)(limits.stallRiseMa << FixedShift)) {
+    if (!stalling) {
+      stalling = true;
+      stallSinceMs = timeMs;
+    }
+    if (timeMs - stallSinceMs >= limits.stallMs) {
+      event = CURRENT_STALL;
+    }
+  } else {
+    stalling = false;
+    slow += (fast - slow) >> SlowShift; // Held while a jump is judged, so it cannot catch up
+  }
+
+  if (event == CURRENT_NORMAL || reported) {
+    return CURRENT_NORMAL;
+  }
+  reported = true;
+  return event;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// Motor supply current limits, all in mA and ms.
+struct CurrentLimits {
+  uint32_t overloadMa;  // Smoothed current the supply and drivers must stay under while moving
+  uint32_t overloadMs;  // How long it may be exceeded before it counts as an overload
+  uint32_t stallRiseMa; // Jump above the running average that marks a stall
+  uint32_t stallMs;     // How long the jump must last (longer than a chopper or step transient)
+  uint32_t settleMs;    // Time from the start of motion in which the current rises to its running level
+};
+
+enum CurrentEvent : uint8_t { CURRENT_NORMAL, CURRENT_STALL, CURRENT_OVERLOAD };
+
+// Looks for stall and overload signatures in the motor supply current. Samples are smoothed
+// with a short exponential average against chopper noise and compared with a slow average that
+// follows the current as the speed ramps. A motor that stalls loses its back EMF, so the current
+// jumps above the slow average within a few ms; an overloaded one draws more than the supply is
+// rated for. Only samples taken while the steppers move are judged. For the first settleMs of
+// each motion the slow average follows the current and no stall is judged, so the step from the
+// standstill to the running current is not taken for one. One writer: samples must come from a
+// single task.
+class CurrentMonitor {
+public:
+  explicit CurrentMonitor(const CurrentLimits &limits) : limits(limits) {}
+
+  // Add a sample. An event is reported once, then not again until the motion has stopped.
+  CurrentEvent sample(uint32_t timeMs, uint32_t currentMa, bool moving);
+  uint32_t filteredMa() const { return (uint32_t)fast >> FixedShift; }
+  // Highest smoothed current while moving since the last resetPeak()
+  uint32_t peakMa() const { return peak; }
+  void resetPeak() { peak = 0; }
+
+private:
+  static const int FixedShift = 4; // Averages are kept in 1/16 mA
+  static const int FastShift = 2;  // Short average: 1/4 of each new sample
+  static const int SlowShift = 5;  // Running average: 1/32 of the short one per sample
+
+  CurrentLimits limits;
+  int32_t fast = 0;
+  int32_t slow = 0;
+  uint32_t peak = 0;
+  uint32_t overloadSinceMs = 0;
+  uint32_t stallSinceMs = 0;
+  uint32_t movingSinceMs = 0;
+  bool wasMoving = false;
+  bool overloading = false;
+  bool stalling = false;
+  bool reported = false; // An event was reported during this motion
+};
@@ -0,0 +1,163 @@
+#include "CycleEstimator.h"
+
+#include "Interpreter.h"
+#include "StepTiming.h"
+
+const uint64_t EstimateLimitUs = 3600ULL * 1000000ULL; // Fits the 32-bit per-command times
+const uint64_t PollPeriodUs = 1000; // The motion task runs at least once per millisecond
+
+static bool isMotion(const Instruction &instruction) {
+  return instruction.op == OP_MOVE && (instruction.a != 0 || instruction.b != 0);
+}
+
+static uint64_t nextPollUs(uint64_t timeUs) {
+  return (timeUs / PollPeriodUs + 1) * PollPeriodUs;
+}
+
+// Virtual machine behind the executor. Commands come from the program through an Interpreter;
+// the step engine runs one move and buffers one more, like StepperEngine. Every command that
+// takes time runs until the next one starts: moves start when the engine starts them,
+// stop-and-settle commands when the executor takes them. Setting changes take no time.
+class EstimatorIo : public MachineIo {
+public:
+  EstimatorIo(const Instruction *program, size_t count, uint32_t *commandUs) : commandUs(commandUs) {
+    interpreter.start(program, count);
+  }
+
+  uint32_t nowMs() override { return nowUs / 1000; }
+  bool peekCommand(Instruction &instruction) override { return interpreter.peek(instruction); }
+  bool commandsWaiting() override { return interpreter.active(); }
+  void popCommand() override {
+    Instruction instruction;
+    interpreter.peek(instruction);
+    size_t command = interpreter.position();
+    interpreter.pop();
+    if (isMotion(instruction)) {
+      moves[(moveHead + moveCount++) % MoveSlots] = command; // Started when the engine gets it
+    } else if (needsStopAndSettle(instruction)) {
+      commandStarted(command, nowUs);
+    }
+  }
+  void clearCommands() override { interpreter.reset(); }
+  bool canQueueMotion() override { return !buffered; }
+  void queueMotion(const MotionPlan &plan) override {
+    uint64_t durationUs = planDurationTicks(plan) * 1000000ULL / StepTimerHz;
+    motionUs += durationUs;
+    // Moves reach the engine in program order, so the plan belongs to the oldest taken move
+    size_t command = moves[moveHead];
+    moveHead = (moveHead + 1) % MoveSlots;
+    moveCount--;
+    if (busy) {
+      buffered = true; // Chained when the running move ends
+      bufferedUs = durationUs;
+      bufferedCommand = command;
+    } else {
+      busy = true;
+      runningEndUs = nowUs + durationUs;
+      commandStarted(command, nowUs);
+    }
+  }
+  bool motionBusy() override { return busy; }
+  void stopMotion() override {
+    busy = buffered = false;
+    moveCount = 0;
+  }
+  void writeServo(int32_t) override {}
+
+  // Move the clock forward, starting buffered moves and finishing running ones on the way
+  void advanceTo(uint64_t timeUs) {
+    while (busy && runningEndUs <= timeUs) {
+      if (buffered) {
+        commandStarted(bufferedCommand, runningEndUs);
+        runningEndUs += bufferedUs;
+        buffered = false;
+      } else {
+        busy = false;
+      }
+    }
+    nowUs = timeUs;
+  }
+
+  // When the executor next gets to run because of the engine: the completion interrupt wakes it
+  // at once, while chaining a buffered move only frees the buffer for the next poll.
+  bool nextEngineEventUs(uint64_t &timeUs) const {
+    if (!busy) {
+      return false;
+    }
+    timeUs = buffered ? ((runningEndUs + PollPeriodUs - 1) / PollPeriodUs) * PollPeriodUs : runningEndUs;
+    return true;
+  }
+
+  // The last command started runs until the end; time before the first one counts towards it
+  void finish() { commandStarted(SIZE_MAX, nowUs); }
+
+  uint64_t nowUs = 0;
+  uint64_t motionUs = 0;
+
+private:
+  static const size_t MoveSlots = PlannerSize + 2; // Planner plus the engine's running and buffered move
+
+  void commandStarted(size_t command, uint64_t timeUs) {
+    if (timeUs < currentStartUs) {
+      timeUs = currentStartUs;
+    }
+    if (current != SIZE_MAX) {
+      commandUs[current] += (uint32_t)(timeUs - currentStartUs);
+      currentStartUs = timeUs;
+    }
+    current = command;
+  }
+
+  Interpreter interpreter;
+  uint32_t *commandUs;
+  size_t current = SIZE_MAX;   // Command whose time is running, if any
+  uint64_t currentStartUs = 0;
+  size_t moves[MoveSlots];     // Commands of the moves taken but not yet started, oldest first
+  size_t moveHead = 0;
+  size_t moveCount = 0;
+  bool busy = false;
+  bool buffered = false;
+  uint64_t runningEndUs = 0;
+  uint64_t bufferedUs = 0;
+  size_t bufferedCommand = 0;
+};
+
+bool estimateCycle(const Instruction *program, size_t count, const MachineSettings &settings, const ProgramLimits &limits,
+                   int32_t servoAngle, uint32_t *commandUs, CycleEstimate &estimate) {
+  for (size_t i = 0; i < count; i++) {
+    commandUs[i] = 0; // 32 bits of microseconds cover the time limit
+  }
+  MachineSettings programSettings = settings; // Commands in the program change the copy only
+  EstimatorIo io(program, count, commandUs);
+  Executor executor(io, programSettings, limits);
+  executor.setServoAngle(servoAngle);
+
+  bool finished = false;
+  while (io.nowUs <= EstimateLimitUs) {
+    executor.poll();
+    if (executor.idle()) {
+      finished = true;
+      break;
+    }
+    // Nothing changes between polls unless a wait runs out or the engine moves on, so jump
+    // straight to the next of those
+    uint64_t target = UINT64_MAX;
+    uint32_t deadlineMs;
+    uint64_t engineUs;
+    if (executor.nextDeadlineMs(deadlineMs)) {
+      target = deadlineMs * 1000ULL;
+    }
+    if (io.nextEngineEventUs(engineUs) && engineUs < target) {
+      target = engineUs;
+    }
+    if (target == UINT64_MAX || target <= io.nowUs) {
+      target = nextPollUs(io.nowUs);
+    }
+    io.advanceTo(target);
+  }
+
+  io.finish();
+  estimate.totalUs = io.nowUs;
+  estimate.motionUs = io.motionUs;
+  return finished;
+}
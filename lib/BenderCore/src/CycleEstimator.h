@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Executor.h"
+
+struct CycleEstimate {
+  uint64_t totalUs;  // From the first command until everything has stopped and settled
+  uint64_t motionUs; // Time the steppers spend moving
+};
+
+// Predict how long a compiled program takes without moving anything. The program runs through
+// the same Executor the firmware uses, against a virtual clock and a step engine that takes
+// exactly the time the step generator would, so estimates include ramps, chained moves, servo
+// settle times, D delays and the globalDelayMs sleeps before and after stop-and-settle commands.
+// 'settings' and 'servoAngle' are the state the program starts from; they are not changed.
+// 'commandUs' (count entries) receives the time from each command starting to the next one
+// starting, so the entries add up to the total. Commands inside repeats and subroutines add up
+// all their runs; control flow instructions themselves take no time. Returns false if the program would run longer
+// than an hour.
+bool estimateCycle(const Instruction *program, size_t count, const MachineSettings &settings, const ProgramLimits &limits,
+                   int32_t servoAngle, uint32_t *commandUs, CycleEstimate &estimate);
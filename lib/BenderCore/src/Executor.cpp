@@ -0,0 +1,356 @@
+#include "Executor.h"
+
+#include <stdio.h>
+#include "ServoTiming.h"
+
+void Executor::log(LogLevel level, const char *format, ...) {
+  if (level > LOG_COMPILED_LEVEL) {
+    return; // Removed at compile time; the arguments are still evaluated for their side effects
+  }
+  va_list args;
+  va_start(args, format);
+  io.vlog(level, format, args);
+  va_end(args);
+}
+
+AxisLimits Executor::xAxisLimits() const {
+  return { (uint32_t)settings.xFeedrate, (uint32_t)settings.xAccel, (uint32_t)settings.xJerk, StepperStartRate };
+}
+
+AxisLimits Executor::zAxisLimits() const {
+  return { (uint32_t)settings.zFeedrate, (uint32_t)settings.zAccel, (uint32_t)settings.zJerk, StepperStartRate };
+}
+
+// Queue a move of one or both steppers in the look-ahead planner. Both axes start and finish
+// together, each within its own feedrate and acceleration. The limits in force now are captured
+// with the move, so later F/G/A/B/J/K commands only affect later moves.
+void Executor::queueMove(int32_t xSteps, int32_t zSteps) {
+  if (xSteps == 0 && zSteps == 0) {
+    return; // Zero-length move
+  }
+  int32_t steps[AxisCount] = { xSteps, zSteps };
+  AxisLimits axisLimits[AxisCount] = { xAxisLimits(), zAxisLimits() };
+  if (!planner.push(steps, combineLimits(steps, axisLimits))) {
+    log(LEVEL_WARN, "Motion planner full. Move rejected.\n");
+  }
+}
+
+// Hand planned moves to the step engine as soon as it can buffer the next one. The pulses are
+// generated by the step timer interrupt, which chains buffered moves without stopping.
+void Executor::feedStepEngine() {
+  PlannedMove move;
+  while (io.canQueueMotion() && planner.pop(move)) {
+    planMotion(nextPlan, move.steps, scaleLimits(move.limits, overridePercent), move.entryRate, move.exitRate);
+    nextPlan.id = ++moveId;
+    engineMoves[moveId % 2] = move;
+    io.queueMotion(nextPlan);
+    motionSettlePending = true;
+    log(LEVEL_DEBUG, "Move X%d Z%d started: entry %u, peak %u, exit %u steps/s\n", (int)move.steps[AxisX], (int)move.steps[AxisZ],
+        (unsigned)move.entryRate, (unsigned)nextPlan.peakRate, (unsigned)move.exitRate);
+  }
+}
+
+// Follow a change of the feed override. Moves still in the planner are planned again; the
+// running move is re-planned from the step it is on and the buffered one as a whole. Rates at
+// the junctions already handed to the step engine stay, so the speed changes within each move
+// by an ordinary ramp, under the same acceleration and jerk limits. If the engine moved on in
+// the meantime, the next pass tries again.
+void Executor::applyFeedOverride() {
+  uint32_t percent = io.feedOverride();
+  if (percent == overridePercent) {
+    return;
+  }
+  planner.setRatePercent(percent);
+  MotionProgress progress;
+  if (io.motionProgress(progress)) {
+    const PlannedMove &running = engineMoves[progress.runningId % 2];
+    if (progress.stepsDone < running.leadSteps) {
+      // Only the speed profile of the rest of the move is used, so one axis is enough
+      int32_t rest[AxisCount] = { (int32_t)(running.leadSteps - progress.stepsDone), 0 };
+      uint32_t rate = progress.rate ? progress.rate : running.entryRate;
+      planMotion(nextPlan, rest, scaleLimits(running.limits, percent), rate, running.exitRate);
+      nextPlan.id = progress.runningId;
+      if (!io.retimeMotion(progress.stepsDone, nextPlan)) {
+        return;
+      }
+    }
+    if (progress.buffered) {
+      const PlannedMove &next = engineMoves[progress.bufferedId % 2];
+      planMotion(nextPlan, next.steps, scaleLimits(next.limits, percent), next.entryRate, next.exitRate);
+      nextPlan.id = progress.bufferedId;
+      if (!io.replaceQueuedMotion(nextPlan)) {
+        return;
+      }
+    }
+  }
+  overridePercent = percent;
+  log(LEVEL_INFO, "Feed override %u%%.\n", (unsigned)percent);
+}
+
+// Limits of the move the step engine is running, at the feed override it runs at
+bool Executor::runningLimits(MotionProgress &progress, AxisLimits &moveLimits) {
+  if (!io.motionProgress(progress)) {
+    return false;
+  }
+  moveLimits = scaleLimits(engineMoves[progress.runningId % 2].limits, overridePercent);
+  return true;
+}
+
+// The hold ramp is planned like a move of its own, from the rate the motors run at now down to
+// the start rate, and laid over the moves in the step engine as a speed limit. Moves chained
+// behind the running one are still handed over, so the motors never stop at a junction planned
+// to be taken at speed.
+void Executor::hold() {
+  if (holding) {
+    return;
+  }
+  holding = true;
+  MotionProgress progress;
+  AxisLimits rampLimits;
+  if (runningLimits(progress, rampLimits)) {
+    uint32_t rate = progress.rate > rampLimits.startRate ? progress.rate : rampLimits.startRate;
+    rampLimits.maxRate = rate;
+    int32_t ramp[AxisCount] = { (int32_t)rampSteps(rate, rampLimits.startRate, rampLimits) + 1, 0 };
+    planMotion(nextPlan, ramp, rampLimits, rate, rampLimits.startRate);
+    io.holdMotion(nextPlan);
+  }
+  if (!aborting) {
+    log(LEVEL_INFO, "Feed hold.\n");
+  }
+}
+
+void Executor::resume() {
+  if (!holding || aborting) {
+    return;
+  }
+  holding = false;
+  MotionProgress progress;
+  AxisLimits rampLimits;
+  if (runningLimits(progress, rampLimits)) {
+    uint32_t rate = progress.rate > rampLimits.startRate ? progress.rate : rampLimits.startRate; // 0 while paused
+    int32_t ramp[AxisCount] = { (int32_t)rampSteps(rate, rampLimits.maxRate, rampLimits) + 1, 0 };
+    planMotion(nextPlan, ramp, rampLimits, rate, rampLimits.maxRate);
+    io.resumeMotion(nextPlan);
+  }
+  log(LEVEL_INFO, "Resumed.\n");
+}
+
+void Executor::abort() {
+  if (!motionActive()) {
+    stop();
+    return;
+  }
+  aborting = true; // poll() stops once the motors stand still
+  hold();
+}
+
+// Start the servo towards an angle without waiting; returns the estimated settle time in ms.
+uint32_t Executor::moveServo(int32_t angle) {
+  if (angle >= limits.servoMin && angle <= limits.servoMax) { // Enforce soft limits
+    io.writeServo(angle);
+    ServoTiming timing = { (uint32_t)settings.servoDegPerSecond, ServoSettleMarginMs, (uint32_t)settings.servoStabilizationDelayMs };
+    uint32_t settleMs = servoSettleMs(currentServoAngle, angle, timing);
+    currentServoAngle = angle;
+    log(LEVEL_INFO, "Servo moved to angle: %d (settling for %u ms)\n", (int)angle, (unsigned)settleMs);
+    return settleMs;
+  }
+  log(LEVEL_WARN, "Invalid servo angle: %d. Allowed range is %d to %d.\n", (int)angle, (int)limits.servoMin, (int)limits.servoMax);
+  return 0;
+}
+
+void Executor::stop() {
+  io.stopMotion();
+  planner.clear();
+  io.clearCommands(); // Drop everything still waiting
+  motionSettlePending = false;
+  timing = false;
+  holding = false;
+  aborting = false;
+  nextCommandAtMs = io.nowMs() + settings.globalDelayMs; // Let the machine settle before the next command
+  io.showBusy(false);
+}
+
+// Report the timing of the last stop-and-settle command once both of its waits are over.
+void Executor::finishTiming(uint32_t now) {
+  if (timing && reached(now, nextCommandAtMs) && reached(now, servoSettledAtMs)) {
+    timing = false;
+    io.commandTimed(timedCommand, timedPlannedMs, now - timedStartMs);
+  }
+}
+
+void Executor::execute(const Instruction &instruction) {
+  int value = instruction.a; // Main operand (angle, steps, rate or delay)
+
+  io.showBusy(true); // Indicate processing state
+
+  switch (instruction.op) {
+    case OP_STOP: // CTRL+C (ASCII code 3)
+      log(LEVEL_INFO, "[Step %d] CTRL+C received. Stopping all operations.\n", ++stepCounter);
+      stop();
+      break;
+
+    case OP_SERVO: // Servo control
+      log(LEVEL_INFO, "[Step %d] Servo command received with angle: %d\n", ++stepCounter, value);
+      servoSettledAtMs = io.nowMs() + moveServo(value); // Commands that depend on the servo wait for this
+      break;
+
+    case OP_MOVE: // X, Z or coordinated X/Z stepper motor control
+      if (instruction.b == 0) {
+        log(LEVEL_INFO, "[Step %d] X-axis command received with value: %d\n", ++stepCounter, value);
+      } else if (instruction.a == 0) {
+        log(LEVEL_INFO, "[Step %d] Z-axis command received with value: %d\n", ++stepCounter, (int)instruction.b);
+      } else {
+        log(LEVEL_INFO, "[Step %d] Combined move received with X: %d Z: %d\n", ++stepCounter, value, (int)instruction.b);
+      }
+      queueMove(instruction.a, instruction.b); // Plan the move; both axes share one interpolated segment
+      break;
+
+    case OP_DELAY: // Delay in milliseconds; processNextCommand() holds the next command back
+      log(LEVEL_INFO, "[Step %d] Delay command received with value: %d ms\n", ++stepCounter, value);
+      break;
+
+    case OP_X_FEEDRATE: // Change feedrate for X-axis
+      settings.xFeedrate = value;
+      log(LEVEL_INFO, "Feedrate for X-axis updated to %d steps per second.\n", value);
+      break;
+
+    case OP_Z_FEEDRATE: // Change feedrate for Z-axis
+      settings.zFeedrate = value;
+      log(LEVEL_INFO, "Feedrate for Z-axis updated to %d steps per second.\n", value);
+      break;
+
+    case OP_X_ACCEL: // Change acceleration for X-axis
+      settings.xAccel = value;
+      log(LEVEL_INFO, "Acceleration for X-axis updated to %d steps per second squared.\n", value);
+      break;
+
+    case OP_Z_ACCEL: // Change acceleration for Z-axis
+      settings.zAccel = value;
+      log(LEVEL_INFO, "Acceleration for Z-axis updated to %d steps per second squared.\n", value);
+      break;
+
+    case OP_X_JERK: // Change jerk for X-axis
+      settings.xJerk = value;
+      log(LEVEL_INFO, "Jerk for X-axis updated to %d steps per second cubed (%s profile).\n", value, value ? "S-curve" : "trapezoidal");
+      break;
+
+    case OP_Z_JERK: // Change jerk for Z-axis
+      settings.zJerk = value;
+      log(LEVEL_INFO, "Jerk for Z-axis updated to %d steps per second cubed (%s profile).\n", value, value ? "S-curve" : "trapezoidal");
+      break;
+
+    case OP_SET_X_VALUE: // Set globalXValue
+      log(LEVEL_INFO, "[Step %d] H command received with value: %d\n", ++stepCounter, value);
+      settings.globalXValue = value;
+      log(LEVEL_INFO, "globalXValue updated to: %d\n", (int)settings.globalXValue);
+      break;
+
+    case OP_SET_DELAY: // Set globalDelayMs
+      log(LEVEL_INFO, "[Step %d] C command received with value: %d\n", ++stepCounter, value);
+      settings.globalDelayMs = value;
+      log(LEVEL_INFO, "globalDelayMs updated to: %d ms\n", (int)settings.globalDelayMs);
+      break;
+
+    case OP_SERVO_SPEED: // Set the servo travel speed used for settle times
+      settings.servoDegPerSecond = value;
+      log(LEVEL_INFO, "Servo speed updated to %d degrees per second.\n", value);
+      break;
+
+    default:
+      log(LEVEL_ERROR, "[Step %d] Invalid instruction: %d\n", ++stepCounter, instruction.op);
+      break;
+  }
+
+  if (!motionActive()) {
+    io.showBusy(false); // Indicate ready state unless moves are planned or running
+  }
+}
+
+void Executor::processNextCommand() {
+  uint32_t now = io.nowMs();
+  bool settled = reached(now, nextCommandAtMs); // Stability delay of the last stop has passed
+  bool servoSettled = reached(now, servoSettledAtMs); // Servo has reached its angle
+
+  // Look ahead: pull consecutive moves and setting changes into the planner so compatible
+  // moves are chained at speed instead of stopping between commands. Z rotations and settings
+  // overlap with a servo that is still settling; wire feeds wait for it.
+  Instruction instruction;
+  while (settled && !holding && !planner.full() && io.peekCommand(instruction) && !needsStopAndSettle(instruction) &&
+         (servoSettled || !dependsOnServo(instruction))) {
+    io.popCommand(); // Take the next command from the queue
+    execute(instruction); // Plan the move or apply the setting
+  }
+  if (settled && (!holding || io.motionBusy())) {
+    feedStepEngine(); // During a hold only to chain moves behind the one slowing down
+  }
+
+  if (motionActive()) {
+    return; // Moves still planned or running
+  }
+  if (motionSettlePending) {
+    motionSettlePending = false;
+    nextCommandAtMs = io.nowMs() + settings.globalDelayMs; // Stability delay starts when motion stops
+    log(LEVEL_DEBUG, "Motion stopped. Settling for %d ms\n", (int)settings.globalDelayMs);
+    return;
+  }
+  if (holding || !settled || !io.peekCommand(instruction)) {
+    return;
+  }
+  if (!servoSettled && dependsOnServo(instruction)) {
+    return;
+  }
+
+  // Servo bends, delays and other stop-and-settle commands run with all motion stopped
+  io.popCommand(); // Take the next command from the queue
+  execute(instruction); // Process the command
+  nextCommandAtMs = io.nowMs() + settings.globalDelayMs; // Add delay for stability
+  if (instruction.op == OP_DELAY) {
+    nextCommandAtMs += instruction.a; // The delay is a deadline, not a busy-wait
+  }
+  if (instruction.op != OP_STOP) {
+    timing = true;
+    timedCommand = instruction;
+    timedStartMs = now;
+    uint32_t waitEndMs = (int32_t)(servoSettledAtMs - nextCommandAtMs) > 0 ? servoSettledAtMs : nextCommandAtMs;
+    timedPlannedMs = waitEndMs - now;
+  }
+  log(LEVEL_DEBUG, "COMMAND SENT with delay: %d ms\n", (int)settings.globalDelayMs); // Print command sent message with delay
+}
+
+void Executor::poll() {
+  finishTiming(io.nowMs());
+  if (aborting && (!io.motionBusy() || io.motionPaused())) {
+    stop(); // The abort has come to a standstill
+  }
+  applyFeedOverride();
+  Instruction instruction;
+  bool pending = io.peekCommand(instruction);
+  // Execute queued commands if available; returns immediately while moves run
+  if (pending || motionActive() || motionSettlePending) {
+    processNextCommand();
+    pending = io.peekCommand(instruction);
+  }
+
+  // Indicate the system is ready if no commands are in the queue and nothing is moving
+  if (!pending && !motionActive()) {
+    io.showBusy(false);
+  }
+}
+
+bool Executor::idle() const {
+  uint32_t now = io.nowMs();
+  return !io.commandsWaiting() && !motionActive() && !motionSettlePending &&
+         reached(now, nextCommandAtMs) && reached(now, servoSettledAtMs);
+}
+
+bool Executor::nextDeadlineMs(uint32_t &ms) const {
+  uint32_t now = io.nowMs();
+  bool found = false;
+  for (uint32_t deadline : { nextCommandAtMs, servoSettledAtMs }) {
+    if (!reached(now, deadline) && (!found || (int32_t)(deadline - ms) < 0)) {
+      ms = deadline;
+      found = true;
+    }
+  }
+  return found;
+}
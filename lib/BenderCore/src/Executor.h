@@ -0,0 +1,129 @@
+#pragma once
+
+#include <initializer_list>
+#include <stdarg.h>
+#include <stdint.h>
+#include "LogRing.h"
+#include "MotionProfile.h"
+#include "Planner.h"
+#include "Program.h"
+
+// Speed (steps per second) moves start and stop at without ramping
+const uint32_t StepperStartRate = 200;
+// Servo settle time added to every servo move that changes the angle
+const uint32_t ServoSettleMarginMs = 30;
+
+// Settings the executor works with; the F/G/A/B/J/K/H/C/V commands change them.
+struct MachineSettings {
+  int32_t xFeedrate;          // X feedrate (steps/s)
+  int32_t zFeedrate;          // Z feedrate (steps/s)
+  int32_t xAccel;             // X acceleration (steps/s^2, 0 disables ramping)
+  int32_t zAccel;             // Z acceleration (steps/s^2, 0 disables ramping)
+  int32_t xJerk;              // X jerk (steps/s^3, 0 selects a trapezoidal profile)
+  int32_t zJerk;              // Z jerk (steps/s^3, 0 selects a trapezoidal profile)
+  int32_t globalXValue;       // X steps of LOAD WIRE
+  int32_t globalDelayMs;      // Stability delay before and after stop-and-settle commands
+  int32_t servoStabilizationDelayMs; // Longest servo settle time, used for full swings
+  int32_t servoDegPerSecond;  // Servo travel speed used to estimate settle times
+};
+
+// Everything the executor needs from the machine. The firmware implements it with the real
+// command channels, step engine and servo; the cycle time estimator with a virtual clock.
+class MachineIo {
+public:
+  virtual uint32_t nowMs() = 0;
+  // Oldest waiting command, if any, and removing it. peekCommand() may advance the command
+  // source (start a program, leave a finished block); commandsWaiting() only looks.
+  virtual bool peekCommand(Instruction &instruction) = 0;
+  virtual bool commandsWaiting() = 0;
+  virtual void popCommand() = 0;
+  virtual void clearCommands() = 0;
+  // Step engine: one move running and one buffered behind it
+  virtual bool canQueueMotion() = 0;
+  virtual void queueMotion(const MotionPlan &plan) = 0;
+  virtual bool motionBusy() = 0;
+  virtual void stopMotion() = 0;
+  // Feed override: the percentage of the programmed feedrates to run at, what the step engine is
+  // running, and re-planned versions of the moves it holds. A move that has finished or started
+  // in the meantime is not touched (false).
+  virtual uint32_t feedOverride() { return 100; }
+  virtual bool motionProgress(MotionProgress &) { return false; }
+  virtual bool retimeMotion(uint32_t, const MotionPlan &) { return false; }
+  virtual bool replaceQueuedMotion(const MotionPlan &) { return false; }
+  // Feed hold: slow the moves in the step engine down along the decel ramp of 'ramp' and pause
+  // between two steps, keeping them loaded; resume them from that step along its accel ramp.
+  // False when there is nothing to hold or resume.
+  virtual bool holdMotion(const MotionPlan &) { return false; }
+  virtual bool resumeMotion(const MotionPlan &) { return false; }
+  virtual bool motionPaused() { return false; }
+  virtual void writeServo(int32_t angle) = 0;
+  virtual void showBusy(bool) {}
+  virtual void vlog(LogLevel, const char *, va_list) {}
+  // A servo bend or delay has finished its wait: 'plannedMs' is the wait the executor scheduled
+  // when it took the command, 'actualMs' the time until it found the wait over. Metrics only.
+  virtual void commandTimed(const Instruction &, uint32_t /*plannedMs*/, uint32_t /*actualMs*/) {}
+};
+
+// Runs compiled commands. Moves and setting changes are pulled ahead into the look-ahead
+// planner and handed to the step engine as it frees up; servo bends, delays and stops wait for
+// motion to stop and settle. poll() never blocks: every wait is a deadline it checks again on
+// the next call.
+class Executor {
+public:
+  Executor(MachineIo &io, MachineSettings &settings, const ProgramLimits &limits) : io(io), settings(settings), limits(limits) {}
+
+  void poll();
+  // Drop all motion and waiting commands at once, even in the middle of a move.
+  void stop();
+  // Feed hold: decelerate the moves in flight to a pause and take no new commands until
+  // resume(), which continues from the exact step the motors stopped on.
+  void hold();
+  void resume();
+  // Decelerate to a standstill, then stop(): no steps are lost, so positions stay exact.
+  void abort();
+  bool held() const { return holding; }
+
+  // Moves still planned or running
+  bool motionActive() const { return !planner.empty() || io.motionBusy(); }
+  // Nothing queued, moving or settling any more
+  bool idle() const;
+  // Earliest future time a wait ends, if poll() is waiting for one
+  bool nextDeadlineMs(uint32_t &ms) const;
+
+  int32_t servoAngle() const { return currentServoAngle; }
+  void setServoAngle(int32_t angle) { currentServoAngle = angle; }
+  AxisLimits xAxisLimits() const;
+  AxisLimits zAxisLimits() const;
+
+private:
+  void processNextCommand();
+  void execute(const Instruction &instruction);
+  void queueMove(int32_t xSteps, int32_t zSteps);
+  void feedStepEngine();
+  void applyFeedOverride();
+  bool runningLimits(MotionProgress &progress, AxisLimits &limits);
+  uint32_t moveServo(int32_t angle);
+  void finishTiming(uint32_t now);
+  void log(LogLevel level, const char *format, ...) __attribute__((format(printf, 3, 4)));
+  static bool reached(uint32_t now, uint32_t deadline) { return (int32_t)(now - deadline) >= 0; }
+
+  MachineIo &io;
+  MachineSettings &settings;
+  ProgramLimits limits;
+  MotionPlanner planner;     // Look-ahead buffer of moves waiting for the step engine
+  MotionPlan nextPlan;       // Ramp tables of the next move handed to the step engine
+  PlannedMove engineMoves[2]; // The last two moves handed to the step engine, by id % 2
+  uint32_t moveId = 0;        // Id of the last move handed to the step engine
+  uint32_t overridePercent = 100; // Feed override the moves in the step engine are planned for
+  uint32_t nextCommandAtMs = 0;   // Time before which the next queued command must not start
+  uint32_t servoSettledAtMs = 0;  // Time the servo is expected to have settled
+  bool motionSettlePending = false; // Moves ran since the last stop: settle before the next servo/delay command
+  int32_t currentServoAngle = 0;  // Last commanded servo angle
+  int stepCounter = 0;            // Counter to track the step in the program
+  bool timing = false;            // A stop-and-settle command is waiting; reported by finishTiming()
+  bool holding = false;           // Feed hold: no new commands start
+  bool aborting = false;          // Stop once the hold has brought the motors to a standstill
+  Instruction timedCommand;
+  uint32_t timedStartMs = 0;
+  uint32_t timedPlannedMs = 0;
+};
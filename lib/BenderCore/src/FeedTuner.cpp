@@ -0,0 +1,61 @@
+#include "FeedTuner.h"
+
+void FeedTuner::begin(uint32_t feedrate, uint32_t accel, const TuneLimits &tuneLimits) {
+  limits = tuneLimits;
+  phase_ = TUNE_FEEDRATE;
+  trialFeedrate = feedrate;
+  trialAccel = accel;
+  trialCount = 0;
+  anyPassed = false;
+}
+
+// Next value to try, false when 'value' is already at the limit
+bool FeedTuner::raise(uint32_t &value, uint32_t max) const {
+  if (value >= max) {
+    return false;
+  }
+  uint32_t next = (uint64_t)value * (100 + limits.stepPercent) / 100;
+  next = next > value ? next : value + 1;
+  value = next < max ? next : max;
+  return true;
+}
+
+// Continue from the best values with the acceleration, or finish. An acceleration of 0 turns
+// ramping off and is left alone.
+void FeedTuner::nextPhase() {
+  trialFeedrate = safeFeedrate;
+  trialAccel = safeAccel;
+  if (phase_ == TUNE_FEEDRATE && trialAccel > 0 && raise(trialAccel, limits.maxAccel)) {
+    phase_ = TUNE_ACCEL;
+  } else {
+    phase_ = TUNE_DONE;
+  }
+}
+
+void FeedTuner::report(uint32_t peakMa, uint32_t peakRate, bool tripped) {
+  if (!active()) {
+    return;
+  }
+  trialCount++;
+  bool pass = !tripped && peakMa + limits.marginMa <= limits.overloadMa;
+  if (!pass) {
+    if (anyPassed) {
+      nextPhase();
+    } else {
+      phase_ = TUNE_DONE; // Already the starting values run out of margin
+    }
+    return;
+  }
+  bool reached = peakRate >= trialFeedrate - (uint64_t)trialFeedrate * limits.stepPercent / 200; // Within half a step
+  if (phase_ == TUNE_FEEDRATE && anyPassed && !reached) {
+    nextPhase(); // A higher feedrate was not tested by the program, so it is not taken
+    return;
+  }
+  anyPassed = true;
+  safeFeedrate = trialFeedrate;
+  safeAccel = trialAccel;
+  bool raised = phase_ == TUNE_FEEDRATE ? raise(trialFeedrate, limits.maxFeedrate) : raise(trialAccel, limits.maxAccel);
+  if (!raised) {
+    nextPhase();
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+// Search range of a tuning run.
+struct TuneLimits {
+  uint32_t maxFeedrate;  // Highest feedrate tried (steps/s)
+  uint32_t maxAccel;     // Highest acceleration tried (steps/s^2)
+  uint32_t stepPercent;  // Each trial runs this much faster than the last one that passed
+  uint32_t overloadMa;   // Supply current limit of the current monitor
+  uint32_t marginMa;     // Headroom a trial must keep below overloadMa to pass
+};
+
+enum TunePhase : uint8_t { TUNE_IDLE, TUNE_FEEDRATE, TUNE_ACCEL, TUNE_DONE };
+
+// Finds the fastest feedrate and acceleration of one axis that keep a current margin. The
+// caller runs a trial program with feedrate() and accel() and reports its peak supply current.
+// The feedrate is raised by stepPercent per trial until a trial stalls, overloads or leaves less
+// than marginMa of headroom, or the program no longer gets up to the feedrate (its moves are too
+// short), then the acceleration the same way at the best feedrate. The values of the last trial
+// that passed are the result.
+class FeedTuner {
+public:
+  void begin(uint32_t feedrate, uint32_t accel, const TuneLimits &limits);
+  // Result of the trial run with feedrate() and accel(): its peak current and lead axis rate
+  // while moving, and whether the current monitor stopped it.
+  void report(uint32_t peakMa, uint32_t peakRate, bool tripped);
+  void cancel() { phase_ = TUNE_IDLE; }
+
+  TunePhase phase() const { return phase_; }
+  bool active() const { return phase_ == TUNE_FEEDRATE || phase_ == TUNE_ACCEL; }
+  uint32_t feedrate() const { return trialFeedrate; }
+  uint32_t accel() const { return trialAccel; }
+  uint32_t trials() const { return trialCount; }
+  // Fastest values that passed; only valid with passed()
+  bool passed() const { return anyPassed; }
+  uint32_t bestFeedrate() const { return safeFeedrate; }
+  uint32_t bestAccel() const { return safeAccel; }
+
+private:
+  bool raise(uint32_t &value, uint32_t max) const;
+  void nextPhase();
+
+  TuneLimits limits = {};
+  TunePhase phase_ = TUNE_IDLE;
+  uint32_t trialFeedrate = 0;
+  uint32_t trialAccel = 0;
+  uint32_t trialCount = 0;
+  bool anyPassed = false;
+  uint32_t safeFeedrate = 0;
+  uint32_t safeAccel = 0;
+};
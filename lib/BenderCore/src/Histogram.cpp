@@ -0,0 +1,26 @@
+#include "Histogram.h"
+
+#include <stdio.h>
+
+uint32_t Histogram::percentile(uint32_t permille) const {
+  uint32_t total = count;
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t wanted = ((uint64_t)total * permille + 999) / 1000;
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < HistogramBuckets; bucket++) {
+    seen += buckets[bucket];
+    if (seen >= wanted) {
+      uint32_t bound = bucket == 0 ? 0 : bucket >= 32 ? UINT32_MAX : (uint32_t)((1ULL << bucket) - 1);
+      return bound < max ? bound : max;
+    }
+  }
+  return max;
+}
+
+void formatHistogram(const char *name, const Histogram &histogram, char *buffer, size_t size) {
+  snprintf(buffer, size, "%s count=%u sum=%llu min=%u p50=%u p90=%u p99=%u max=%u\n", name, (unsigned)histogram.count,
+           (unsigned long long)histogram.sum, (unsigned)histogram.min, (unsigned)histogram.percentile(500),
+           (unsigned)histogram.percentile(900), (unsigned)histogram.percentile(990), (unsigned)histogram.max);
+}
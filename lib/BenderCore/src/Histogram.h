@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "StepTiming.h"
+
+// Bucket 0 counts zeros, bucket n values in [2^(n-1), 2^n); the last one everything above.
+const int HistogramBuckets = 26;
+
+// Fixed-size histogram with power-of-two buckets. Recording is a handful of instructions with
+// no division, locking or allocation, so it may run in the step interrupt. There must be one
+// writer per histogram; readers in other tasks get a snapshot that may be a sample behind.
+struct Histogram {
+  STEP_ISR_ATTR void record(uint32_t value) {
+    int bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+    buckets[bucket < HistogramBuckets ? bucket : HistogramBuckets - 1]++;
+    if (count == 0 || value < min) {
+      min = value;
+    }
+    if (value > max) {
+      max = value;
+    }
+    sum += value;
+    count++;
+  }
+  // Upper bound of the bucket holding the given fraction (per mille) of the values, at most max
+  uint32_t percentile(uint32_t permille) const;
+
+  volatile uint32_t count = 0;
+  volatile uint64_t sum = 0;
+  volatile uint32_t min = 0;
+  volatile uint32_t max = 0;
+  volatile uint32_t buckets[HistogramBuckets] = {};
+};
+
+// One text line: "<name> count=12 sum=101234 min=812 p50=1023 p90=4095 p99=8191 max=7801".
+// Percentiles are bucket bounds, so they are exact only to a factor of two.
+void formatHistogram(const char *name, const Histogram &histogram, char *buffer, size_t size);
@@ -0,0 +1,57 @@
+#include "Interpreter.h"
+
+void Interpreter::start(const Instruction *image, size_t length) {
+  program = image;
+  count = length;
+  pc = 0;
+  depth = 0;
+}
+
+bool Interpreter::peek(Instruction &instruction) {
+  // The compiler rejects empty blocks, so every pass through a block reaches a plain command
+  // and this loop is bounded by the image size times the nesting depth
+  while (program && pc < count) {
+    const Instruction &current = program[pc];
+    switch (current.op) {
+      case OP_REPEAT:
+        if (depth == CallStackDepth) {
+          reset(); // Cannot happen with a compiled image: the compiler checks the depth
+          return false;
+        }
+        stack[depth++] = { pc + 1, current.a };
+        pc++;
+        break;
+      case OP_END_REPEAT:
+        if (depth > 0 && --stack[depth - 1].remaining > 0) {
+          pc = stack[depth - 1].resumePc;
+        } else {
+          depth = depth > 0 ? depth - 1 : 0;
+          pc++;
+        }
+        break;
+      case OP_CALL:
+        if (depth == CallStackDepth) {
+          reset();
+          return false;
+        }
+        stack[depth++] = { pc + 1, -1 };
+        pc = current.a;
+        break;
+      case OP_RETURN:
+        if (depth == 0) {
+          reset();
+          return false;
+        }
+        pc = stack[--depth].resumePc;
+        break;
+      case OP_SUBROUTINE:
+        pc = current.a; // Definitions run only when called
+        break;
+      default:
+        instruction = current;
+        return true;
+    }
+  }
+  program = nullptr; // Finished
+  return false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Program.h"
+
+// Runs a compiled program image that contains repeats and subroutine calls. It hands out the
+// plain commands one by one, following the control flow instructions in between with a
+// fixed-depth stack, so a repeated block is never expanded in memory. The image must stay
+// unchanged until the program has finished or reset() was called.
+class Interpreter {
+public:
+  void start(const Instruction *program, size_t count);
+  void reset() { program = nullptr; }
+  bool active() const { return program != nullptr; }
+
+  // Next plain command, without taking it; false once the program has ended
+  bool peek(Instruction &instruction);
+  void pop() { pc++; }
+  // Index in the image of the command peek() returned
+  size_t position() const { return pc; }
+
+private:
+  struct Frame {
+    size_t resumePc;   // Body start of a repeat, return address of a call
+    int32_t remaining; // Repeats left; -1 for a call
+  };
+
+  const Instruction *program = nullptr;
+  size_t count = 0;
+  size_t pc = 0;
+  Frame stack[CallStackDepth];
+  int depth = 0;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Log levels, most severe first. Messages above LOG_COMPILED_LEVEL (a build flag) are removed at
+// compile time; a runtime level can only lower it further.
+enum LogLevel : uint8_t { LEVEL_NONE = 0, LEVEL_ERROR, LEVEL_WARN, LEVEL_INFO, LEVEL_DEBUG };
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LEVEL_DEBUG
+#endif
+
+// Bounded lock-free multi-producer/single-consumer ring of formatted log lines. Any task may
+// write; a full ring drops the line and counts it instead of waiting, so logging never holds up
+// the writer. Every slot carries a sequence number: a producer claims the slot at 'head' with a
+// compare-and-swap, formats straight into it and publishes it with a release store of the
+// sequence; the consumer frees it the same way for the producer one lap later.
+template <size_t Slots, size_t LineSize>
+class LogRing {
+public:
+  LogRing() {
+    for (size_t i = 0; i < Slots; i++) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Producer: format one line. Returns false if the ring was full and the line was dropped.
+  bool vwrite(const char *format, va_list args) {
+    size_t position = head.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+      slot = &slots[position % Slots];
+      intptr_t lap = (intptr_t)slot->sequence.load(std::memory_order_acquire) - (intptr_t)position;
+      if (lap == 0) {
+        if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          break; // Slot claimed
+        }
+      } else if (lap < 0) {
+        dropCount.fetch_add(1, std::memory_order_relaxed); // Consumer is a full lap behind
+        return false;
+      } else {
+        position = head.load(std::memory_order_relaxed); // Another producer took it
+      }
+    }
+    vsnprintf(slot->text, LineSize, format, args);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: oldest published line, valid until pop(); nullptr when there is none.
+  const char *front() const {
+    const Slot &slot = slots[tail % Slots];
+    return slot.sequence.load(std::memory_order_acquire) == tail + 1 ? slot.text : nullptr;
+  }
+  void pop() {
+    slots[tail % Slots].sequence.store(tail + Slots, std::memory_order_release);
+    tail++;
+  }
+
+  // Lines dropped because the ring was full, since boot
+  uint32_t dropped() const { return dropCount.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    char text[LineSize];
+  };
+
+  Slot slots[Slots];
+  std::atomic<size_t> head{0}; // Next slot a producer claims
+  size_t tail = 0;             // Next slot the consumer reads
+  std::atomic<uint32_t> dropCount{0};
+};
@@ -0,0 +1,184 @@
+#include "MotionProfile.h"
+
+#include <math.h>
+#include "StepGenerator.h"
+#include "StepTiming.h"
+
+// Ramp distance and velocities are computed once per move (in task context), never per step.
+
+static uint32_t rampDistance(float lo, float hi, const AxisLimits &limits) {
+  if (limits.accel == 0 || hi <= lo) {
+    return 0;
+  }
+  float distance;
+  if (limits.jerk == 0) {
+    distance = (hi * hi - lo * lo) / (2.0f * limits.accel); // Constant acceleration
+  } else {
+    // 3t^2 - 2t^3 velocity ramp: peak acceleration is 1.5 dv/T, peak jerk 6 dv/T^2
+    float dv = hi - lo;
+    float byAccel = 1.5f * dv / limits.accel;
+    float byJerk = sqrtf(6.0f * dv / limits.jerk);
+    float duration = byAccel > byJerk ? byAccel : byJerk;
+    distance = duration * (lo + dv / 2.0f);
+  }
+  return (uint32_t)ceilf(distance);
+}
+
+// Velocity at table point k (0..RampPoints) of a ramp from lo up to hi.
+static float rampVelocity(float lo, float hi, int k, const AxisLimits &limits) {
+  if (limits.jerk == 0) {
+    float f = (float)k / RampPoints;
+    return sqrtf(lo * lo + f * (hi * hi - lo * lo));
+  }
+  return lo + (hi - lo) * SCurveShape.v[k] / 65535.0f;
+}
+
+// Velocity at table point k of a ramp from 'from' (k = 0) to 'to' (k = RampPoints). A ramp
+// down is a ramp up run backwards.
+static float rampPoint(float from, float to, int k, const AxisLimits &limits) {
+  return from <= to ? rampVelocity(from, to, k, limits) : rampVelocity(to, from, RampPoints - k, limits);
+}
+
+uint32_t rampSteps(uint32_t fromRate, uint32_t toRate, const AxisLimits &limits) {
+  return fromRate < toRate ? rampDistance(fromRate, toRate, limits) : rampDistance(toRate, fromRate, limits);
+}
+
+// Scale a per-axis limit up to the lead axis: lead = value * leadSteps / axisSteps
+static uint32_t scaleToLead(uint32_t value, uint32_t leadSteps, uint32_t axisSteps) {
+  uint64_t scaled = (uint64_t)value * leadSteps / axisSteps;
+  return scaled > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)scaled;
+}
+
+// Tightest of two limits where 0 means "unlimited" (no ramp, or no jerk limit)
+static uint32_t tighterLimit(uint32_t a, uint32_t b) {
+  if (a == 0) {
+    return b;
+  }
+  if (b == 0) {
+    return a;
+  }
+  return a < b ? a : b;
+}
+
+AxisLimits combineLimits(const int32_t steps[AxisCount], const AxisLimits limits[AxisCount]) {
+  uint32_t lead = 0;
+  for (int axis = 0; axis < AxisCount; axis++) {
+    uint32_t count = steps[axis] < 0 ? -steps[axis] : steps[axis];
+    if (count > lead) {
+      lead = count;
+    }
+  }
+
+  AxisLimits combined = { 0xFFFFFFFFUL, 0, 0, 0xFFFFFFFFUL };
+  for (int axis = 0; axis < AxisCount; axis++) {
+    uint32_t count = steps[axis] < 0 ? -steps[axis] : steps[axis];
+    if (count == 0) {
+      continue;
+    }
+    uint32_t maxRate = scaleToLead(limits[axis].maxRate, lead, count);
+    uint32_t startRate = scaleToLead(limits[axis].startRate, lead, count);
+    combined.maxRate = maxRate < combined.maxRate ? maxRate : combined.maxRate;
+    combined.startRate = startRate < combined.startRate ? startRate : combined.startRate;
+    combined.accel = tighterLimit(combined.accel, limits[axis].accel ? scaleToLead(limits[axis].accel, lead, count) : 0);
+    combined.jerk = tighterLimit(combined.jerk, limits[axis].jerk ? scaleToLead(limits[axis].jerk, lead, count) : 0);
+  }
+  if (lead == 0) {
+    combined = limits[0]; // Empty move: any limits will do
+  }
+  return combined;
+}
+
+void planMotion(MotionPlan &plan, const int32_t steps[AxisCount], const AxisLimits &limits, uint32_t entryRate, uint32_t exitRate) {
+  uint32_t count = 0;
+  for (int axis = 0; axis < AxisCount; axis++) {
+    plan.axisSteps[axis] = steps[axis];
+    uint32_t axisCount = steps[axis] < 0 ? -steps[axis] : steps[axis];
+    if (axisCount > count) {
+      count = axisCount;
+    }
+  }
+  uint32_t cruise = limits.maxRate > 0 ? limits.maxRate : 1;
+  uint32_t floor = limits.startRate > 0 ? limits.startRate : 1;
+  if (floor > cruise) {
+    floor = cruise;
+  }
+  uint32_t entry = entryRate < floor ? floor : entryRate;
+  uint32_t exit = exitRate < floor ? floor : exitRate;
+
+  plan.steps = count;
+  plan.accelSteps = 0;
+  plan.decelSteps = 0;
+  plan.accelIndexStep = 0;
+  plan.decelIndexStep = 0;
+
+  if (limits.accel == 0 || count == 0) {
+    // No ramping: constant rate like the original moveStepper()
+    plan.peakRate = cruise;
+    plan.cruiseHalfPeriod = halfPeriodTicks(cruise);
+    return;
+  }
+
+  uint32_t accelSteps = rampSteps(entry, cruise, limits);
+  uint32_t decelSteps = rampSteps(cruise, exit, limits);
+  if (accelSteps + decelSteps > count) {
+    // Too short to reach the cruise rate: find the highest peak that fits
+    uint32_t lo = entry > exit ? entry : exit;
+    uint32_t hi = cruise;
+    if (hi <= lo) {
+      cruise = lo; // No room to slow down to the cruise rate and back: go straight from entry to exit
+    } else if (limits.jerk == 0) {
+      float peak = sqrtf((2.0f * limits.accel * count + (float)entry * entry + (float)exit * exit) / 2.0f);
+      cruise = (uint32_t)peak;
+    } else {
+      while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (rampSteps(entry, mid, limits) + rampSteps(mid, exit, limits) <= count) {
+          lo = mid;
+        } else {
+          hi = mid;
+        }
+      }
+      cruise = lo;
+    }
+    if (cruise < (entry > exit ? entry : exit)) {
+      cruise = entry > exit ? entry : exit;
+    }
+    accelSteps = rampSteps(entry, cruise, limits);
+    decelSteps = rampSteps(cruise, exit, limits);
+    if (accelSteps + decelSteps > count) {
+      // Rounding (or an infeasible entry/exit pair): share the steps proportionally
+      uint32_t total = accelSteps + decelSteps;
+      accelSteps = (uint32_t)((uint64_t)accelSteps * count / total);
+      decelSteps = count - accelSteps;
+    }
+  }
+
+  plan.peakRate = cruise;
+  plan.cruiseHalfPeriod = halfPeriodTicks(cruise);
+  plan.accelSteps = accelSteps;
+  plan.decelSteps = decelSteps;
+  plan.accelIndexStep = accelSteps ? ((uint32_t)RampPoints << 16) / accelSteps : 0;
+  plan.decelIndexStep = decelSteps ? ((uint32_t)RampPoints << 16) / decelSteps : 0;
+  for (int k = 0; k <= RampPoints; k++) {
+    plan.accelTable[k] = halfPeriodTicks((uint32_t)rampPoint(entry, cruise, k, limits));
+    plan.decelTable[k] = halfPeriodTicks((uint32_t)rampPoint(cruise, exit, k, limits));
+  }
+}
+
+void planMotion(MotionPlan &plan, const int32_t steps[AxisCount], const AxisLimits &limits) {
+  uint32_t rate = limits.startRate < limits.maxRate ? limits.startRate : limits.maxRate;
+  planMotion(plan, steps, limits, rate, rate);
+}
+
+uint64_t planDurationTicks(const MotionPlan &plan) {
+  // Replay the generator so the estimate uses exactly the intervals the interrupt will emit
+  StepGenerator generator;
+  generator.begin(plan);
+  uint64_t ticks = generator.busy() ? DirSetupTicks : 0;
+  uint8_t pulseMask = 0;
+  uint32_t next;
+  while ((next = generator.onAlarm(pulseMask)) != 0) {
+    ticks += next;
+  }
+  return ticks;
+}
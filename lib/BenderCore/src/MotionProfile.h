@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+
+// Number of intervals in a ramp table. Each table holds RampPoints + 1 half-periods sampled
+// evenly over the ramp distance; the step generator interpolates between them.
+const int RampPoints = 64;
+
+// Stepper axes driven by the engine
+const int AxisX = 0;
+const int AxisZ = 1;
+const int AxisCount = 2;
+
+// Per-axis motion limits, all in steps.
+struct AxisLimits {
+  uint32_t maxRate;   // Cruise feedrate (steps/s)
+  uint32_t accel;     // Max acceleration (steps/s^2), 0 disables ramping
+  uint32_t jerk;      // Max jerk (steps/s^3), 0 gives a trapezoidal profile
+  uint32_t startRate; // Speed the motor can start and stop at without ramping (steps/s)
+};
+
+// Normalised velocity (0..65535) against normalised ramp distance for a jerk-limited ramp whose
+// velocity follows 3t^2 - 2t^3 in time. Generated at compile time.
+struct RampShape {
+  uint16_t v[RampPoints + 1];
+};
+
+constexpr RampShape makeSCurveShape() {
+  RampShape shape{};
+  for (int k = 0; k <= RampPoints; k++) {
+    // Distance covered by time t is 2t^3 - t^4 of the ramp; invert it by bisection
+    double f = double(k) / RampPoints;
+    double lo = 0.0, hi = 1.0;
+    for (int i = 0; i < 40; i++) {
+      double mid = (lo + hi) / 2;
+      double s = 2 * mid * mid * mid - mid * mid * mid * mid;
+      if (s < f) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    double t = (lo + hi) / 2;
+    shape.v[k] = uint16_t((3 * t * t - 2 * t * t * t) * 65535.0 + 0.5);
+  }
+  return shape;
+}
+
+constexpr RampShape SCurveShape = makeSCurveShape();
+
+// A planned straight move of one or more axes. Rates and ramps refer to the lead axis (the one
+// with the most steps); the other axes follow it by Bresenham interpolation. The step generator
+// walks the accel table, cruises, then walks the decel table. Tables hold half-periods in step
+// timer ticks so the interrupt only interpolates.
+struct MotionPlan {
+  uint32_t id;                // Set by the executor; names the move when it is re-timed
+  int32_t axisSteps[AxisCount]; // Signed step count per axis
+  uint32_t steps;             // Lead axis step count
+  uint32_t accelSteps;        // Steps spent accelerating from the entry rate
+  uint32_t decelSteps;        // Steps spent decelerating to the exit rate
+  uint32_t accelIndexStep;    // Table index increment per step, 16.16 fixed point
+  uint32_t decelIndexStep;
+  uint32_t cruiseHalfPeriod;  // Half-period at the (possibly reduced) cruise rate
+  uint32_t peakRate;          // Cruise rate actually reached (steps/s)
+  uint32_t accelTable[RampPoints + 1];
+  uint32_t decelTable[RampPoints + 1];
+};
+
+// What the step engine is running, so moves in flight can be re-planned (feed override).
+struct MotionProgress {
+  uint32_t runningId;  // MotionPlan::id of the running move
+  uint32_t stepsDone;  // Lead axis steps it has taken
+  uint32_t rate;       // Its lead axis rate now (steps/s), 0 before the first step
+  bool buffered;       // A move is buffered behind it
+  uint32_t bufferedId;
+};
+
+// Distance in steps needed to change speed between two rates under the given limits.
+uint32_t rampSteps(uint32_t fromRate, uint32_t toRate, const AxisLimits &limits);
+
+// Lead axis limits for a coordinated move: every axis stays within its own limits while it
+// follows the lead axis at a fixed step ratio.
+AxisLimits combineLimits(const int32_t steps[AxisCount], const AxisLimits limits[AxisCount]);
+
+// Plan a move that starts at entryRate, ends at exitRate and cruises at limits.maxRate (lead axis
+// rates). The cruise rate is lowered when the move is too short to reach it. An entry or exit
+// rate above limits.maxRate (a move slowed down by the feed override) is ramped down to it.
+void planMotion(MotionPlan &plan, const int32_t steps[AxisCount], const AxisLimits &limits, uint32_t entryRate, uint32_t exitRate);
+
+// Plan a move that starts and stops at the start rate.
+void planMotion(MotionPlan &plan, const int32_t steps[AxisCount], const AxisLimits &limits);
+
+// Total time of the planned move in step timer ticks.
+uint64_t planDurationTicks(const MotionPlan &plan);
@@ -0,0 +1,158 @@
+#include "Optimizer.h"
+
+#include <stdio.h>
+
+static bool isSetting(uint8_t op) {
+  return op >= OP_X_FEEDRATE && op <= OP_SERVO_SPEED;
+}
+
+static bool isControlFlow(uint8_t op) {
+  return op >= OP_REPEAT || op == OP_STOP;
+}
+
+static bool isZeroMove(const Instruction &instruction) {
+  return instruction.op == OP_MOVE && instruction.a == 0 && instruction.b == 0;
+}
+
+// Same single axis, same direction, and the sum still fits
+static bool canMergeMoves(const Instruction &first, const Instruction &second) {
+  if (first.op != OP_MOVE || second.op != OP_MOVE) {
+    return false;
+  }
+  bool xOnly = first.b == 0 && second.b == 0;
+  bool zOnly = first.a == 0 && second.a == 0;
+  int64_t a = xOnly ? first.a : first.b;
+  int64_t b = xOnly ? second.a : second.b;
+  return (xOnly || zOnly) && ((a > 0 && b > 0) || (a < 0 && b < 0)) && a + b >= INT32_MIN && a + b <= INT32_MAX;
+}
+
+static void note(OptimizerLog log, const char *format, const Instruction &instruction, size_t index, const char *detail = "") {
+  if (!log) {
+    return;
+  }
+  char command[32];
+  char line[128];
+  formatInstruction(instruction, command, sizeof(command));
+  snprintf(line, sizeof(line), format, command, (int)index + 1, detail);
+  log(line);
+}
+
+// Index an instruction ends up at once the removed (OP_NONE) entries before it are gone
+static size_t compactedIndex(const Instruction *program, size_t index) {
+  size_t removed = 0;
+  for (size_t i = 0; i < index; i++) {
+    removed += program[i].op == OP_NONE;
+  }
+  return index - removed;
+}
+
+size_t optimizeProgram(Instruction *program, size_t count, OptimizerLog log) {
+  const int SettingCount = OP_SERVO_SPEED - OP_X_FEEDRATE + 1;
+  size_t segmentStart = 0;
+
+  // Straight-line runs between control flow instructions are optimized one at a time
+  while (segmentStart < count) {
+    size_t segmentEnd = segmentStart;
+    while (segmentEnd < count && !isControlFlow(program[segmentEnd].op)) {
+      segmentEnd++;
+    }
+
+    bool known[SettingCount] = {};
+    int32_t value[SettingCount];
+    size_t lastWrite[SettingCount];    // Setting written since the last non-setting command
+    bool pendingWrite[SettingCount] = {};
+    bool servoKnown = false;
+    int32_t servoAngle = 0;
+    size_t previous = SIZE_MAX;        // Last instruction kept in this run
+    size_t firstZeroMove = SIZE_MAX;
+    size_t kept = 0;
+
+    for (size_t i = segmentStart; i < segmentEnd; i++) {
+      Instruction &instruction = program[i];
+      if (isZeroMove(instruction)) {
+        if (firstZeroMove == SIZE_MAX) {
+          firstZeroMove = i; // Decided at the end of the run, it may be all that is left of a block
+        } else {
+          note(log, "Removed zero-length move %s (instruction %d)%s", instruction, i);
+          instruction.op = OP_NONE;
+        }
+        continue;
+      }
+      if (isSetting(instruction.op)) {
+        int setting = instruction.op - OP_X_FEEDRATE;
+        if (known[setting] && value[setting] == instruction.a) {
+          note(log, "Removed %s (instruction %d), already in force%s", instruction, i);
+          instruction.op = OP_NONE;
+          continue;
+        }
+        if (pendingWrite[setting]) {
+          Instruction &overwritten = program[lastWrite[setting]];
+          note(log, "Removed %s (instruction %d), overwritten before use%s", overwritten, lastWrite[setting]);
+          overwritten.op = OP_NONE;
+          kept--;
+        }
+        known[setting] = true;
+        value[setting] = instruction.a;
+        lastWrite[setting] = i;
+        pendingWrite[setting] = true;
+        previous = i;
+        kept++;
+        continue;
+      }
+
+      for (int setting = 0; setting < SettingCount; setting++) {
+        pendingWrite[setting] = false; // Read by this command
+      }
+      if (instruction.op == OP_SERVO) {
+        if (servoKnown && servoAngle == instruction.a) {
+          note(log, "Removed %s (instruction %d), servo already there%s", instruction, i);
+          instruction.op = OP_NONE;
+          continue;
+        }
+        servoKnown = true;
+        servoAngle = instruction.a;
+      }
+      if (previous != SIZE_MAX && instruction.op == OP_DELAY && program[previous].op == OP_DELAY &&
+          (int64_t)program[previous].a + instruction.a <= INT32_MAX) {
+        char detail[32];
+        formatInstruction(program[previous], detail, sizeof(detail));
+        note(log, "Merged %s (instruction %d) into %s", instruction, i, detail);
+        program[previous].a += instruction.a;
+        instruction.op = OP_NONE;
+        continue;
+      }
+      if (previous != SIZE_MAX && canMergeMoves(program[previous], instruction)) {
+        char detail[32];
+        formatInstruction(program[previous], detail, sizeof(detail));
+        note(log, "Merged %s (instruction %d) into %s", instruction, i, detail);
+        program[previous].a += instruction.a;
+        program[previous].b += instruction.b;
+        instruction.op = OP_NONE;
+        continue;
+      }
+      previous = i;
+      kept++;
+    }
+
+    if (kept > 0 && firstZeroMove != SIZE_MAX) {
+      note(log, "Removed zero-length move %s (instruction %d)%s", program[firstZeroMove], firstZeroMove);
+      program[firstZeroMove].op = OP_NONE;
+    }
+    segmentStart = segmentEnd + 1; // Skip the control flow instruction
+  }
+
+  // Jump targets still use the old indices; translate them before compacting
+  for (size_t i = 0; i < count; i++) {
+    Instruction &instruction = program[i];
+    if (instruction.op == OP_END_REPEAT || instruction.op == OP_SUBROUTINE || instruction.op == OP_CALL) {
+      instruction.a = compactedIndex(program, instruction.a);
+    }
+  }
+  size_t length = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (program[i].op != OP_NONE) {
+      program[length++] = program[i];
+    }
+  }
+  return length;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include "Program.h"
+
+// Receives one line per change the optimizer makes, e.g. "Merged X-100 (instruction 7) into X-4250".
+// Instructions count from 1 in the compiled program; repeat blocks and subroutines make that
+// differ from the command number in the source text.
+typedef void (*OptimizerLog)(const char *message);
+
+// Peephole pass over a compiled program, run before it is queued. Rewrites the program in place
+// into an equivalent shorter one and returns the new count:
+// - zero-length moves are dropped
+// - back-to-back X-only (or Z-only) moves in the same direction become one move
+// - back-to-back delays become one delay
+// - a setting (F/G/A/B/J/K/H/C/V) is dropped when the program already set it to that value, or
+//   when the program sets it again before any other command runs
+// - a servo command is dropped when the program already moved the servo to that angle
+// Only facts established by the program itself are used, never the machine state at the time
+// of the call, since other programs may run first. Repeat blocks, subroutine calls and stops are
+// barriers: nothing is merged or remembered across them, and no block is ever left empty.
+// Servo toggles such as S170, S345, S170 are bend strokes and are kept.
+size_t optimizeProgram(Instruction *program, size_t count, OptimizerLog log);
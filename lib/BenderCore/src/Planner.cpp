@@ -0,0 +1,134 @@
+#include "Planner.h"
+
+#include <math.h>
+
+static uint32_t floorRate(const AxisLimits &limits) {
+  uint32_t rate = limits.startRate > 0 ? limits.startRate : 1;
+  return rate < limits.maxRate ? rate : limits.maxRate;
+}
+
+AxisLimits scaleLimits(const AxisLimits &limits, uint32_t percent) {
+  AxisLimits scaled = limits;
+  uint64_t rate = (uint64_t)limits.maxRate * percent / 100;
+  scaled.maxRate = rate == 0 ? 1 : (rate > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)rate);
+  return scaled;
+}
+
+bool movesAreParallel(const int32_t a[AxisCount], const int32_t b[AxisCount]) {
+  for (int axis = 0; axis < AxisCount; axis++) {
+    if ((a[axis] > 0) != (b[axis] > 0) || (a[axis] < 0) != (b[axis] < 0)) {
+      return false; // Different axes or a direction reversal
+    }
+  }
+  for (int i = 0; i < AxisCount; i++) {
+    for (int j = i + 1; j < AxisCount; j++) {
+      if ((int64_t)a[i] * b[j] != (int64_t)a[j] * b[i]) {
+        return false; // Different step ratio
+      }
+    }
+  }
+  return true;
+}
+
+uint32_t reachableRate(uint32_t fromRate, uint32_t steps, const AxisLimits &limits) {
+  if (limits.accel == 0) {
+    return limits.maxRate; // No ramping: any rate is reachable immediately
+  }
+  if (fromRate >= limits.maxRate) {
+    return limits.maxRate;
+  }
+  if (limits.jerk == 0) {
+    float rate = sqrtf((float)fromRate * fromRate + 2.0f * limits.accel * steps);
+    return rate < limits.maxRate ? (uint32_t)rate : limits.maxRate;
+  }
+  uint32_t lo = fromRate, hi = limits.maxRate;
+  if (rampSteps(fromRate, hi, limits) <= steps) {
+    return hi;
+  }
+  while (hi - lo > 1) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (rampSteps(fromRate, mid, limits) <= steps) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+bool MotionPlanner::push(const int32_t steps[AxisCount], const AxisLimits &limits) {
+  if (full()) {
+    return false;
+  }
+  PlannedMove &move = at(count);
+  move.leadSteps = 0;
+  for (int axis = 0; axis < AxisCount; axis++) {
+    move.steps[axis] = steps[axis];
+    uint32_t axisSteps = steps[axis] < 0 ? -steps[axis] : steps[axis];
+    if (axisSteps > move.leadSteps) {
+      move.leadSteps = axisSteps;
+    }
+  }
+  move.limits = limits;
+  move.exitRate = floorRate(limits);
+
+  // An empty buffer means the move before this one (if any) was popped without a successor
+  // and already ends at its start rate, so this move starts from standstill too
+  const PlannedMove *before = count > 0 ? &at(count - 1) : nullptr;
+  if (before && movesAreParallel(before->steps, move.steps)) {
+    move.maxJunctionRate = before->limits.maxRate < limits.maxRate ? before->limits.maxRate : limits.maxRate;
+  } else {
+    move.maxJunctionRate = floorRate(limits);
+  }
+  move.entryRate = floorRate(limits);
+  count++;
+  recalculate();
+  return true;
+}
+
+bool MotionPlanner::pop(PlannedMove &move) {
+  if (empty()) {
+    return false;
+  }
+  move = at(0);
+  move.exitRate = count > 1 ? at(1).entryRate : floorRate(scaleLimits(move.limits, percent));
+  head = (head + 1) % PlannerSize;
+  count--;
+  return true;
+}
+
+void MotionPlanner::clear() {
+  head = 0;
+  count = 0;
+}
+
+void MotionPlanner::setRatePercent(uint32_t ratePercent) {
+  percent = ratePercent;
+  if (count > 0) {
+    recalculate();
+  }
+}
+
+void MotionPlanner::recalculate() {
+  // The oldest move keeps its entry rate: it was fixed when the move before it was popped.
+  // Backward pass: each move must be able to slow down to the entry rate of the next one
+  // Junctions are capped by the scaled feedrates of the moves on both sides.
+  uint32_t exitRate = floorRate(scaleLimits(at(count - 1).limits, percent));
+  for (int i = count - 1; i >= 1; i--) {
+    PlannedMove &move = at(i);
+    uint32_t rate = reachableRate(exitRate, move.leadSteps, scaleLimits(move.limits, percent));
+    uint32_t before = scaleLimits(at(i - 1).limits, percent).maxRate;
+    rate = rate < before ? rate : before;
+    move.entryRate = rate < move.maxJunctionRate ? rate : move.maxJunctionRate;
+    exitRate = move.entryRate;
+  }
+  // Forward pass: no move may enter faster than the previous one can accelerate to
+  for (int i = 0; i + 1 < count; i++) {
+    PlannedMove &move = at(i);
+    PlannedMove &next = at(i + 1);
+    uint32_t rate = reachableRate(move.entryRate, move.leadSteps, scaleLimits(move.limits, percent));
+    if (rate < next.entryRate) {
+      next.entryRate = rate;
+    }
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include "MotionProfile.h"
+
+// Number of moves the planner looks ahead over.
+const int PlannerSize = 8;
+
+// A buffered move with its lead axis limits and the rates the planner chose for it.
+struct PlannedMove {
+  int32_t steps[AxisCount];   // Signed step count per axis
+  AxisLimits limits;          // Lead axis limits (see combineLimits)
+  uint32_t leadSteps;         // Steps of the lead axis
+  uint32_t maxJunctionRate;   // Highest entry rate the junction with the previous move allows
+  uint32_t entryRate;         // Planned lead axis rate at the start of the move
+  uint32_t exitRate;          // Lead axis rate at the end, fixed when the move is popped
+};
+
+// Look-ahead planner. Moves are pushed in program order and popped by the executor when the
+// step engine can take the next one. Consecutive moves in the same direction (same axes, same
+// step ratio) are chained at speed: the planner runs a backward pass so every move can still
+// decelerate in time, and a forward pass so no move enters faster than it can accelerate to.
+// Any other junction, and the end of the buffer, drops to the start rate.
+class MotionPlanner {
+public:
+  // Returns false when the buffer is full.
+  bool push(const int32_t steps[AxisCount], const AxisLimits &limits);
+  // Remove the oldest move with its final entry and exit rates. Its exit rate becomes the fixed
+  // entry rate of the move after it. The limits are the programmed ones: the rates are planned
+  // for scaleLimits(move.limits, ratePercent()).
+  bool pop(PlannedMove &move);
+  void clear();
+  // Feed override: plan every cruise and junction rate at 'percent' of the programmed feedrate.
+  // Entry rates already fixed stay.
+  void setRatePercent(uint32_t percent);
+  uint32_t ratePercent() const { return percent; }
+
+  bool empty() const { return count == 0; }
+  bool full() const { return count == PlannerSize; }
+  int size() const { return count; }
+
+private:
+  void recalculate();
+  PlannedMove &at(int i) { return moves[(head + i) % PlannerSize]; }
+
+  PlannedMove moves[PlannerSize];
+  int head = 0;
+  int count = 0;
+  uint32_t percent = 100;
+};
+
+// Limits with the cruise rate at 'percent' of limits.maxRate (feed override)
+AxisLimits scaleLimits(const AxisLimits &limits, uint32_t percent);
+
+// True when two moves drive the same axes in the same direction at the same step ratio, so the
+// axes can keep their speed across the junction.
+bool movesAreParallel(const int32_t a[AxisCount], const int32_t b[AxisCount]);
+
+// Highest lead axis rate reachable from fromRate within 'steps' under the given limits.
+uint32_t reachableRate(uint32_t fromRate, uint32_t steps, const AxisLimits &limits);
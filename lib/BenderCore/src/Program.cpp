@@ -0,0 +1,479 @@
+#include "Program.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Parse an optionally signed decimal integer at text[pos]; advances pos past it
+static bool parseInteger(const char *text, size_t length, size_t &pos, int32_t &value) {
+  bool negative = false;
+  if (pos < length && (text[pos] == '-' || text[pos] == '+')) {
+    negative = text[pos] == '-';
+    pos++;
+  }
+  size_t start = pos;
+  int64_t result = 0;
+  while (pos < length && isDigit(text[pos])) {
+    result = result * 10 + (text[pos] - '0');
+    if (result > 0x7FFFFFFFLL) {
+      return false;
+    }
+    pos++;
+  }
+  if (pos == start) {
+    return false;
+  }
+  value = (int32_t)(negative ? -result : result);
+  return true;
+}
+
+static bool fail(CompileError &error, const char *message) {
+  snprintf(error.message, sizeof(error.message), "%s", message);
+  return false;
+}
+
+static int failProgram(CompileError &error, const char *message) {
+  fail(error, message);
+  return -1;
+}
+
+// Parse the operands of "M X-700 Z1800" starting after the 'M'
+static bool parseCoordinatedMove(const char *text, size_t length, size_t pos, Instruction &out, CompileError &error) {
+  bool hasAxis = false;
+  out.a = 0;
+  out.b = 0;
+  while (pos < length) {
+    char axis = text[pos];
+    if (isSpace(axis)) {
+      pos++;
+      continue;
+    }
+    if (axis != 'X' && axis != 'Z') {
+      return fail(error, "only X and Z can be combined, e.g. 'M X-700 Z1800'");
+    }
+    pos++;
+    int32_t value;
+    if (!parseInteger(text, length, pos, value)) {
+      return fail(error, "axis letter without a step count");
+    }
+    if (axis == 'X') {
+      out.a = value;
+    } else {
+      out.b = value;
+    }
+    hasAxis = true;
+  }
+  if (!hasAxis) {
+    return fail(error, "combined move needs X and/or Z, e.g. 'M X-700 Z1800'");
+  }
+  return true;
+}
+
+bool compileCommand(const char *text, size_t length, const ProgramLimits &limits, Instruction &out, CompileError &error) {
+  while (length > 0 && isSpace(text[0])) {
+    text++;
+    length--;
+  }
+  while (length > 0 && isSpace(text[length - 1])) {
+    length--;
+  }
+  out.op = OP_NONE;
+  out.a = 0;
+  out.b = 0;
+  if (length == 0) {
+    return fail(error, "empty command");
+  }
+
+  char type = text[0];
+  if (type == 'R' || type == ':' || type == '@' || type == '{' || type == '}') {
+    return fail(error, "repeats and subroutines only work in a whole program");
+  }
+  if (type == '\x03') {
+    out.op = OP_STOP; // CTRL+C
+    return true;
+  }
+  if (type == 'M') {
+    out.op = OP_MOVE;
+    return parseCoordinatedMove(text, length, 1, out, error);
+  }
+
+  size_t pos = 1;
+  int32_t value;
+  if (!parseInteger(text, length, pos, value) || pos != length) {
+    switch (type) {
+      case 'S': case 'D': case 'Z': case 'X': case 'F': case 'G':
+      case 'A': case 'B': case 'J': case 'K': case 'H': case 'C': case 'V':
+        return fail(error, "expected a whole number after the command letter");
+      default:
+        return fail(error, "unknown command");
+    }
+  }
+
+  out.a = value;
+  switch (type) {
+    case 'S':
+      out.op = OP_SERVO;
+      if (value < limits.servoMin || value > limits.servoMax) {
+        snprintf(error.message, sizeof(error.message), "servo angle outside %d to %d", (int)limits.servoMin, (int)limits.servoMax);
+        return false;
+      }
+      return true;
+    case 'D':
+      out.op = OP_DELAY;
+      return value > 0 ? true : fail(error, "delay must be a positive number");
+    case 'X':
+      out.op = OP_MOVE;
+      return true;
+    case 'Z':
+      out.op = OP_MOVE;
+      out.a = 0;
+      out.b = value;
+      return true;
+    case 'F':
+      out.op = OP_X_FEEDRATE;
+      return value > 0 ? true : fail(error, "feedrate must be a positive number");
+    case 'G':
+      out.op = OP_Z_FEEDRATE;
+      return value > 0 ? true : fail(error, "feedrate must be a positive number");
+    case 'A':
+      out.op = OP_X_ACCEL;
+      return value >= 0 ? true : fail(error, "acceleration must not be negative");
+    case 'B':
+      out.op = OP_Z_ACCEL;
+      return value >= 0 ? true : fail(error, "acceleration must not be negative");
+    case 'J':
+      out.op = OP_X_JERK;
+      return value >= 0 ? true : fail(error, "jerk must not be negative");
+    case 'K':
+      out.op = OP_Z_JERK;
+      return value >= 0 ? true : fail(error, "jerk must not be negative");
+    case 'H':
+      out.op = OP_SET_X_VALUE;
+      return true;
+    case 'C':
+      out.op = OP_SET_DELAY;
+      return value >= 0 ? true : fail(error, "delay must not be negative");
+    case 'V':
+      out.op = OP_SERVO_SPEED;
+      return value >= 0 ? true : fail(error, "servo speed must not be negative");
+    default:
+      return fail(error, "unknown command");
+  }
+}
+
+const int MaxSubroutines = 16;
+const size_t MaxNameLength = 15;
+
+struct Subroutine {
+  char name[MaxNameLength + 1];
+  int32_t start;  // Index of the first body instruction
+  int command;    // Command number of the first call, for errors about undefined names
+  bool defined;
+  uint8_t state;  // Depth check: 0 not visited, 1 in progress, 2 done
+  int frames;     // Call stack frames the body needs, calls included
+};
+
+struct Block {
+  size_t index;   // Index of the OP_REPEAT or OP_SUBROUTINE that opened it
+  bool subroutine;
+  int command;
+};
+
+static bool isNameChar(char c) {
+  return isDigit(c) || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+// Find or add the subroutine named text[first..end); returns its index or -1 with 'error' set
+static int lookupSubroutine(const char *text, size_t first, size_t end, Subroutine *subroutines, int &subroutineCount, int command,
+                            CompileError &error) {
+  size_t length = end - first;
+  if (length == 0 || length > MaxNameLength) {
+    return failProgram(error, "subroutine names are 1 to 15 letters, digits or '_'");
+  }
+  for (size_t i = first; i < end; i++) {
+    if (!isNameChar(text[i])) {
+      return failProgram(error, "subroutine names are 1 to 15 letters, digits or '_'");
+    }
+  }
+  for (int i = 0; i < subroutineCount; i++) {
+    if (strlen(subroutines[i].name) == length && memcmp(subroutines[i].name, text + first, length) == 0) {
+      return i;
+    }
+  }
+  if (subroutineCount == MaxSubroutines) {
+    return failProgram(error, "too many subroutines");
+  }
+  Subroutine &subroutine = subroutines[subroutineCount];
+  memcpy(subroutine.name, text + first, length);
+  subroutine.name[length] = '\0';
+  subroutine.start = 0;
+  subroutine.command = command;
+  subroutine.defined = false;
+  subroutine.state = 0;
+  subroutine.frames = 0;
+  return subroutineCount++;
+}
+
+// Call stack frames needed to run out[index..] up to the end of the body that starts there
+// (the matching OP_RETURN, or the end of the program). Calls still hold subroutine indices and
+// control flow instructions their command number in b.
+static int framesNeeded(const Instruction *out, size_t count, size_t index, Subroutine *subroutines, CompileError &error) {
+  int nesting = 0;
+  int frames = 0;
+  while (index < count) {
+    const Instruction &instruction = out[index];
+    switch (instruction.op) {
+      case OP_REPEAT:
+        nesting++;
+        frames = nesting > frames ? nesting : frames;
+        if (frames > CallStackDepth) {
+          error.command = instruction.b;
+          return failProgram(error, "repeats and calls nested deeper than 8");
+        }
+        break;
+      case OP_END_REPEAT:
+        nesting--;
+        break;
+      case OP_SUBROUTINE:
+        index = instruction.a; // Bodies are checked when they are called
+        continue;
+      case OP_RETURN:
+        return frames;
+      case OP_CALL: {
+        Subroutine &callee = subroutines[instruction.a];
+        if (callee.state == 1) {
+          error.command = instruction.b;
+          return failProgram(error, "subroutines must not call themselves, directly or indirectly");
+        }
+        if (callee.state == 0) {
+          callee.state = 1;
+          callee.frames = framesNeeded(out, count, callee.start, subroutines, error);
+          if (callee.frames < 0) {
+            return -1;
+          }
+          callee.state = 2;
+        }
+        int needed = nesting + 1 + callee.frames;
+        frames = needed > frames ? needed : frames;
+        if (frames > CallStackDepth) {
+          error.command = instruction.b;
+          return failProgram(error, "repeats and calls nested deeper than 8");
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    index++;
+  }
+  return frames;
+}
+
+int compileProgram(const char *text, size_t length, const ProgramLimits &limits, Instruction *out, size_t capacity, CompileError &error) {
+  Subroutine subroutines[MaxSubroutines];
+  int subroutineCount = 0;
+  Block blocks[CallStackDepth];
+  int depth = 0;
+  size_t count = 0;
+  int commandNumber = 0;
+  size_t start = 0;
+  error.command = 0;
+
+  // Commands are separated by commas; braces open and close blocks and end a command as well
+  for (size_t pos = 0; pos <= length; pos++) {
+    char separator = pos < length ? text[pos] : ',';
+    if (separator != ',' && separator != '{' && separator != '}') {
+      continue;
+    }
+    size_t first = start;
+    size_t end = pos;
+    start = pos + 1;
+    while (first < end && isSpace(text[first])) {
+      first++;
+    }
+    while (end > first && isSpace(text[end - 1])) {
+      end--;
+    }
+
+    if (separator == '{') {
+      error.command = ++commandNumber;
+      if (first == end) {
+        return failProgram(error, "'{' needs R<count> or :name before it");
+      }
+      if (depth == CallStackDepth) {
+        return failProgram(error, "blocks nested too deep");
+      }
+      if (count >= capacity) {
+        return failProgram(error, "program too long");
+      }
+      Instruction &opening = out[count];
+      opening.a = 0;
+      opening.b = 0;
+      if (text[first] == 'R') {
+        size_t valuePos = first + 1;
+        int32_t repeats;
+        if (!parseInteger(text, end, valuePos, repeats) || valuePos != end || repeats < 1) {
+          return failProgram(error, "repeat count must be a positive number, e.g. R3{...}");
+        }
+        opening.op = OP_REPEAT;
+        opening.a = repeats;
+        opening.b = commandNumber; // For errors found by the depth check, cleared at the end
+      } else if (text[first] == ':') {
+        if (depth > 0) {
+          return failProgram(error, "subroutines must be defined outside other blocks");
+        }
+        int index = lookupSubroutine(text, first + 1, end, subroutines, subroutineCount, commandNumber, error);
+        if (index < 0) {
+          return -1;
+        }
+        if (subroutines[index].defined) {
+          return failProgram(error, "subroutine defined twice");
+        }
+        subroutines[index].defined = true;
+        subroutines[index].start = count + 1;
+        opening.op = OP_SUBROUTINE;
+      } else {
+        return failProgram(error, "only R<count> and :name open a block");
+      }
+      blocks[depth++] = { count, opening.op == OP_SUBROUTINE, commandNumber };
+      count++;
+      continue;
+    }
+
+    if (first < end) { // Skip empty entries such as a trailing comma
+      error.command = ++commandNumber;
+      if (count >= capacity) {
+        return failProgram(error, "program too long");
+      }
+      if (text[first] == '@') {
+        int index = lookupSubroutine(text, first + 1, end, subroutines, subroutineCount, commandNumber, error);
+        if (index < 0) {
+          return -1;
+        }
+        out[count] = { OP_CALL, index, commandNumber }; // Resolved to the body's index once all are known
+      } else if (!compileCommand(text + first, end - first, limits, out[count], error)) {
+        return -1;
+      }
+      count++;
+    }
+
+    if (separator == '}') {
+      if (depth == 0) {
+        error.command = commandNumber + 1;
+        return failProgram(error, "'}' without a block to close");
+      }
+      Block &block = blocks[--depth];
+      error.command = block.command;
+      if (count == block.index + 1) {
+        return failProgram(error, "empty block");
+      }
+      if (count >= capacity) {
+        return failProgram(error, "program too long");
+      }
+      if (block.subroutine) {
+        out[count] = { OP_RETURN, 0, 0 };
+        out[block.index].a = count + 1;
+      } else {
+        out[count] = { OP_END_REPEAT, (int32_t)block.index, 0 };
+      }
+      count++;
+    }
+  }
+  if (depth > 0) {
+    error.command = blocks[depth - 1].command;
+    return failProgram(error, "block not closed with '}'");
+  }
+
+  for (int i = 0; i < subroutineCount; i++) {
+    if (!subroutines[i].defined) {
+      error.command = subroutines[i].command;
+      return failProgram(error, "call of an undefined subroutine");
+    }
+  }
+  if (framesNeeded(out, count, 0, subroutines, error) < 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (out[i].op == OP_CALL) {
+      out[i].a = subroutines[out[i].a].start;
+    }
+    if (out[i].op == OP_CALL || out[i].op == OP_REPEAT) {
+      out[i].b = 0;
+    }
+  }
+  return (int)count;
+}
+
+bool hasControlFlow(const Instruction *program, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (program[i].op >= OP_REPEAT) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void formatInstruction(const Instruction &instruction, char *buffer, size_t size) {
+  switch (instruction.op) {
+    case OP_SERVO: snprintf(buffer, size, "S%d", (int)instruction.a); break;
+    case OP_DELAY: snprintf(buffer, size, "D%d", (int)instruction.a); break;
+    case OP_MOVE:
+      if (instruction.b == 0) {
+        snprintf(buffer, size, "X%d", (int)instruction.a);
+      } else if (instruction.a == 0) {
+        snprintf(buffer, size, "Z%d", (int)instruction.b);
+      } else {
+        snprintf(buffer, size, "M X%d Z%d", (int)instruction.a, (int)instruction.b);
+      }
+      break;
+    case OP_X_FEEDRATE: snprintf(buffer, size, "F%d", (int)instruction.a); break;
+    case OP_Z_FEEDRATE: snprintf(buffer, size, "G%d", (int)instruction.a); break;
+    case OP_X_ACCEL: snprintf(buffer, size, "A%d", (int)instruction.a); break;
+    case OP_Z_ACCEL: snprintf(buffer, size, "B%d", (int)instruction.a); break;
+    case OP_X_JERK: snprintf(buffer, size, "J%d", (int)instruction.a); break;
+    case OP_Z_JERK: snprintf(buffer, size, "K%d", (int)instruction.a); break;
+    case OP_SET_X_VALUE: snprintf(buffer, size, "H%d", (int)instruction.a); break;
+    case OP_SET_DELAY: snprintf(buffer, size, "C%d", (int)instruction.a); break;
+    case OP_SERVO_SPEED: snprintf(buffer, size, "V%d", (int)instruction.a); break;
+    case OP_STOP: snprintf(buffer, size, "CTRL+C"); break;
+    case OP_REPEAT: snprintf(buffer, size, "R%d{", (int)instruction.a); break;
+    case OP_END_REPEAT: case OP_RETURN: snprintf(buffer, size, "}"); break;
+    case OP_SUBROUTINE: snprintf(buffer, size, ":{"); break;
+    case OP_CALL: snprintf(buffer, size, "@%d", (int)instruction.a + 1); break; // 1-based index of the body
+    case OP_RUN: snprintf(buffer, size, "RUN %d", (int)instruction.a); break;
+    default: snprintf(buffer, size, "?%d", (int)instruction.op); break;
+  }
+}
+
+bool needsStopAndSettle(const Instruction &instruction) {
+  switch (instruction.op) {
+    case OP_MOVE:
+    case OP_X_FEEDRATE: case OP_Z_FEEDRATE:
+    case OP_X_ACCEL: case OP_Z_ACCEL:
+    case OP_X_JERK: case OP_Z_JERK:
+    case OP_SET_X_VALUE: case OP_SET_DELAY:
+    case OP_SERVO_SPEED:
+      return false;
+    default:
+      return true;
+  }
+}
+
+bool dependsOnServo(const Instruction &instruction) {
+  switch (instruction.op) {
+    case OP_SERVO:
+    case OP_DELAY:
+      return true;
+    case OP_MOVE:
+      return instruction.a != 0; // X feeds the wire through the bending head
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compiled form of the comma-separated command language. Programs are validated and parsed
+// once when they arrive; the executor only ever sees these fixed-size instructions.
+enum Opcode : uint8_t {
+  OP_NONE = 0,
+  OP_SERVO,      // S<angle>
+  OP_DELAY,      // D<ms>
+  OP_MOVE,       // X<steps>, Z<steps>, M X<steps> Z<steps>: a = X steps, b = Z steps
+  OP_X_FEEDRATE, // F<steps/s>
+  OP_Z_FEEDRATE, // G<steps/s>
+  OP_X_ACCEL,    // A<steps/s^2>
+  OP_Z_ACCEL,    // B<steps/s^2>
+  OP_X_JERK,     // J<steps/s^3>
+  OP_Z_JERK,     // K<steps/s^3>
+  OP_SET_X_VALUE, // H<steps>
+  OP_SET_DELAY,  // C<ms>
+  OP_SERVO_SPEED, // V<deg/s>
+  OP_STOP,       // CTRL+C
+
+  // Control flow, resolved by the Interpreter; the executor never sees these
+  OP_REPEAT,     // R<n>{: a = repeat count
+  OP_END_REPEAT, // }: a = index of the matching OP_REPEAT
+  OP_SUBROUTINE, // :name{: a = index after the body, skipped when reached in sequence
+  OP_RETURN,     // } closing a subroutine
+  OP_CALL,       // @name: a = index of the first instruction of the body
+  OP_RUN,        // Queue only: run the program image in slot a (see Interpreter)
+};
+
+struct Instruction {
+  uint8_t op;  // Opcode
+  int32_t a;   // First operand
+  int32_t b;   // Second operand (Z steps of a move), otherwise 0
+};
+
+static_assert(sizeof(Instruction) == 12, "Instruction must stay a compact 12-byte record");
+
+// Repeat blocks and subroutine calls nest at most this deep at run time.
+const int CallStackDepth = 8;
+
+// Machine limits checked at compile time.
+struct ProgramLimits {
+  int32_t servoMin; // Lowest allowed servo angle
+  int32_t servoMax; // Highest allowed servo angle
+};
+
+struct CompileError {
+  int command;       // 1-based position of the offending command in the buffer
+  char message[64];  // Human readable reason
+};
+
+// Compile a single command (no commas). Returns false and fills 'error' if it is invalid.
+bool compileCommand(const char *text, size_t length, const ProgramLimits &limits, Instruction &out, CompileError &error);
+
+// Compile a comma-separated buffer into 'out'. Empty entries are skipped. The whole buffer is
+// validated first: on any error nothing is usable and the return value is -1.
+// Besides plain commands a program may contain repeat blocks, R3{S170, X-100}, and subroutines
+// defined at the top level with :name{...} and called with @name (before or after the
+// definition). These compile to control flow instructions that the Interpreter follows, so a
+// repeated block is stored once. Blocks must not be empty, recursion is rejected and nesting,
+// including calls, is limited to CallStackDepth.
+int compileProgram(const char *text, size_t length, const ProgramLimits &limits, Instruction *out, size_t capacity, CompileError &error);
+
+// True if a compiled program contains repeats or subroutines and has to run through the
+// Interpreter instead of being queued command by command.
+bool hasControlFlow(const Instruction *program, size_t count);
+
+// Format an instruction back into command syntax (e.g. "M X-700 Z1800").
+void formatInstruction(const Instruction &instruction, char *buffer, size_t size);
+
+// Moves and setting changes can be planned ahead of execution. Every other instruction (servo
+// bends, delays, stop) needs all motion stopped and settled before and after it runs.
+bool needsStopAndSettle(const Instruction &instruction);
+
+// Servo bends, delays and wire feeds (moves with an X component) wait until the servo has
+// settled. Z rotations and setting changes may overlap with the servo still travelling.
+bool dependsOnServo(const Instruction &instruction);
@@ -0,0 +1,63 @@
+#include "SerialFramer.h"
+
+static bool isDelimiter(uint8_t byte) {
+  return byte == ',' || byte == '\n' || byte == '\r';
+}
+
+FrameEvent SerialFramer::push(uint8_t byte) {
+  // Upload payloads are program text and may hold '!', '~' or any other byte; only CTRL+C
+  // still gets through, so a runaway upload can be stopped
+  if (uploadRemaining > 0 ? byte == RealtimeStop : isRealtimeByte(byte)) {
+    realtime = byte;
+    return FRAME_REALTIME;
+  }
+
+  if (uploadRemaining > 0) {
+    if (!uploadSkipping) {
+      uploadBuffer[uploadFill++] = (char)byte;
+    }
+    if (--uploadRemaining > 0) {
+      return FRAME_NONE;
+    }
+    return uploadSkipping ? FRAME_OVERFLOW : FRAME_UPLOAD;
+  }
+
+  if (lineTaken) {
+    length = 0;
+    lineTaken = false;
+  }
+
+  if (isDelimiter(byte)) {
+    if (overflow) {
+      overflow = false;
+      length = 0;
+      return FRAME_OVERFLOW;
+    }
+    while (length > 0 && (lineBuffer[length - 1] == ' ' || lineBuffer[length - 1] == '\t')) {
+      length--;
+    }
+    if (length == 0) {
+      return FRAME_NONE; // Empty command, e.g. a trailing comma or CR LF
+    }
+    lineBuffer[length] = '\0';
+    lineTaken = true;
+    return FRAME_LINE;
+  }
+
+  if (length == 0 && (byte == ' ' || byte == '\t')) {
+    return FRAME_NONE; // Leading whitespace
+  }
+  if (length >= SerialLineSize) {
+    overflow = true;
+    return FRAME_NONE;
+  }
+  lineBuffer[length++] = (char)byte;
+  return FRAME_NONE;
+}
+
+bool SerialFramer::beginUpload(size_t bytes) {
+  uploadFill = 0;
+  uploadRemaining = bytes;
+  uploadSkipping = bytes > uploadCapacity;
+  return !uploadSkipping;
+}
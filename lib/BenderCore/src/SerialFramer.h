@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest command or $ control line, without the delimiter
+const size_t SerialLineSize = 96;
+
+// Real-time bytes. The hold, resume and feed override bytes are grbl's, so senders that know
+// grbl can use them.
+const uint8_t RealtimeStop = 0x03;         // CTRL+C
+const uint8_t RealtimeHold = '!';          // Feed hold: decelerate and pause
+const uint8_t RealtimeResume = '~';        // Continue after a feed hold
+const uint8_t RealtimeFeedReset = 0x90;    // Feed override back to 100 %
+const uint8_t RealtimeFeedUp10 = 0x91;     // +10 %
+const uint8_t RealtimeFeedDown10 = 0x92;   // -10 %
+const uint8_t RealtimeFeedUp1 = 0x93;      // +1 %
+const uint8_t RealtimeFeedDown1 = 0x94;    // -1 %
+
+enum FrameEvent : uint8_t {
+  FRAME_NONE,     // Byte consumed, nothing complete yet
+  FRAME_LINE,     // A command or $ control line is ready in line()
+  FRAME_UPLOAD,   // The bulk upload started with beginUpload() is complete in upload()
+  FRAME_OVERFLOW, // A line or upload did not fit and was dropped
+  FRAME_REALTIME, // A real-time byte (CTRL+C, hold, resume, feed override) that bypasses framing, in realtimeByte()
+};
+
+// Splits the serial byte stream into commands without allocating. A command ends at ',' or a
+// line break, never because the host paused, so streamed programs are not split at random
+// points. Surrounding whitespace and empty commands are dropped. After a "$UPLOAD <bytes>"
+// line the caller switches to beginUpload() and the next <bytes> bytes are collected raw into
+// the upload buffer. Real-time bytes are reported as soon as they arrive, also inside a line;
+// inside an upload only CTRL+C is, and every other byte is payload.
+class SerialFramer {
+public:
+  SerialFramer(char *uploadBuffer, size_t uploadCapacity) : uploadBuffer(uploadBuffer), uploadCapacity(uploadCapacity) {}
+
+  FrameEvent push(uint8_t byte);
+
+  const char *line() const { return lineBuffer; } // NUL terminated
+  size_t lineLength() const { return length; }
+  // Take the next 'bytes' bytes as one upload. If they do not fit they are skipped and reported
+  // as FRAME_OVERFLOW; returns false in that case.
+  bool beginUpload(size_t bytes);
+  const char *upload() const { return uploadBuffer; }
+  size_t uploadLength() const { return uploadFill; }
+  uint8_t realtimeByte() const { return realtime; }
+
+  static bool isRealtimeByte(uint8_t byte) { return byte == RealtimeStop || byte == RealtimeHold || byte == RealtimeResume || (byte >= RealtimeFeedReset && byte <= RealtimeFeedDown1); }
+
+private:
+  char lineBuffer[SerialLineSize + 1];
+  size_t length = 0;
+  bool lineTaken = false;   // line() was handed out, start over with the next byte
+  bool overflow = false;    // The current line is too long and is being skipped
+  char *uploadBuffer;
+  size_t uploadCapacity;
+  size_t uploadRemaining = 0; // Raw bytes still expected
+  size_t uploadFill = 0;
+  bool uploadSkipping = false; // The upload is too large and is being skipped
+  uint8_t realtime = 0;
+};
@@ -0,0 +1,13 @@
+#include "ServoTiming.h"
+
+uint32_t servoSettleMs(int32_t fromAngle, int32_t toAngle, const ServoTiming &timing) {
+  uint32_t travel = fromAngle < toAngle ? toAngle - fromAngle : fromAngle - toAngle;
+  if (travel == 0) {
+    return 0;
+  }
+  if (timing.degPerSecond == 0) {
+    return timing.maxSettleMs;
+  }
+  uint32_t settle = (travel * 1000UL + timing.degPerSecond - 1) / timing.degPerSecond + timing.marginMs;
+  return settle < timing.maxSettleMs ? settle : timing.maxSettleMs;
+}
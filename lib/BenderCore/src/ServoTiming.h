@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+// The servo gives no position feedback, so the controller tracks the last commanded angle and
+// assumes the servo travels at a fixed speed, then needs a short margin to stop ringing.
+struct ServoTiming {
+  uint32_t degPerSecond; // Travel speed in command degrees (0-360 scale) per second, 0 = unknown
+  uint32_t marginMs;     // Added to every move that changes the angle
+  uint32_t maxSettleMs;  // Upper bound; also used when the speed is unknown
+};
+
+// Time for the servo to travel from one angle to another and settle. 0 if the angle is unchanged.
+uint32_t servoSettleMs(int32_t fromAngle, int32_t toAngle, const ServoTiming &timing);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Bounded lock-free single-producer/single-consumer queue with preallocated storage.
+// Exactly one task may call the producer methods (push, pushAll) and exactly one task the
+// consumer methods (front, pop, clear). Indices grow monotonically; the producer publishes
+// items with a release store of 'head' and the consumer frees slots with a release store of
+// 'tail', so neither side ever blocks or allocates.
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+  // Producer: returns false when the queue is full.
+  bool push(const T &item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    items[h % Capacity] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer: all-or-nothing push, published to the consumer in one step so a program is
+  // never seen half written. Returns false without pushing if the items do not fit.
+  bool pushAll(const T *source, size_t n) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (n > Capacity - (h - tail.load(std::memory_order_acquire))) {
+      return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+      items[(h + i) % Capacity] = source[i];
+    }
+    head.store(h + n, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: oldest item; only valid while !empty().
+  const T &front() const { return items[tail.load(std::memory_order_relaxed) % Capacity]; }
+
+  // Consumer: returns false when the queue is empty.
+  bool pop(T &item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) {
+      return false;
+    }
+    item = items[t % Capacity];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: drop everything published so far.
+  void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+  // Any task; a snapshot that may be stale by the time it is used. Tail is read first: both
+  // indices only grow, so the difference cannot underflow, and a head that ran ahead while a
+  // third task read them is clamped to the capacity.
+  bool empty() const { return size() == 0; }
+  size_t size() const {
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t n = head.load(std::memory_order_acquire) - t;
+    return n < Capacity ? n : Capacity;
+  }
+  size_t available() const { return Capacity - size(); }
+  static size_t capacity() { return Capacity; }
+
+private:
+  T items[Capacity];
+  std::atomic<size_t> head{0}; // Next slot the producer writes
+  std::atomic<size_t> tail{0}; // Next slot the consumer reads
+};
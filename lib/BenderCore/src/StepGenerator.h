@@ -0,0 +1,154 @@
+#pragma once
+
+#include "MotionProfile.h"
+#include "StepTiming.h"
+
+// Half-period at a 16.16 fixed-point position inside a ramp table. Linear interpolation with
+// an 8-bit fraction keeps the math to one multiply and shifts, with no division per step.
+STEP_ISR_ATTR inline uint32_t rampHalfPeriod(const uint32_t *table, uint32_t position) {
+  uint32_t index = position >> 16;
+  if (index >= (uint32_t)RampPoints) {
+    return table[RampPoints];
+  }
+  int32_t a = (int32_t)table[index];
+  int32_t b = (int32_t)table[index + 1];
+  int32_t fraction = (int32_t)((position >> 8) & 0xFF);
+  return (uint32_t)(a + (((b - a) * fraction) >> 8));
+}
+
+// Hardware-independent pulse sequencer. The engine calls onAlarm() from its timer interrupt;
+// each call returns a bit mask (bit n = axis n) of the pulse pins that must be high now and
+// the ticks until the next alarm. The lead axis steps on every rising edge; the other axes
+// step when their Bresenham error term overflows, so all axes start and finish together.
+class StepGenerator {
+public:
+  // Load a planned move. The plan must stay valid until the move finishes. Directions must be
+  // applied by the caller before the first alarm. Also called from the interrupt to chain the
+  // next buffered move.
+  STEP_ISR_ATTR void begin(const MotionPlan &motionPlan) {
+    plan = &motionPlan;
+    totalSteps = motionPlan.steps;
+    decelStart = totalSteps - motionPlan.decelSteps;
+    stepIndex = 0;
+    profileStart = 0;
+    accelPosition = 0;
+    decelPosition = 0;
+    halfPeriod = 0;
+    highMask = 0;
+    movingMask = 0;
+    directionMask = 0;
+    for (int axis = 0; axis < AxisCount; axis++) {
+      int32_t steps = motionPlan.axisSteps[axis];
+      axisCount[axis] = steps < 0 ? -steps : steps;
+      // Start half way so the minor axis steps are centred between lead axis steps
+      error[axis] = totalSteps / 2;
+      if (axisCount[axis]) {
+        movingMask |= 1 << axis;
+      }
+      if (steps > 0) {
+        directionMask |= 1 << axis;
+      }
+    }
+    running = totalSteps > 0;
+  }
+
+  // Switch the running move to another speed profile, planned for the lead steps left after
+  // 'fromStep' (profile.steps of them); the axes, directions and Bresenham terms stay. Steps
+  // taken since 'fromStep' are skipped in the new profile. The profile must stay valid until the
+  // move finishes. Call with the timer interrupt masked.
+  STEP_ISR_ATTR void retime(const MotionPlan &profile, uint32_t fromStep) {
+    plan = &profile;
+    profileStart = fromStep;
+    decelStart = totalSteps - profile.decelSteps;
+    uint32_t skipped = stepIndex - fromStep;
+    accelPosition = skipped < profile.accelSteps ? skipped * profile.accelIndexStep : 0;
+    decelPosition = stepIndex > decelStart ? (stepIndex - decelStart) * profile.decelIndexStep : 0;
+  }
+
+  // Speed limit laid over the planned profile (feed hold and resume): a ramp table walked one
+  // lead step per entry for 'steps' steps, the rate never above the plan's. It is not reset by
+  // begin(), so it carries over into chained moves.
+  STEP_ISR_ATTR void setLimitRamp(const uint32_t *table, uint32_t indexStep, uint32_t steps) {
+    limitTable = table;
+    limitIndexStep = indexStep;
+    limitPosition = 0;
+    limitSteps = steps;
+  }
+  bool limitRampDone() const { return limitSteps == 0; }
+  // No pulse is high: the move can be paused here and continued later
+  bool betweenSteps() const { return highMask == 0; }
+
+  bool busy() const { return running; }
+  // Bit mask of axes that move in this plan, and of those moving in the positive direction
+  uint8_t axisMask() const { return movingMask; }
+  uint8_t forwardMask() const { return directionMask; }
+  uint32_t stepsDone() const { return stepIndex; }
+  // Half-period of the current step in timer ticks, 0 before the first step
+  uint32_t currentHalfPeriod() const { return halfPeriod; }
+
+  // Returns the ticks until the next alarm, or 0 once the move has finished.
+  STEP_ISR_ATTR uint32_t onAlarm(uint8_t &pulseMask) {
+    if (highMask) {
+      highMask = 0; // Falling edge completes the step; keep the low time equal to the high time
+      pulseMask = 0;
+      stepIndex++;
+      return halfPeriod;
+    }
+    if (stepIndex >= totalSteps) {
+      running = false; // Last low half-period elapsed: move complete
+      return 0;
+    }
+    halfPeriod = nextHalfPeriod();
+    uint8_t mask = 0;
+    for (int axis = 0; axis < AxisCount; axis++) {
+      error[axis] += axisCount[axis];
+      if (error[axis] >= totalSteps) {
+        error[axis] -= totalSteps;
+        mask |= 1 << axis;
+      }
+    }
+    highMask = mask;
+    pulseMask = mask;
+    return halfPeriod;
+  }
+
+private:
+  STEP_ISR_ATTR uint32_t nextHalfPeriod() {
+    uint32_t ticks;
+    if (stepIndex - profileStart < plan->accelSteps) {
+      ticks = rampHalfPeriod(plan->accelTable, accelPosition);
+      accelPosition += plan->accelIndexStep;
+    } else if (stepIndex >= decelStart) {
+      ticks = rampHalfPeriod(plan->decelTable, decelPosition);
+      decelPosition += plan->decelIndexStep;
+    } else {
+      ticks = plan->cruiseHalfPeriod;
+    }
+    if (limitSteps > 0) {
+      uint32_t limit = rampHalfPeriod(limitTable, limitPosition);
+      limitPosition += limitIndexStep;
+      limitSteps--;
+      ticks = limit > ticks ? limit : ticks; // The slower of the two
+    }
+    return ticks;
+  }
+
+  const MotionPlan *plan = nullptr;
+  uint32_t totalSteps = 0;
+  uint32_t stepIndex = 0;
+  uint32_t decelStart = 0;
+  uint32_t profileStart = 0;  // Lead step the speed profile starts at; non-zero after retime()
+  uint32_t accelPosition = 0; // 16.16 position in the accel table
+  uint32_t decelPosition = 0; // 16.16 position in the decel table
+  uint32_t halfPeriod = 0;
+  uint32_t axisCount[AxisCount] = {};  // Absolute steps per axis
+  uint32_t error[AxisCount] = {};      // Bresenham error accumulators
+  const uint32_t *limitTable = nullptr; // Speed limit ramp, see setLimitRamp()
+  uint32_t limitIndexStep = 0;
+  uint32_t limitPosition = 0;
+  uint32_t limitSteps = 0;              // Steps left on the limit ramp
+  uint8_t highMask = 0;                // Pulse pins currently high
+  uint8_t movingMask = 0;
+  uint8_t directionMask = 0;
+  bool running = false;
+};
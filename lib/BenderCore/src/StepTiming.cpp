@@ -0,0 +1,9 @@
+#include "StepTiming.h"
+
+uint32_t halfPeriodTicks(uint32_t rate) {
+  if (rate == 0) {
+    rate = 1; // Guard against division by zero: slowest possible rate
+  }
+  uint32_t ticks = StepTimerHz / 2 / rate; // Same result as StepTimerHz / (2 * rate), which overflows above 2^31
+  return ticks < MinHalfPeriodTicks ? MinHalfPeriodTicks : ticks;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Functions called from the step timer interrupt must live in IRAM on the ESP32 so they keep
+// running while the flash cache is disabled (SPIFFS writes). On the host this expands to nothing.
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_attr.h>
+#define STEP_ISR_ATTR IRAM_ATTR
+#else
+#define STEP_ISR_ATTR
+#endif
+
+// Step timer frequency: APB 80 MHz divided by 80, so one timer tick is one microsecond.
+const uint32_t StepTimerHz = 1000000UL;
+// Shortest half-period the engine schedules (timer ticks). Caps the rate at 50k steps/s.
+const uint32_t MinHalfPeriodTicks = 10;
+// Time between setting the direction pin and the first pulse edge (timer ticks).
+const uint32_t DirSetupTicks = 5;
+
+// Half of the step period in timer ticks for the given rate (same math the old
+// delayMicroseconds() loop in moveStepper() used).
+uint32_t halfPeriodTicks(uint32_t rate);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include "StepTiming.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <soc/gpio_reg.h>
+#endif
+
+// Output pins of the first GPIO bank (0-31) switched by bit mask: the pins in 'high' go high,
+// then the pins in 'low' go low. On the ESP32 that is one store to the set register and one to
+// the clear register, so every axis switches on the same cycle and no pin number is looked up.
+// The host backend writes the pins one by one through digitalWrite(), where the simulator
+// records them.
+struct GpioBank {
+  STEP_ISR_ATTR static inline void write(uint32_t high, uint32_t low) {
+#if defined(ARDUINO_ARCH_ESP32)
+    if (high) {
+      REG_WRITE(GPIO_OUT_W1TS_REG, high);
+    }
+    if (low) {
+      REG_WRITE(GPIO_OUT_W1TC_REG, low);
+    }
+#else
+    for (uint8_t pin = 0; pin < 32; pin++) {
+      if (high & (1UL << pin)) {
+        digitalWrite(pin, HIGH);
+      } else if (low & (1UL << pin)) {
+        digitalWrite(pin, LOW);
+      }
+    }
+#endif
+  }
+};
+
+// Pulse and direction inputs of one stepper driver, fixed at compile time. The step engine only
+// works with the masks, so a pin change is a change of the type. 'Invert' swaps the direction
+// level for positive steps, for a motor wired the other way round.
+template <uint8_t PulsePin, uint8_t DirPin, bool Invert = false>
+struct Axis {
+  static_assert(PulsePin < 32 && DirPin < 32, "Step and direction pins must be GPIO 0-31, the bank GpioBank writes");
+
+  static constexpr uint8_t pulsePin = PulsePin;
+  static constexpr uint8_t directionPin = DirPin;
+  static constexpr uint32_t pulseMask = 1UL << PulsePin;
+  static constexpr uint32_t directionMask = 1UL << DirPin;
+  static constexpr uint8_t forwardLevel = Invert ? LOW : HIGH; // Direction pin level for positive steps
+
+  static void begin() {
+    pinMode(PulsePin, OUTPUT);
+    pinMode(DirPin, OUTPUT);
+    GpioBank::write(0, pulseMask);
+  }
+  // Direction pin bits to set (the rest of directionMask is cleared) for a move
+  static constexpr uint32_t directionBits(bool forward) { return forward != Invert ? directionMask : 0; }
+};
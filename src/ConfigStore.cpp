@@ -0,0 +1,281 @@
+#include "ConfigStore.h"
+
+#include <memory>
+#include "Logger.h"
+
+#define CONFIG_JOURNAL "/config.jnl"
+#define CONFIG_JOURNAL_NEW "/config.new"
+#define CONFIG_TEXT "/config.txt"   // Format before the journal, migrated once
+#define CONFIG_JOURNAL_LIMIT 8192   // Compact the journal instead of growing it past this
+
+const uint32_t RecordMagic = 0x47464342; // "BCFG"
+// Bump when ConfigFields changes; records in another format are skipped
+const uint16_t ConfigFormat = 1;
+
+struct RecordHeader {
+  uint32_t magic;
+  uint16_t format;
+  uint16_t length;   // Payload bytes: ConfigFields followed by the command buffer
+  uint32_t sequence; // Counts saves, for /viewConfig
+  uint32_t crc;      // CRC-32 of the payload
+};
+
+struct ConfigFields {
+  int32_t xFeedrate;
+  int32_t zFeedrate;
+  int32_t xAccel;
+  int32_t zAccel;
+  int32_t xJerk;
+  int32_t zJerk;
+  int32_t globalXValue;
+  int32_t globalDelayMs;
+  int32_t servoDegPerSecond;
+  uint8_t optimize;
+  uint8_t reserved[3];
+};
+
+const size_t MaxBufferLength = 0xFFFF - sizeof(ConfigFields);
+
+ConfigStore configStore;
+
+static uint32_t crc32(const uint8_t *data, size_t size) {
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+static bool sameValues(const ConfigValues &a, const ConfigValues &b) {
+  return a.xFeedrate == b.xFeedrate && a.zFeedrate == b.zFeedrate && a.xAccel == b.xAccel && a.zAccel == b.zAccel &&
+         a.xJerk == b.xJerk && a.zJerk == b.zJerk && a.globalXValue == b.globalXValue && a.globalDelayMs == b.globalDelayMs &&
+         a.servoDegPerSecond == b.servoDegPerSecond && a.optimize == b.optimize && a.commandBuffer == b.commandBuffer;
+}
+
+// Header and payload of one journal record in a single buffer, so it is written in one call
+static std::unique_ptr<uint8_t[]> encodeRecord(const ConfigValues &values, uint32_t sequence, size_t &size) {
+  ConfigFields fields = { values.xFeedrate, values.zFeedrate, values.xAccel, values.zAccel, values.xJerk, values.zJerk,
+                          values.globalXValue, values.globalDelayMs, values.servoDegPerSecond, values.optimize, {} };
+  size_t length = sizeof(fields) + values.commandBuffer.length();
+  size = sizeof(RecordHeader) + length;
+  std::unique_ptr<uint8_t[]> record(new uint8_t[size]);
+  uint8_t *payload = record.get() + sizeof(RecordHeader);
+  memcpy(payload, &fields, sizeof(fields));
+  memcpy(payload + sizeof(fields), values.commandBuffer.c_str(), values.commandBuffer.length());
+  RecordHeader header = { RecordMagic, ConfigFormat, (uint16_t)length, sequence, crc32(payload, length) };
+  memcpy(record.get(), &header, sizeof(header));
+  return record;
+}
+
+static void decodePayload(const uint8_t *payload, size_t length, ConfigValues &values) {
+  ConfigFields fields;
+  memcpy(&fields, payload, sizeof(fields));
+  values.xFeedrate = fields.xFeedrate;
+  values.zFeedrate = fields.zFeedrate;
+  values.xAccel = fields.xAccel;
+  values.zAccel = fields.zAccel;
+  values.xJerk = fields.xJerk;
+  values.zJerk = fields.zJerk;
+  values.globalXValue = fields.globalXValue;
+  values.globalDelayMs = fields.globalDelayMs;
+  values.servoDegPerSecond = fields.servoDegPerSecond;
+  values.optimize = fields.optimize != 0;
+  std::unique_ptr<char[]> buffer(new char[length - sizeof(fields) + 1]);
+  memcpy(buffer.get(), payload + sizeof(fields), length - sizeof(fields));
+  buffer[length - sizeof(fields)] = '\0';
+  values.commandBuffer = buffer.get();
+}
+
+bool ConfigStore::begin(const ConfigValues &defaults) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!SPIFFS.exists(CONFIG_JOURNAL) && SPIFFS.exists(CONFIG_JOURNAL_NEW)) {
+    SPIFFS.rename(CONFIG_JOURNAL_NEW, CONFIG_JOURNAL); // Power was lost between removing the old journal and renaming
+  } else if (SPIFFS.exists(CONFIG_JOURNAL_NEW)) {
+    SPIFFS.remove(CONFIG_JOURNAL_NEW); // Compaction that never finished; the old journal is intact
+  }
+  File file = SPIFFS.open(CONFIG_JOURNAL, FILE_READ);
+  if (!file) {
+    return migrate(defaults);
+  }
+
+  // Keep the last intact record. A save cut short can only be the last one in the file.
+  size_t fileSize = file.size();
+  size_t offset = 0;
+  RecordHeader header;
+  while (file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == RecordMagic) {
+    std::unique_ptr<uint8_t[]> payload(new uint8_t[header.length]);
+    if (file.read(payload.get(), header.length) != header.length) {
+      break;
+    }
+    offset += sizeof(header) + header.length;
+    if (header.format == ConfigFormat && header.length >= sizeof(ConfigFields) && crc32(payload.get(), header.length) == header.crc) {
+      decodePayload(payload.get(), header.length, cache);
+      cached = true;
+      sequence = header.sequence;
+    }
+  }
+  file.close();
+  journalBytes = offset;
+  if (offset != fileSize) {
+    // Appending after the torn record would hide every later save: start a clean journal
+    LOG_WARN("Config journal ends in an incomplete save; keeping save #%u.\n", (unsigned)sequence);
+    if (cached) {
+      compact(cache);
+    } else {
+      SPIFFS.remove(CONFIG_JOURNAL);
+      journalBytes = 0;
+    }
+  }
+  if (cached) {
+    LOG_INFO("Config loaded: save #%u, journal %u bytes.\n", (unsigned)sequence, (unsigned)journalBytes);
+  } else {
+    LOG_INFO("No saved config. Continuing with default values.\n");
+  }
+  return cached;
+}
+
+// Convert the key:value lines of the old /config.txt into the first journal record
+bool ConfigStore::migrate(const ConfigValues &defaults) {
+  File file = SPIFFS.open(CONFIG_TEXT, FILE_READ);
+  if (!file) {
+    LOG_INFO("No saved config. Continuing with default values.\n");
+    return false;
+  }
+  ConfigValues values = defaults;
+  while (file.available()) {
+    String line = file.readStringUntil('\n');
+    if (line.startsWith("XSpeed:")) {
+      values.xFeedrate = line.substring(7).toInt();
+    } else if (line.startsWith("ZSpeed:")) {
+      values.zFeedrate = line.substring(7).toInt();
+    } else if (line.startsWith("XAccel:")) {
+      values.xAccel = line.substring(7).toInt();
+    } else if (line.startsWith("ZAccel:")) {
+      values.zAccel = line.substring(7).toInt();
+    } else if (line.startsWith("XJerk:")) {
+      values.xJerk = line.substring(6).toInt();
+    } else if (line.startsWith("ZJerk:")) {
+      values.zJerk = line.substring(6).toInt();
+    } else if (line.startsWith("globalXValue:")) {
+      values.globalXValue = line.substring(13).toInt();
+    } else if (line.startsWith("globalDelayMs:")) {
+      values.globalDelayMs = line.substring(14).toInt();
+    } else if (line.startsWith("ServoSpeed:")) {
+      values.servoDegPerSecond = line.substring(11).toInt();
+    } else if (line.startsWith("Optimize:")) {
+      values.optimize = line.substring(9).toInt() != 0;
+    } else if (line.startsWith("CommandBuffer:")) {
+      values.commandBuffer = line.substring(14);
+      values.commandBuffer.trim();
+    }
+  }
+  file.close();
+  cache = values; // Use the values even if the journal cannot be written
+  cached = true;
+  if (compact(values)) {
+    SPIFFS.remove(CONFIG_TEXT);
+    LOG_INFO("Config migrated from " CONFIG_TEXT " to the journal.\n");
+  }
+  return true;
+}
+
+bool ConfigStore::hasValues() {
+  std::lock_guard<std::mutex> guard(lock);
+  return cached;
+}
+
+ConfigValues ConfigStore::values() {
+  std::lock_guard<std::mutex> guard(lock);
+  return cache;
+}
+
+bool ConfigStore::append(const ConfigValues &values) {
+  size_t size;
+  std::unique_ptr<uint8_t[]> record = encodeRecord(values, sequence + 1, size);
+  File file = SPIFFS.open(CONFIG_JOURNAL, FILE_APPEND);
+  bool written = file && file.write(record.get(), size) == size;
+  if (file) {
+    file.close();
+  }
+  if (!written) {
+    return compact(values); // Never append after a torn record
+  }
+  sequence++;
+  journalBytes += size;
+  return true;
+}
+
+// Replace the journal with a single record: the new file is complete before the old one goes.
+bool ConfigStore::compact(const ConfigValues &values) {
+  size_t size;
+  std::unique_ptr<uint8_t[]> record = encodeRecord(values, sequence + 1, size);
+  File file = SPIFFS.open(CONFIG_JOURNAL_NEW, FILE_WRITE);
+  bool written = file && file.write(record.get(), size) == size;
+  if (file) {
+    file.close();
+  }
+  if (!written) {
+    SPIFFS.remove(CONFIG_JOURNAL_NEW);
+    return false;
+  }
+  SPIFFS.remove(CONFIG_JOURNAL); // SPIFFS cannot rename onto an existing file
+  if (!SPIFFS.rename(CONFIG_JOURNAL_NEW, CONFIG_JOURNAL)) {
+    return false;
+  }
+  sequence++;
+  journalBytes = size;
+  return true;
+}
+
+SaveResult ConfigStore::save(const ConfigValues &values) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (cached && sameValues(values, cache)) {
+    return CONFIG_UNCHANGED; // Nothing dirty: no flash write at all
+  }
+  if (values.commandBuffer.length() > MaxBufferLength) {
+    LOG_ERROR("Command buffer too long to save (%u characters).\n", (unsigned)values.commandBuffer.length());
+    return CONFIG_FAILED;
+  }
+  size_t recordSize = sizeof(RecordHeader) + sizeof(ConfigFields) + values.commandBuffer.length();
+  bool ok = journalBytes + recordSize > CONFIG_JOURNAL_LIMIT ? compact(values) : append(values);
+  if (!ok) {
+    LOG_ERROR("Failed to write the config journal.\n");
+    return CONFIG_FAILED;
+  }
+  cache = values;
+  cached = true;
+  LOG_INFO("Values saved (save #%u, journal %u bytes).\n", (unsigned)sequence, (unsigned)journalBytes);
+  return CONFIG_SAVED;
+}
+
+bool ConfigStore::erase() {
+  std::lock_guard<std::mutex> guard(lock);
+  SPIFFS.remove(CONFIG_JOURNAL_NEW);
+  SPIFFS.remove(CONFIG_TEXT);
+  bool removed = !SPIFFS.exists(CONFIG_JOURNAL) || SPIFFS.remove(CONFIG_JOURNAL);
+  if (removed) {
+    cached = false;
+    journalBytes = 0;
+  }
+  return removed;
+}
+
+String ConfigStore::describe() {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!cached) {
+    return "No saved values.\n";
+  }
+  char text[400];
+  snprintf(text, sizeof(text),
+           "XSpeed:%d\nZSpeed:%d\nXAccel:%d\nZAccel:%d\nXJerk:%d\nZJerk:%d\nglobalXValue:%d\nglobalDelayMs:%d\nServoSpeed:%d\nOptimize:%d\n",
+           (int)cache.xFeedrate, (int)cache.zFeedrate, (int)cache.xAccel, (int)cache.zAccel, (int)cache.xJerk, (int)cache.zJerk,
+           (int)cache.globalXValue, (int)cache.globalDelayMs, (int)cache.servoDegPerSecond, cache.optimize ? 1 : 0);
+  String description = text;
+  description += "CommandBuffer:" + cache.commandBuffer + "\n";
+  snprintf(text, sizeof(text), "\nSave #%u, journal %s: %u bytes\n", (unsigned)sequence, CONFIG_JOURNAL, (unsigned)journalBytes);
+  description += text;
+  return description;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <mutex>
+
+// Everything /saveValues stores
+struct ConfigValues {
+  int32_t xFeedrate;
+  int32_t zFeedrate;
+  int32_t xAccel;
+  int32_t zAccel;
+  int32_t xJerk;
+  int32_t zJerk;
+  int32_t globalXValue;
+  int32_t globalDelayMs;
+  int32_t servoDegPerSecond;
+  bool optimize;
+  String commandBuffer;
+};
+
+enum SaveResult { CONFIG_SAVED, CONFIG_UNCHANGED, CONFIG_FAILED };
+
+// Crash-safe configuration on SPIFFS. Every save appends one versioned, CRC-checked record to a
+// journal (/config.jnl); loading takes the last intact record, so a power loss in the middle of
+// a save only loses that save. Saves that change nothing are skipped, and the journal is
+// compacted to its latest record (write-then-rename) once it grows past a few KB, so the flash
+// sees small appends instead of a full rewrite per save. The values are cached in RAM: after
+// begin() reads never touch flash. An old /config.txt is migrated into the journal once.
+// Safe to call from any task.
+class ConfigStore {
+public:
+  // Scan the journal (or migrate /config.txt, filling keys it lacks from 'defaults'); false
+  // when no values were saved yet.
+  bool begin(const ConfigValues &defaults);
+  // Last saved values; only meaningful while hasValues()
+  bool hasValues();
+  ConfigValues values();
+  SaveResult save(const ConfigValues &values);
+  // Remove the journal; the machine keeps running with its current values
+  bool erase();
+  // The cached values in the old config.txt format, with the journal state, for /viewConfig
+  String describe();
+
+private:
+  bool append(const ConfigValues &values);
+  bool compact(const ConfigValues &values);
+  bool migrate(const ConfigValues &defaults);
+
+  std::mutex lock; // Web handlers save while the loop task may read
+  ConfigValues cache = {};
+  bool cached = false;
+  uint32_t sequence = 0;     // Sequence number of the cached record
+  size_t journalBytes = 0;   // Size of the journal including the cached record
+};
+
+extern ConfigStore configStore;
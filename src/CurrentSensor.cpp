@@ -0,0 +1,43 @@
+#include "CurrentSensor.h"
+#include <Adafruit_INA260.h>
+#include <atomic>
+
+static Adafruit_INA260 ina260;
+static CurrentHandler currentHandler = nullptr;
+static TaskHandle_t currentTaskHandle = nullptr;
+static std::atomic<bool> sampleFast(false);
+
+static void currentTask(void *) {
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    float currentMa = ina260.readCurrent();
+    currentHandler(millis(), currentMa > 0 ? (uint32_t)currentMa : 0); // Only the magnitude drawn from the supply counts
+    if (sampleFast) {
+      vTaskDelayUntil(&wake, pdMS_TO_TICKS(CURRENT_SAMPLE_MS));
+    } else {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CURRENT_IDLE_SAMPLE_MS)); // Until the next job starts at the latest
+      wake = xTaskGetTickCount();
+    }
+  }
+}
+
+bool startCurrentSensor(CurrentHandler handler) {
+  if (!ina260.begin()) {
+    return false;
+  }
+  // 4 x 332 us of current and 4 x 140 us of voltage conversions: a fresh average every sample
+  ina260.setAveragingCount(INA260_COUNT_4);
+  ina260.setCurrentConversionTime(INA260_TIME_332_us);
+  ina260.setVoltageConversionTime(INA260_TIME_140_us);
+  ina260.setMode(INA260_MODE_CONTINUOUS);
+  currentHandler = handler;
+  xTaskCreate(currentTask, "current", CURRENT_TASK_STACK_SIZE, nullptr, CURRENT_TASK_PRIORITY, &currentTaskHandle);
+  return true;
+}
+
+void setCurrentSampling(bool jobRunning) {
+  sampleFast = jobRunning;
+  if (jobRunning && currentTaskHandle) {
+    xTaskNotifyGive(currentTaskHandle); // Counted if the task is still sampling: it then does not block at all
+  }
+}
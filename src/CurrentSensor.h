@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define CURRENT_TASK_PRIORITY 2     // Above the Arduino loop, below the async TCP and motion tasks
+#define CURRENT_TASK_STACK_SIZE 3072
+#define CURRENT_SAMPLE_MS 2         // Sample period while a job runs; the INA260 averages over most of it
+#define CURRENT_IDLE_SAMPLE_MS 500  // ... and between jobs, for the standstill current in /events
+
+// Motor supply current from the INA260 on the I2C bus, read by its own task so the bus
+// transfers never hold up the motion task or loop(). The handler is called in that task for
+// every sample, with millis() and the current in mA.
+typedef void (*CurrentHandler)(uint32_t timeMs, uint32_t currentMa);
+
+// False when no INA260 answers; nothing is sampled then.
+bool startCurrentSensor(CurrentHandler handler);
+// Sample every CURRENT_SAMPLE_MS while a job runs, else every CURRENT_IDLE_SAMPLE_MS. Switching
+// to the fast rate wakes the task, so the first sample of a job is not delayed.
+void setCurrentSampling(bool jobRunning);
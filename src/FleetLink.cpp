@@ -0,0 +1,152 @@
+#include "FleetLink.h"
+#include <SPIFFS.h>
+#include "Logger.h"
+
+#define FLEET_SETTINGS "/fleet.txt"
+#define FLEET_SETTINGS_NEW "/fleet.new"
+#define FLEET_OFFLINE "{\"state\":\"offline\"}" // Left retained on the status topic by the broker
+
+FleetLink fleetLink;
+
+bool FleetLink::load(const String &defaultName) {
+  config.name = defaultName;
+  if (!SPIFFS.exists(FLEET_SETTINGS) && SPIFFS.exists(FLEET_SETTINGS_NEW)) {
+    SPIFFS.rename(FLEET_SETTINGS_NEW, FLEET_SETTINGS); // Power was lost between removing the old file and renaming
+  } else if (SPIFFS.exists(FLEET_SETTINGS_NEW)) {
+    SPIFFS.remove(FLEET_SETTINGS_NEW); // Save that never finished; the old settings are intact
+  }
+  File file = SPIFFS.open(FLEET_SETTINGS, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  while (file.available()) {
+    String line = file.readStringUntil('\n');
+    line.trim();
+    int colon = line.indexOf(':');
+    if (colon <= 0) {
+      continue;
+    }
+    String key = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    if (key == "ssid") {
+      config.ssid = value;
+    } else if (key == "password") {
+      config.password = value;
+    } else if (key == "broker") {
+      config.broker = value;
+    } else if (key == "port") {
+      config.port = value.toInt() > 0 ? value.toInt() : FLEET_DEFAULT_PORT;
+    } else if (key == "name" && validName(value)) {
+      config.name = value;
+    }
+  }
+  file.close();
+  enabled = config.ssid.length() > 0 && config.broker.length() > 0;
+  return enabled;
+}
+
+bool FleetLink::save(const FleetSettings &settings, String &error) {
+  if (!validName(settings.name)) {
+    error = "Machine names are 1-31 letters, digits, '-' or '_'";
+    return false;
+  }
+  File file = SPIFFS.open(FLEET_SETTINGS_NEW, FILE_WRITE);
+  bool written = file && file.printf("ssid:%s\npassword:%s\nbroker:%s\nport:%u\nname:%s\n", settings.ssid.c_str(),
+                                     settings.password.c_str(), settings.broker.c_str(), (unsigned)settings.port,
+                                     settings.name.c_str()) > 0;
+  if (file) {
+    file.close();
+  }
+  if (!written) {
+    SPIFFS.remove(FLEET_SETTINGS_NEW); // The old settings stay
+    error = "Failed to write " FLEET_SETTINGS;
+    return false;
+  }
+  SPIFFS.remove(FLEET_SETTINGS); // SPIFFS cannot rename onto an existing file
+  if (!SPIFFS.rename(FLEET_SETTINGS_NEW, FLEET_SETTINGS)) {
+    error = "Failed to write " FLEET_SETTINGS; // load() picks up the new file on the next boot
+    return false;
+  }
+  return true;
+}
+
+void FleetLink::begin(FleetMessageHandler messageHandler) {
+  handler = messageHandler;
+  WiFi.mode(WIFI_AP_STA);
+  WiFi.begin(config.ssid.c_str(), config.password.c_str()); // Reconnects by itself from now on
+  mqtt.setServer(config.broker.c_str(), config.port);
+  mqtt.setCallback(onMessage);
+  mqtt.setBufferSize(FLEET_MESSAGE_SIZE);
+  mqtt.setKeepAlive(FLEET_KEEPALIVE_S);
+  mqtt.setSocketTimeout(FLEET_SOCKET_TIMEOUT_S);
+  LOG_INFO("Fleet: joining %s, broker %s:%u as %s.\n", config.ssid.c_str(), config.broker.c_str(), (unsigned)config.port,
+           config.name.c_str());
+}
+
+void FleetLink::poll(bool mayConnect) {
+  if (!enabled) {
+    return;
+  }
+  if (mqtt.connected()) {
+    mqtt.loop();
+  } else if (WiFi.status() == WL_CONNECTED && mayConnect && (!attempted || millis() - lastAttemptMs >= FLEET_RETRY_MS)) {
+    attempted = true;
+    lastAttemptMs = millis();
+    connect();
+  }
+  bool up = mqtt.connected();
+  if (online && !up) {
+    LOG_WARN("Fleet: lost the broker (state %d).\n", mqtt.state());
+  }
+  online = up;
+}
+
+bool FleetLink::connect() {
+  String clientId = String(FLEET_TOPIC_ROOT "-") + config.name;
+  String status = topic("status");
+  if (!mqtt.connect(clientId.c_str(), status.c_str(), 0, true, FLEET_OFFLINE)) {
+    LOG_WARN("Fleet: broker %s:%u not reachable (state %d), retrying in %u s.\n", config.broker.c_str(), (unsigned)config.port,
+             mqtt.state(), (unsigned)(FLEET_RETRY_MS / 1000));
+    return false;
+  }
+  mqtt.subscribe(topic("job").c_str());
+  mqtt.subscribe(topic("cancel").c_str());
+  LOG_INFO("Fleet: connected to %s:%u as %s.\n", config.broker.c_str(), (unsigned)config.port, config.name.c_str());
+  return true;
+}
+
+bool FleetLink::publish(const char *leaf, const char *payload, bool retained) {
+  return mqtt.connected() && mqtt.publish(topic(leaf).c_str(), payload, retained);
+}
+
+String FleetLink::describe() const {
+  if (!enabled) {
+    return "Fleet mode off: no network and broker set.";
+  }
+  return String("Fleet ") + config.name + ": network " + config.ssid + (WiFi.status() == WL_CONNECTED ? " joined" : " not joined") +
+         ", broker " + config.broker + ":" + String(config.port) + (online ? " connected." : " not connected.");
+}
+
+bool FleetLink::validName(const String &name) {
+  if (name.length() == 0 || name.length() > 31) {
+    return false;
+  }
+  for (size_t i = 0; i < name.length(); i++) {
+    char c = name[i];
+    if (!isalnum((unsigned char)c) && c != '-' && c != '_') {
+      return false; // Keeps '/', '+' and '#' out of the topics
+    }
+  }
+  return true;
+}
+
+String FleetLink::topic(const char *leaf) const {
+  return String(FLEET_TOPIC_ROOT "/") + config.name + "/" + leaf;
+}
+
+void FleetLink::onMessage(char *topic, uint8_t *payload, unsigned int length) {
+  const char *leaf = strrchr(topic, '/');
+  if (fleetLink.handler && leaf) {
+    fleetLink.handler(leaf + 1, (const char *)payload, length);
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <atomic>
+
+#define FLEET_TOPIC_ROOT "bender"   // Topics are bender/<name>/<leaf>
+#define FLEET_MESSAGE_SIZE 4608     // Largest MQTT packet: a 4 KB program, its header line and the topic
+#define FLEET_RETRY_MS 10000        // Broker reconnect interval
+#define FLEET_KEEPALIVE_S 15
+#define FLEET_SOCKET_TIMEOUT_S 2    // Longest wait for the broker's answer while connecting
+#define FLEET_DEFAULT_PORT 1883
+
+// Where the machine finds its fleet: a WiFi network to join as a station and an MQTT broker on
+// it. Stored in /fleet.txt as key:value lines.
+struct FleetSettings {
+  String ssid;
+  String password;
+  String broker;   // Host name or IP address
+  uint16_t port;
+  String name;     // Machine name in the topics, unique in the fleet
+};
+
+// A message on one of the machine's own topics: 'leaf' is the last topic level ("job", "cancel")
+typedef void (*FleetMessageHandler)(const char *leaf, const char *payload, size_t length);
+
+// Station mode WiFi and the MQTT client of a machine in a fleet. The soft AP stays up next to
+// the station, so the web UI keeps working when the network or broker does not. Everything but
+// describe() and save() runs in the loop task; the client subscribes to bender/<name>/job and
+// bender/<name>/cancel and leaves bender/<name>/status retained as {"state":"offline"} when the
+// connection drops.
+class FleetLink {
+public:
+  // Read /fleet.txt, 'defaultName' naming the machine unless the file does; false when the
+  // machine has no network or broker to join.
+  bool load(const String &defaultName);
+  // Write /fleet.txt (write-then-rename; load() finishes an interrupted rename); used from the
+  // next boot on
+  bool save(const FleetSettings &settings, String &error);
+  bool configured() const { return enabled; }
+  const FleetSettings &settings() const { return config; }
+
+  // Join the network; messages are delivered to 'handler' from poll()
+  void begin(FleetMessageHandler handler);
+  // Deliver messages and keep the connection up. A reconnect blocks for up to a few seconds
+  // while the broker does not answer, so it is only tried when 'mayConnect'.
+  void poll(bool mayConnect);
+  bool connected() const { return online; }
+  bool publish(const char *leaf, const char *payload, bool retained = false);
+
+  // Settings (without the password) and connection state, for /fleet and $FLEET
+  String describe() const;
+
+  static bool validName(const String &name);
+
+private:
+  bool connect();
+  String topic(const char *leaf) const;
+  static void onMessage(char *topic, uint8_t *payload, unsigned int length);
+
+  FleetSettings config = { "", "", "", FLEET_DEFAULT_PORT, "" };
+  bool enabled = false;
+  FleetMessageHandler handler = nullptr;
+  WiFiClient client;
+  PubSubClient mqtt{client};
+  uint32_t lastAttemptMs = 0;
+  bool attempted = false;
+  std::atomic<bool> online{false}; // Read by the web task for /fleet
+};
+
+extern FleetLink fleetLink;
@@ -0,0 +1,47 @@
+#include "Logger.h"
+
+std::atomic<uint8_t> logLevel(LEVEL_INFO);
+static LogRing<LOG_SLOTS, LOG_LINE_SIZE> logRing;
+static TaskHandle_t logTaskHandle = nullptr;
+
+void vlogMessage(LogLevel level, const char *format, va_list args) {
+  if (level <= logLevel.load(std::memory_order_relaxed)) {
+    logRing.vwrite(format, args);
+    if (logTaskHandle) {
+      xTaskNotifyGive(logTaskHandle); // Also when the message was dropped, so the drop gets reported
+    }
+  }
+}
+
+void logMessage(LogLevel level, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  vlogMessage(level, format, args);
+  va_end(args);
+}
+
+uint32_t logDropped() {
+  return logRing.dropped();
+}
+
+// The only consumer of the ring; it is the only task that may block on Serial for log output.
+static void logTask(void *) {
+  uint32_t reportedDrops = 0;
+  for (;;) {
+    const char *line;
+    while ((line = logRing.front()) != nullptr) {
+      Serial.print(line);
+      logRing.pop();
+    }
+    uint32_t drops = logRing.dropped();
+    if (drops != reportedDrops) {
+      Serial.printf("Log buffer full: %u messages dropped.\n", (unsigned)(drops - reportedDrops));
+      reportedDrops = drops;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Until the next message
+  }
+}
+
+void startLogTask() {
+  xTaskCreate(logTask, "log", LOG_TASK_STACK_SIZE, nullptr, LOG_TASK_PRIORITY, &logTaskHandle);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "LogRing.h"
+
+#define LOG_TASK_PRIORITY 1     // Same as the Arduino loop, below the async TCP and motion tasks
+#define LOG_TASK_STACK_SIZE 3072
+#define LOG_SLOTS 32            // Messages the ring holds before new ones are dropped
+#define LOG_LINE_SIZE 160       // Longest message, including the line break
+
+// Asynchronous logger. Messages are formatted by the caller into a lock-free ring (LogRing) and
+// written to Serial by a low-priority task, so a slow or stalled serial host never holds up
+// motion or the web server. The task sleeps until a message is written. When the ring is full,
+// messages are dropped and counted. Not for use in interrupts.
+void startLogTask();
+void logMessage(LogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void vlogMessage(LogLevel level, const char *format, va_list args);
+uint32_t logDropped(); // Messages dropped since boot
+
+// Runtime level: messages above it are discarded before they are formatted
+extern std::atomic<uint8_t> logLevel;
+
+// Whether messages of 'level' are kept, for work that only feeds a log message
+inline bool logEnabled(LogLevel level) {
+  return level <= LOG_COMPILED_LEVEL && level <= logLevel.load(std::memory_order_relaxed);
+}
+
+// Levels above LOG_COMPILED_LEVEL compile to nothing, format string included
+#define LOG_AT(level, ...) do { if ((level) <= LOG_COMPILED_LEVEL) logMessage(level, __VA_ARGS__); } while (0)
+#define LOG_ERROR(...) LOG_AT(LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LEVEL_DEBUG, __VA_ARGS__)
@@ -0,0 +1,33 @@
+#include "MotionTask.h"
+
+static TaskHandle_t motionTaskHandle = nullptr;
+static bool (*motionExecutor)() = nullptr;
+
+static void motionTask(void *) {
+  for (;;) {
+    bool busy = motionExecutor();
+    // Sleep until woken or the next poll; while idle only a wake-up brings new work
+    ulTaskNotifyTake(pdTRUE, busy ? pdMS_TO_TICKS(MOTION_TASK_POLL_MS) : portMAX_DELAY);
+  }
+}
+
+void startMotionTask(bool (*executor)()) {
+  motionExecutor = executor;
+  xTaskCreate(motionTask, "motion", MOTION_TASK_STACK_SIZE, nullptr, MOTION_TASK_PRIORITY, &motionTaskHandle);
+}
+
+void wakeMotionTask() {
+  if (motionTaskHandle) {
+    xTaskNotifyGive(motionTaskHandle);
+  }
+}
+
+void IRAM_ATTR wakeMotionTaskFromISR() {
+  if (motionTaskHandle) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(motionTaskHandle, &woken);
+    if (woken) {
+      portYIELD_FROM_ISR();
+    }
+  }
+}
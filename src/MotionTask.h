@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define MOTION_TASK_PRIORITY 5     // Above the Arduino loop (1) and the async TCP task (3)
+#define MOTION_TASK_STACK_SIZE 4096
+#define MOTION_TASK_POLL_MS 1      // Longest sleep between executor passes of a job without a wake-up
+
+// Runs the command executor in its own FreeRTOS task so serial input, web requests and logging
+// can never hold up motion. The task calls 'executor' repeatedly and sleeps between passes
+// until it is woken or MOTION_TASK_POLL_MS passes; the executor itself must never block. When
+// 'executor' returns false (nothing queued, moving or waiting for a deadline) the task sleeps
+// until it is woken, so everything that gives the executor work must wake it.
+void startMotionTask(bool (*executor)());
+
+// Wake the motion task early, e.g. after queueing commands or requesting a stop.
+void wakeMotionTask();
+// Same from an interrupt, e.g. the step engine completion callback.
+void wakeMotionTaskFromISR();
@@ -0,0 +1,58 @@
+#include "PowerSave.h"
+#include <esp_pm.h>
+#include "Logger.h"
+
+static TaskHandle_t loopTaskHandle = nullptr;
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t fullSpeedLock = nullptr;
+#endif
+
+#if ARDUINO_USB_CDC_ON_BOOT
+static void onSerialEvent(void *, esp_event_base_t, int32_t, void *) {
+  wakeLoop();
+}
+#endif
+
+void startPowerSave() {
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+#if ARDUINO_USB_CDC_ON_BOOT
+  Serial.onEvent(ARDUINO_USB_CDC_RX_EVENT, onSerialEvent); // Native USB port (QT Py ESP32-S2)
+#else
+  Serial.onReceive(wakeLoop);
+#endif
+
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32s2_t config = { POWER_MAX_MHZ, POWER_MIN_MHZ, POWER_LIGHT_SLEEP };
+  esp_err_t error = esp_pm_configure(&config);
+  if (error == ESP_OK) {
+    error = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "job", &fullSpeedLock); // Also keeps light sleep off
+  }
+  if (error != ESP_OK) {
+    LOG_WARN("Power management off (error %d): the CPU runs at full clock between jobs.\n", (int)error);
+  }
+#else
+  LOG_INFO("Built without CONFIG_PM_ENABLE: the CPU only halts between events, at full clock.\n");
+#endif
+}
+
+void waitForLoopEvent(uint32_t timeoutMs) {
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+}
+
+void wakeLoop() {
+  if (loopTaskHandle) {
+    xTaskNotifyGive(loopTaskHandle);
+  }
+}
+
+void holdFullSpeed(bool hold) {
+#if CONFIG_PM_ENABLE
+  if (fullSpeedLock) {
+    if (hold) {
+      esp_pm_lock_acquire(fullSpeedLock);
+    } else {
+      esp_pm_lock_release(fullSpeedLock);
+    }
+  }
+#endif
+}
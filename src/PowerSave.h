@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define POWER_MAX_MHZ 240      // CPU clock while a job runs
+#define POWER_MIN_MHZ 80       // ... and between jobs; the APB clock (step timer, servo PWM) stays at 80 MHz
+#ifndef POWER_LIGHT_SLEEP
+#define POWER_LIGHT_SLEEP 0    // Automatic light sleep between jobs: stops the native USB port and the servo pulses
+#endif
+
+// Low-power idle. loop() sleeps in waitForLoopEvent() until serial input arrives, the machine
+// state changes or the timeout passes, so the idle task can halt the CPU between events, and
+// with CONFIG_PM_ENABLE the clock drops to POWER_MIN_MHZ between jobs. holdFullSpeed(true)
+// keeps it at POWER_MAX_MHZ (and awake) while a job runs, for the step interrupt's latency.
+
+// Set up power management and the serial wake-up; call from setup(), which runs in the loop task.
+void startPowerSave();
+// Block loop() until wakeLoop() or 'timeoutMs'
+void waitForLoopEvent(uint32_t timeoutMs);
+// Wake loop() early, from any task
+void wakeLoop();
+void holdFullSpeed(bool hold);
@@ -0,0 +1,270 @@
+#include "ProgramLibrary.h"
+
+#include <memory>
+#include "Logger.h"
+
+#define LIBRARY_INDEX "/lib/index"
+#define LIBRARY_INDEX_NEW "/lib/index.new"
+
+const uint32_t ProgramMagic = 0x47525042; // "BPRG"
+const uint32_t IndexMagic = 0x58444942;   // "BIDX"
+// Bump when Instruction or the opcodes change: programs stored before are then compiled again
+// from their source when they are loaded.
+const uint16_t InstructionFormat = 1;
+
+// Program file: header, source text, compiled instructions. The header and the source never
+// change layout, so the source can always be found again.
+struct ProgramHeader {
+  uint32_t magic;
+  uint16_t format;       // InstructionFormat the program was compiled with
+  uint16_t count;        // Compiled instructions
+  uint32_t sourceLength; // Bytes of source text
+  uint32_t checksum;     // Of the compiled instructions
+};
+
+struct IndexHeader {
+  uint32_t magic;
+  uint32_t count;
+};
+
+ProgramLibrary programLibrary;
+
+// FNV-1a: cheap enough to check every load
+static uint32_t checksum(const void *data, size_t size) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+// Read an index file into 'entries'; false if it is missing or incomplete.
+static bool readIndex(const char *path, ProgramLibrary::Entry *entries, size_t &count) {
+  File file = SPIFFS.open(path, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  IndexHeader header;
+  bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == IndexMagic &&
+            header.count <= (uint32_t)LibrarySize &&
+            file.read((uint8_t *)entries, header.count * sizeof(ProgramLibrary::Entry)) == header.count * sizeof(ProgramLibrary::Entry);
+  file.close();
+  count = ok ? header.count : 0;
+  return ok;
+}
+
+String ProgramLibrary::path(uint16_t id) {
+  return "/lib/" + String(id) + ".prg";
+}
+
+void ProgramLibrary::begin() {
+  std::lock_guard<std::mutex> guard(lock);
+  if (readIndex(LIBRARY_INDEX, entries, count)) {
+    SPIFFS.remove(LIBRARY_INDEX_NEW); // Left over from an update that never replaced the index
+  } else if (readIndex(LIBRARY_INDEX_NEW, entries, count)) {
+    SPIFFS.rename(LIBRARY_INDEX_NEW, LIBRARY_INDEX); // Power was lost between removing the old index and renaming
+  }
+  LOG_INFO("Program library: %u programs.\n", (unsigned)count);
+}
+
+// Write the index to a new file first, so a power loss leaves either the old or the new one.
+bool ProgramLibrary::writeIndex() {
+  File file = SPIFFS.open(LIBRARY_INDEX_NEW, FILE_WRITE);
+  if (!file) {
+    return false;
+  }
+  IndexHeader header = { IndexMagic, (uint32_t)count };
+  size_t bytes = count * sizeof(Entry);
+  bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            file.write((const uint8_t *)entries, bytes) == bytes;
+  file.close();
+  if (!ok) {
+    SPIFFS.remove(LIBRARY_INDEX_NEW);
+    return false;
+  }
+  SPIFFS.remove(LIBRARY_INDEX); // SPIFFS cannot rename onto an existing file
+  return SPIFFS.rename(LIBRARY_INDEX_NEW, LIBRARY_INDEX);
+}
+
+bool ProgramLibrary::validName(const char *name) {
+  size_t length = strlen(name);
+  if (length == 0 || length >= (size_t)ProgramNameSize) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_') {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ProgramLibrary::find(const char *name) const {
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(entries[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool ProgramLibrary::save(const char *name, const char *source, size_t length, const Instruction *program, size_t programCount,
+                          String &error) {
+  if (!validName(name)) {
+    error = "Program names are 1-" + String(ProgramNameSize - 1) + " letters, digits, '-' or '_'";
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  int existing = find(name);
+  if (existing < 0 && count == (size_t)LibrarySize) {
+    error = "Program library full (" + String(LibrarySize) + " programs)";
+    return false;
+  }
+
+  // Lowest file number not in use, so the old file stays valid until the index points elsewhere
+  auto inUse = [this](uint16_t id) {
+    for (size_t i = 0; i < count; i++) {
+      if (entries[i].id == id) {
+        return true;
+      }
+    }
+    return false;
+  };
+  uint16_t id = 0;
+  while (inUse(id)) {
+    id++;
+  }
+
+  ProgramHeader header = { ProgramMagic, InstructionFormat, (uint16_t)programCount, (uint32_t)length,
+                           checksum(program, programCount * sizeof(Instruction)) };
+  File file = SPIFFS.open(path(id), FILE_WRITE);
+  size_t bytes = programCount * sizeof(Instruction);
+  bool written = file && file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+                 file.write((const uint8_t *)source, length) == length && file.write((const uint8_t *)program, bytes) == bytes;
+  if (file) {
+    file.close();
+  }
+  if (!written) {
+    SPIFFS.remove(path(id));
+    error = "Could not write the program (file system full?)";
+    return false;
+  }
+
+  Entry entry = {};
+  strcpy(entry.name, name);
+  entry.id = id;
+  entry.count = programCount;
+  entry.sourceLength = length;
+  Entry replaced = existing >= 0 ? entries[existing] : entry;
+  entries[existing >= 0 ? existing : count] = entry;
+  if (existing < 0) {
+    count++;
+  }
+  if (!writeIndex()) {
+    // Back to the old index in RAM; the file on flash is still the old one or missing
+    if (existing >= 0) {
+      entries[existing] = replaced;
+    } else {
+      count--;
+    }
+    SPIFFS.remove(path(id));
+    error = "Could not write the program index";
+    return false;
+  }
+  if (existing >= 0) {
+    SPIFFS.remove(path(replaced.id));
+  }
+  LOG_INFO("Program '%s' saved: %u commands.\n", name, (unsigned)programCount);
+  return true;
+}
+
+int ProgramLibrary::load(const char *name, Instruction *out, size_t capacity, const ProgramLimits &limits, String &error) {
+  std::lock_guard<std::mutex> guard(lock);
+  int index = find(name);
+  if (index < 0) {
+    error = "No program named '" + String(name) + "'";
+    return -1;
+  }
+  File file = SPIFFS.open(path(entries[index].id), FILE_READ);
+  ProgramHeader header;
+  if (!file || file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != ProgramMagic) {
+    error = "Program '" + String(name) + "' is damaged";
+    return -1;
+  }
+  size_t bytes = header.count * sizeof(Instruction);
+  if (header.format == InstructionFormat && header.count <= capacity && file.seek(sizeof(header) + header.sourceLength) &&
+      file.read((uint8_t *)out, bytes) == bytes && checksum(out, bytes) == header.checksum) {
+    file.close();
+    return header.count; // Fast path: no parsing at all
+  }
+
+  // Saved by a firmware with another instruction format, or damaged: compile the source again
+  std::unique_ptr<char[]> source(new char[header.sourceLength + 1]);
+  bool read = file.seek(sizeof(header)) && file.read((uint8_t *)source.get(), header.sourceLength) == header.sourceLength;
+  file.close();
+  if (!read) {
+    error = "Program '" + String(name) + "' is damaged";
+    return -1;
+  }
+  CompileError compileError;
+  int compiled = compileProgram(source.get(), header.sourceLength, limits, out, capacity, compileError);
+  if (compiled < 0) {
+    error = "Program '" + String(name) + "' no longer compiles: command " + String(compileError.command) + ": " + compileError.message;
+    return -1;
+  }
+  LOG_INFO("Program '%s' compiled again from its source.\n", name);
+  return compiled;
+}
+
+bool ProgramLibrary::readSource(const char *name, String &source, String &error) {
+  std::lock_guard<std::mutex> guard(lock);
+  int index = find(name);
+  if (index < 0) {
+    error = "No program named '" + String(name) + "'";
+    return false;
+  }
+  File file = SPIFFS.open(path(entries[index].id), FILE_READ);
+  ProgramHeader header;
+  if (!file || file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != ProgramMagic) {
+    error = "Program '" + String(name) + "' is damaged";
+    return false;
+  }
+  std::unique_ptr<char[]> text(new char[header.sourceLength + 1]);
+  bool read = file.read((uint8_t *)text.get(), header.sourceLength) == header.sourceLength;
+  file.close();
+  if (!read) {
+    error = "Program '" + String(name) + "' is damaged";
+    return false;
+  }
+  text[header.sourceLength] = '\0';
+  source = text.get();
+  return true;
+}
+
+bool ProgramLibrary::remove(const char *name, String &error) {
+  std::lock_guard<std::mutex> guard(lock);
+  int index = find(name);
+  if (index < 0) {
+    error = "No program named '" + String(name) + "'";
+    return false;
+  }
+  Entry removed = entries[index];
+  entries[index] = entries[--count];
+  if (!writeIndex()) {
+    entries[count++] = entries[index];
+    entries[index] = removed;
+    error = "Could not write the program index";
+    return false;
+  }
+  SPIFFS.remove(path(removed.id));
+  LOG_INFO("Program '%s' deleted.\n", name);
+  return true;
+}
+
+size_t ProgramLibrary::list(Entry *out, size_t capacity) {
+  std::lock_guard<std::mutex> guard(lock);
+  size_t n = count < capacity ? count : capacity;
+  memcpy(out, entries, n * sizeof(Entry));
+  return n;
+}
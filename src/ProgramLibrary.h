@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <mutex>
+#include "Program.h"
+
+const int LibrarySize = 32;        // Programs the library holds
+const int ProgramNameSize = 24;    // Longest name plus the terminator
+
+// Named part programs on SPIFFS. Every program is stored compiled, next to its source text, in
+// its own file (/lib/<id>.prg); /lib/index lists them and is kept in RAM, so listing needs no
+// flash access and running a program is one read of its instructions straight into a program
+// buffer, with no parsing. A program saved by an older firmware with a different instruction
+// format is compiled again from its source when it is loaded. Safe to call from any task.
+class ProgramLibrary {
+public:
+  struct Entry {
+    char name[ProgramNameSize];
+    uint16_t id;            // File number
+    uint16_t count;         // Compiled instructions
+    uint32_t sourceLength;  // Bytes of source text
+  };
+
+  // Read the index; an index lost in the middle of an update is recovered from its copy.
+  void begin();
+
+  // Store a compiled program with its source under 'name'. A program of the same name is only
+  // replaced once the new one is written. Names are 1-23 letters, digits, '-' or '_'.
+  bool save(const char *name, const char *source, size_t length, const Instruction *program, size_t programCount, String &error);
+  // Copy the compiled program into 'out'; returns the instruction count or -1 with 'error' set.
+  // 'limits' are only used when the program has to be compiled again from its source.
+  int load(const char *name, Instruction *out, size_t capacity, const ProgramLimits &limits, String &error);
+  bool readSource(const char *name, String &source, String &error);
+  bool remove(const char *name, String &error);
+
+  // Copy of the index, for listing; returns the number of programs
+  size_t list(Entry *entries, size_t capacity);
+
+  static bool validName(const char *name);
+
+private:
+  int find(const char *name) const;
+  bool writeIndex();
+  static String path(uint16_t id);
+
+  std::mutex lock; // Web handlers and the serial reader run in different tasks
+  Entry entries[LibrarySize];
+  size_t count = 0;
+};
+
+extern ProgramLibrary programLibrary;
@@ -0,0 +1,207 @@
+#include "StepperEngine.h"
+
+#define STEP_TIMER_NUM 0       // Hardware timer group 0, timer 0
+#define STEP_TIMER_DIVIDER 80  // 80 MHz APB clock / 80 = 1 MHz (StepTimerHz)
+
+StepperEngine stepperEngine;
+
+void StepperEngine::begin() {
+  XAxis::begin();
+  ZAxis::begin();
+  timer = timerBegin(STEP_TIMER_NUM, STEP_TIMER_DIVIDER, true);
+  timerAttachInterrupt(timer, &StepperEngine::onTimer, true);
+  timerAlarmDisable(timer);
+}
+
+void IRAM_ATTR StepperEngine::loadPlan(int slot) {
+  activeSlot = slot;
+  generator.begin(plans[slot]);
+  moveStartUs = micros();
+  scheduledTicks = DirSetupTicks; // Every move starts with the direction setup alarm
+  activeMask = generator.axisMask();
+  activePulseBits = 0;
+  uint32_t high = 0;
+  uint32_t low = 0;
+  for (int axis = 0; axis < AxisCount; axis++) {
+    if (activeMask & (1 << axis)) {
+      activePulseBits |= pulseBits[axis];
+      uint32_t direction = (generator.forwardMask() & (1 << axis)) ? forwardBits[axis] : directionBits[axis] & ~forwardBits[axis];
+      high |= direction;
+      low |= directionBits[axis] & ~direction;
+    }
+  }
+  GpioBank::write(high, low | activePulseBits); // Direction is set before the first edge
+}
+
+bool StepperEngine::queue(const MotionPlan &motionPlan) {
+  if (timer == nullptr || nextReady) {
+    return false;
+  }
+  if (motionPlan.steps == 0) {
+    return true; // Nothing to move
+  }
+
+  // The interrupt only reads the active slot, so the free one can be filled without locking
+  int freeSlot = 1 - activeSlot;
+  plans[freeSlot] = motionPlan;
+
+  portENTER_CRITICAL(&mux);
+  if (busy) {
+    nextReady = true; // The interrupt picks it up when the running move ends
+    portEXIT_CRITICAL(&mux);
+    return true;
+  }
+  loadPlan(freeSlot);
+  busy = true;
+  portEXIT_CRITICAL(&mux);
+
+  timerWrite(timer, 0);
+  timerAlarmWrite(timer, DirSetupTicks, true); // First edge after the direction setup time
+  timerAlarmEnable(timer);
+  return true;
+}
+
+void StepperEngine::stop() {
+  if (timer == nullptr) {
+    return;
+  }
+  portENTER_CRITICAL(&mux);
+  timerAlarmDisable(timer);
+  nextReady = false;
+  busy = false;
+  holding = false;
+  paused = false;
+  generator.setLimitRamp(nullptr, 0, 0);
+  GpioBank::write(0, activePulseBits); // Never leave a pulse pin high
+  portEXIT_CRITICAL(&mux);
+}
+
+bool StepperEngine::progress(MotionProgress &progress) {
+  uint32_t halfPeriod;
+  portENTER_CRITICAL(&mux);
+  bool running = busy;
+  progress.runningId = plans[activeSlot].id;
+  progress.stepsDone = generator.stepsDone();
+  progress.buffered = nextReady;
+  progress.bufferedId = plans[1 - activeSlot].id;
+  halfPeriod = paused ? 0 : generator.currentHalfPeriod();
+  portEXIT_CRITICAL(&mux);
+  progress.rate = halfPeriod ? StepTimerHz / (2 * halfPeriod) : 0;
+  return running;
+}
+
+bool StepperEngine::retime(uint32_t fromStep, const MotionPlan &profile) {
+  portENTER_CRITICAL(&mux);
+  bool running = busy && plans[activeSlot].id == profile.id && generator.stepsDone() >= fromStep;
+  if (running) {
+    plans[activeSlot] = profile; // The generator keeps the move's steps; only the profile is read again
+    generator.retime(plans[activeSlot], fromStep);
+  }
+  portEXIT_CRITICAL(&mux);
+  return running;
+}
+
+bool StepperEngine::replaceQueued(const MotionPlan &motionPlan) {
+  portENTER_CRITICAL(&mux);
+  bool buffered = nextReady && plans[1 - activeSlot].id == motionPlan.id;
+  if (buffered) {
+    plans[1 - activeSlot] = motionPlan; // The interrupt only reads it when chaining, under the lock
+  }
+  portEXIT_CRITICAL(&mux);
+  return buffered;
+}
+
+bool StepperEngine::hold(const MotionPlan &ramp) {
+  portENTER_CRITICAL(&mux);
+  bool running = busy && !paused;
+  if (running) {
+    memcpy(limitTable, ramp.decelTable, sizeof(limitTable));
+    generator.setLimitRamp(limitTable, ramp.decelIndexStep, ramp.decelSteps);
+    holding = true; // onTimer() pauses once the ramp is done
+  }
+  portEXIT_CRITICAL(&mux);
+  return running;
+}
+
+bool StepperEngine::resume(const MotionPlan &ramp) {
+  portENTER_CRITICAL(&mux);
+  bool restart = busy && paused;
+  bool held = restart || holding;
+  if (held) {
+    memcpy(limitTable, ramp.accelTable, sizeof(limitTable));
+    generator.setLimitRamp(limitTable, ramp.accelIndexStep, ramp.accelSteps);
+    holding = false;
+    paused = false;
+  }
+  portEXIT_CRITICAL(&mux);
+  if (restart) {
+    timerWrite(timer, 0);
+    timerAlarmWrite(timer, DirSetupTicks, true);
+    timerAlarmEnable(timer);
+  }
+  return held;
+}
+
+uint32_t StepperEngine::rate() const {
+  uint32_t halfPeriod = busy && !paused ? generator.currentHalfPeriod() : 0;
+  return halfPeriod ? StepTimerHz / (2 * halfPeriod) : 0;
+}
+
+void IRAM_ATTR StepperEngine::onTimer() {
+  StepperEngine &engine = stepperEngine;
+  uint32_t latency = (uint32_t)timerRead(engine.timer); // Auto-reload restarts the counter at the alarm
+  uint8_t pulseMask = 0;
+  portENTER_CRITICAL_ISR(&engine.mux);
+  if (engine.holding && engine.generator.limitRampDone() && engine.generator.betweenSteps()) {
+    // Feed hold ramp done: stop here with the move loaded, resume() restarts the timer
+    timerAlarmDisable(engine.timer);
+    engine.holding = false;
+    engine.paused = true;
+    portEXIT_CRITICAL_ISR(&engine.mux);
+    if (engine.completionCallback) {
+      engine.completionCallback();
+    }
+    return;
+  }
+  uint32_t next = engine.generator.onAlarm(pulseMask);
+  if (next == 0) {
+    engine.stats.moveActualUs.record(micros() - engine.moveStartUs);
+    engine.stats.movePlannedUs.record(engine.scheduledTicks);
+    if (engine.nextReady) {
+      // Chain the buffered move: it was planned to enter at the rate this one exits with
+      engine.nextReady = false;
+      engine.loadPlan(1 - engine.activeSlot);
+      timerAlarmWrite(engine.timer, DirSetupTicks, true);
+      portEXIT_CRITICAL_ISR(&engine.mux);
+      return;
+    }
+    timerAlarmDisable(engine.timer);
+    engine.busy = false;
+    engine.holding = false; // Ran out of moves during a hold ramp: stopped anyway
+    engine.generator.setLimitRamp(nullptr, 0, 0);
+    portEXIT_CRITICAL_ISR(&engine.mux);
+    if (engine.completionCallback) {
+      engine.completionCallback();
+    }
+    return;
+  }
+  // All pulse pins of the edge switch in one register write, so the axes step in lockstep
+  uint32_t high = 0;
+  for (int axis = 0; axis < AxisCount; axis++) {
+    if (pulseMask & (1 << axis)) {
+      high |= pulseBits[axis];
+    }
+  }
+  GpioBank::write(high, engine.activePulseBits & ~high);
+  for (int axis = 0; axis < AxisCount; axis++) {
+    if (pulseMask & (1 << axis)) {
+      engine.positions[axis] += (engine.generator.forwardMask() & (1 << axis)) ? 1 : -1;
+    }
+  }
+  timerAlarmWrite(engine.timer, next, true);
+  engine.scheduledTicks += next;
+  if (pulseMask) {
+    engine.stats.pulseLatencyUs.record(latency); // Pins and next alarm are set: timing is unaffected
+  }
+  portEXIT_CRITICAL_ISR(&engine.mux);
+}
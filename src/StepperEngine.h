@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Axis.h"
+#include "Histogram.h"
+#include "MotionProfile.h"
+#include "StepGenerator.h"
+
+// Driver wiring. X feeds the wire, Z turns the bend head.
+typedef Axis<18, 17> XAxis; // CPX, CWX
+typedef Axis<9, 8> ZAxis;   // CPY, CWY
+
+// Background step pulse generator driven by a hardware timer. Planned moves are handed over
+// with queue() and run entirely from the timer interrupt. One move can be buffered behind the
+// running one; the interrupt chains it without stopping, so moves planned with a non-zero
+// exit rate blend into the next. Callers poll isBusy() or register a completion callback.
+class StepperEngine {
+public:
+  typedef void (*CompletionCallback)();
+
+  // Timing recorded by the interrupt itself, after the pins for the current edge are set
+  struct Metrics {
+    Histogram movePlannedUs;  // Sum of the intervals the interrupt scheduled for a move
+    Histogram moveActualUs;   // Time from loading a move until its last step finished
+    Histogram pulseLatencyUs; // Timer alarm to interrupt entry, for every rising edge
+  };
+
+  void begin(); // Configure the axis pins and allocate the hardware timer
+  // Pins of an axis (AxisX, AxisZ), and the direction pin level for positive steps
+  static constexpr uint8_t pulsePin(int axis) { return axis == AxisX ? XAxis::pulsePin : ZAxis::pulsePin; }
+  static constexpr uint8_t directionPin(int axis) { return axis == AxisX ? XAxis::directionPin : ZAxis::directionPin; }
+  static constexpr uint8_t forwardLevel(int axis) { return axis == AxisX ? XAxis::forwardLevel : ZAxis::forwardLevel; }
+  // Start the plan now if idle, or buffer it behind the running move. The plan is copied.
+  // Returns false if a move is already buffered.
+  bool queue(const MotionPlan &motionPlan);
+  // Abort immediately: the running and the buffered move are dropped without decelerating.
+  void stop();
+  // Feed override. progress() reports the running move (false when idle). retime() switches it,
+  // from lead step 'fromStep' on, to the speed profile 'profile' (planned for the steps left);
+  // replaceQueued() swaps the buffered move for a re-planned copy. Both do nothing and return
+  // false unless the move with the plan's id is still the running or buffered one.
+  bool progress(MotionProgress &progress);
+  bool retime(uint32_t fromStep, const MotionPlan &profile);
+  bool replaceQueued(const MotionPlan &motionPlan);
+  // Feed hold: slow down along the decel table of 'ramp' (planned from the rate now down to the
+  // start rate), then pause between two steps. The running and the buffered move keep their
+  // place, and moves chained during the ramp stay under it. resume() continues from the step it
+  // paused at, speeding up along the accel table of 'ramp' and never faster than the plan.
+  // Both return false when there is no move to hold or resume.
+  bool hold(const MotionPlan &ramp);
+  bool resume(const MotionPlan &ramp);
+  bool isHolding() const { return holding || paused; }
+  bool isPaused() const { return paused; }
+  // Lead axis rate of the running move (steps/s), 0 when idle or paused
+  uint32_t rate() const;
+  bool canQueue() const { return !nextReady; }
+  // Steps taken since boot, counted by the interrupt; readable from any task
+  int32_t position(int axis) const { return positions[axis]; }
+  bool isBusy() const { return busy; }
+  const Metrics &metrics() const { return stats; }
+  // Called from the timer interrupt when the last move finishes; keep it short and IRAM-safe.
+  void onComplete(CompletionCallback callback) { completionCallback = callback; }
+
+private:
+  static void onTimer();
+  void loadPlan(int slot); // Start the generator on a plan slot and set the direction pins
+
+  hw_timer_t *timer = nullptr;
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  MotionPlan plans[2]; // Running move and the buffered next move, read by the interrupt
+  volatile int activeSlot = 0;
+  volatile bool nextReady = false;
+  StepGenerator generator;
+  // GPIO bits of each axis, indexed by axis; resolved at compile time
+  static constexpr uint32_t pulseBits[AxisCount] = { XAxis::pulseMask, ZAxis::pulseMask };
+  static constexpr uint32_t directionBits[AxisCount] = { XAxis::directionMask, ZAxis::directionMask };
+  static constexpr uint32_t forwardBits[AxisCount] = { XAxis::directionBits(true), ZAxis::directionBits(true) };
+  uint8_t activeMask = 0;         // Axes taking part in the running move
+  uint32_t activePulseBits = 0;   // Their pulse pins
+  volatile int32_t positions[AxisCount] = {};
+  volatile bool busy = false;      // A move is loaded, also while paused
+  volatile bool holding = false;   // Slowing down for a feed hold
+  volatile bool paused = false;    // Held between two steps, timer stopped
+  uint32_t limitTable[RampPoints + 1]; // Hold or resume ramp the generator reads
+  Metrics stats;
+  uint32_t moveStartUs = 0;      // micros() when the running move was loaded
+  uint32_t scheduledTicks = 0;   // Timer ticks scheduled for the running move so far
+  CompletionCallback completionCallback = nullptr;
+};
+
+extern StepperEngine stepperEngine;
@@ -1,35 +1,148 @@
 #include <Adafruit_NeoPixel.h>
 #include <ESP32Servo.h> // Include the ESP32Servo library
-#include <queue>        // Include the queue library for command buffering
 #include <WiFi.h>       // Include WiFi library for access point
 #include <ESPAsyncWebServer.h> // Include ESPAsyncWebServer library
 #include <SPIFFS.h>     // Include SPIFFS for file storage
+#include "StepperEngine.h" // Hardware-timed background step pulse generator
+#include "Executor.h"      // Command executor with the look-ahead planner
+#include "CycleEstimator.h" // Cycle time prediction with the executor's timing model
+#include "Program.h"       // Command compiler and compact instruction format
+#include "SpscQueue.h"     // Lock-free FIFO between the producers and the executor
+#include "MotionTask.h"    // FreeRTOS task the executor runs in
+#include "Logger.h"        // Asynchronous log ring drained by a low-priority task
+#include "SerialFramer.h"  // Line framing and bulk uploads of the serial protocol
+#include "Interpreter.h"   // Runs programs with repeats and subroutines
+#include "Optimizer.h"     // Peephole pass over programs before they are queued
+#include "WebAssets.h"     // Web UI from web/, generated by tools/embed_web.py
+#include "Histogram.h"     // Fixed-size timing histograms for /metrics
+#include "ProgramLibrary.h" // Named programs stored compiled on SPIFFS
+#include "ConfigStore.h"   // Journaled settings, cached in RAM
+#include "CurrentSensor.h" // INA260 motor supply current, sampled by its own task
+#include "CurrentMonitor.h" // Stall and overload detection on the supply current
+#include "FeedTuner.h"     // Feedrate and acceleration search of the tuning mode
+#include "FleetLink.h"     // Station mode WiFi and MQTT client for fleet jobs
+#include "PowerSave.h"     // Event-driven loop() and CPU clock scaling between jobs
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 #define PIN_NEOPIXEL 39  // Define the pin where the NeoPixel is connected
 #define NUM_PIXELS 1     // Number of NeoPixels
 #define SERVO_PIN 35     // Change the servo pin to pin 35
-#define CPX 18           // Define CPX as pin 18
-#define CWX 17           // Define CWX as pin 17
-#define CPY 9            // Define CPY as pin 16
-#define CWY 8            // Define CWY as pin 15
 #define VERSION "0.9"    // Define the current version of the program
+#define COMMAND_QUEUE_SIZE 256 // Number of compiled commands each command channel can hold
+#define SERIAL_UPLOAD_SIZE 4096 // Largest program accepted by a serial $UPLOAD, in bytes
+#define TELEMETRY_MIN_INTERVAL_MS 100 // Fastest /events status rate (changes are sent at once up to this rate)
+#define TELEMETRY_HEARTBEAT_MS 2000   // Status is repeated this often when nothing changes
+#define HEAP_SAMPLE_MS 1000    // Free heap is sampled into the metrics this often
+#define LOOP_IDLE_WAIT_MS 100  // Longest loop() sleep without an event (telemetry, heap samples)
+#define FLEET_POLL_MS 20       // ... in fleet mode, where the MQTT client has to be polled
+#define FEED_OVERRIDE_MIN 10   // Feed override range, percent of the programmed feedrates
+#define FEED_OVERRIDE_MAX 200
+#define CURRENT_OVERLOAD_MA 2500  // Motor supply current limit while moving (smoothed)
+#define CURRENT_OVERLOAD_MS 50    // ... and how long it may be exceeded
+#define CURRENT_STALL_RISE_MA 400 // Jump above the running average that is taken for a stall
+#define CURRENT_STALL_MS 10       // ... and how long it must last
+#define CURRENT_SETTLE_MS 40      // No stall is judged this long after motion starts or resumes
+#define TUNE_MARGIN_MA 300        // Headroom below CURRENT_OVERLOAD_MA a tuning trial must keep
+#define TUNE_STEP_PERCENT 10      // Each tuning trial runs this much faster than the last one
+#define TUNE_MAX_FEEDRATE 20000   // Tuning never goes beyond these (steps/s, steps/s^2)
+#define TUNE_MAX_ACCEL 200000
+#define FLEET_STATUS_MIN_INTERVAL_MS 250 // Fastest fleet status rate (changes are published at once up to this rate)
+#define FLEET_STATUS_HEARTBEAT_MS 10000  // Fleet status is repeated this often when nothing changes
+#define FLEET_JOB_ID_SIZE 32             // Longest fleet job id plus the terminator
 
 Adafruit_NeoPixel strip(NUM_PIXELS, PIN_NEOPIXEL, NEO_GRB + NEO_KHZ800);
 Servo servo; // Create a Servo object
-std::queue<String> commandQueue; // Queue to store commands
 
-// Define feedrate for X and Z axes (steps per second)
-int X_FEEDRATE = 1000; // Feedrate for X-axis
-int Z_FEEDRATE = 1000; // Feedrate for Z-axis
+// Compiled commands waiting for execution. Every queue has exactly one producer task and is
+// drained only by the executor, so they need no locks.
+typedef SpscQueue<Instruction, COMMAND_QUEUE_SIZE> CommandQueue;
+CommandQueue webCommandQueue;    // Filled by the web handlers (async TCP task)
+CommandQueue serialCommandQueue; // Filled by the serial reader in loop()
+Instruction compiledProgram[COMMAND_QUEUE_SIZE]; // Scratch space web handlers compile and load programs into
+Instruction serialProgram[COMMAND_QUEUE_SIZE];   // Scratch space serial uploads compile into (loop only)
+char serialUploadBuffer[SERIAL_UPLOAD_SIZE];
+SerialFramer serialFramer(serialUploadBuffer, SERIAL_UPLOAD_SIZE);
+char serialSaveName[ProgramNameSize]; // Library name the pending upload is saved under (empty: run it)
+
+// Programs with repeats or subroutines are not expanded into the queue. Each channel has one
+// image slot they are copied to; the queue only carries an OP_RUN for it. The producer fills a
+// slot only while it is free, the motion task frees it when the program ends or is dropped.
+struct ProgramImage {
+  Instruction code[COMMAND_QUEUE_SIZE];
+  size_t count;
+  std::atomic<bool> inUse;
+};
+enum ProgramSlot { WEB_PROGRAM, SERIAL_PROGRAM, PROGRAM_SLOTS };
+ProgramImage programImages[PROGRAM_SLOTS];
+
+enum QueueResult { QUEUED, INVALID_COMMAND, QUEUE_FULL };
+
+// Settings changed by commands and saved to the config file
+MachineSettings machineSettings = {
+  1000,  // X feedrate (steps per second)
+  1000,  // Z feedrate (steps per second)
+  4000,  // X acceleration (steps per second squared, 0 disables ramping)
+  4000,  // Z acceleration (steps per second squared, 0 disables ramping)
+  0,     // X jerk (steps per second cubed, 0 selects a trapezoidal profile)
+  0,     // Z jerk (steps per second cubed, 0 selects a trapezoidal profile)
+  -2000, // globalXValue: X steps of LOAD WIRE
+  50,    // globalDelayMs: delay in milliseconds between commands for stability
+  500,   // servoStabilizationDelayMs: longest servo settle time, used for full swings
+  600,   // Servo travel speed (degrees per second) used to estimate settle times
+};
+
+// The command buffer: the program last queued or loaded from the web UI. The web task sets it
+// and the loop task reads it (estimates, tuning, saveValues()), so it is only used through
+// commandBuffer() and setCommandBuffer(), which copy it under its lock.
+std::mutex commandBufferLock;
+String globalCommandBuffer = "";
 
-// Global variables to hold X and Z values from the web page
-int globalXValue = -2000;
+String commandBuffer() {
+  std::lock_guard<std::mutex> guard(commandBufferLock);
+  return globalCommandBuffer;
+}
 
-// Global variable to hold the command buffer
-String globalCommandBuffer = "";
+void setCommandBuffer(const String &buffer) {
+  std::lock_guard<std::mutex> guard(commandBufferLock);
+  globalCommandBuffer = buffer;
+}
 
-int globalDelayMs = 50; // Global delay in milliseconds between commands for stability
-int servoStabilizationDelayMs = 500; // Configurable delay for servo stabilization
+std::atomic<bool> stopRequested(false); // CTRL+C seen by a producer, handled by the motion task
+std::atomic<bool> holdRequested(false);   // Feed hold and resume, likewise
+std::atomic<bool> resumeRequested(false);
+std::atomic<bool> optimizePrograms(true); // Peephole optimizer on queued programs; off replays them exactly
+std::atomic<uint32_t> feedOverride(100); // Percent of the programmed feedrates, applied by the motion task
+
+// What the machine is doing, published by the motion task after every pass for readers in
+// other tasks. A job runs from the first command taken while idle until the executor is idle
+// again; a CTRL+C that drops work leaves the fault state until the next job starts. A feed hold
+// shows as paused until it is resumed.
+enum MachineState : uint8_t { STATE_IDLE, STATE_RUNNING, STATE_FAULT, STATE_PAUSED };
+struct MachineStatus {
+  std::atomic<uint8_t> state{STATE_IDLE};
+  std::atomic<uint32_t> command{0}; // 1-based index of the latest command taken in the current job
+  std::atomic<int32_t> servoAngle{0};
+  std::atomic<uint32_t> jobs{0};    // Jobs finished since boot, counted after the state above is set
+};
+MachineStatus machineStatus;
+
+// Execution metrics, reported by /metrics and $METRICS. Every histogram has one writer: the
+// motion task, the loop or (in StepperEngine) the step interrupt.
+struct FirmwareMetrics {
+  Histogram servoPlannedUs;  // Wait scheduled after a servo bend (settle time, globalDelayMs)
+  Histogram servoActualUs;   // Time until the executor found that wait over
+  Histogram delayPlannedUs;  // Same for D delays
+  Histogram delayActualUs;
+  Histogram queueWaitUs;     // Next command waiting at the head of its channel until it is taken
+  Histogram motionPollUs;    // One runExecutor() pass
+  Histogram loopUs;          // One loop() pass, without its delay
+  Histogram heapFreeBytes;   // Sampled every HEAP_SAMPLE_MS by loop()
+  Histogram heapLargestBlockBytes;
+  Histogram supplyCurrentMa; // Smoothed motor supply current, every sample of the current sensor task
+};
+FirmwareMetrics metrics;
 
 #define OFF 0x000000
 #define RED 0xFF0000
@@ -41,6 +154,7 @@ int servoStabilizationDelayMs = 500; // Configurable delay for servo stabilizati
 #define WIFI_PASSWORD ""             // Open network (no password)
 
 AsyncWebServer server(80); // Create an AsyncWebServer object on port 80
+AsyncEventSource events("/events"); // Live status stream (Server-Sent Events)
 
 void led_on(uint32_t color) {
   strip.fill(color);
@@ -60,252 +174,1179 @@ void setReadyState() {
   led_on(GREEN); // Set LED to GREEN to indicate ready state
 }
 
-void moveStepper(int steps, int pulsePin, int directionPin, int feedrate) {
-  digitalWrite(directionPin, steps > 0 ? HIGH : LOW); // Set direction
-  steps = abs(steps); // Use absolute value for step count
+// Define soft limits for the servo
+const int LowAngle = 170; // Minimum allowed angle
+const int HighAngle = 345; // Maximum allowed angle
+
+ProgramLimits programLimits() {
+  return { LowAngle, HighAngle };
+}
 
-  unsigned long delayTime = 1000000UL / (2 * feedrate); // Calculate delay time
-  for (int i = 0; i < steps; i++) {
-    digitalWrite(pulsePin, HIGH); // Generate pulse
-    delayMicroseconds(delayTime); // Half-period delay for feedrate
-    digitalWrite(pulsePin, LOW); // End pulse
-    delayMicroseconds(delayTime); // Half-period delay for feedrate
+// The executor drains one channel until it runs dry before switching to the other, so a
+// program from one source is never interleaved with commands from the other.
+CommandQueue *activeCommandQueue() {
+  static CommandQueue *active = &serialCommandQueue;
+  if (active->empty()) {
+    active = active == &serialCommandQueue ? &webCommandQueue : &serialCommandQueue;
   }
+  return active;
 }
 
-// Define soft limits for the servo
-const int LowAngle = 170; // Minimum allowed angle
-const int HighAngle = 345; // Maximum allowed angle
+// The executor's view of the hardware: both command channels, the step engine and the servo.
+// Everything here runs in the motion task; the status LED follows machineStatus in loop(). An OP_RUN in a channel starts its
+// program image, whose commands come before anything else until it ends.
+class FirmwareIo : public MachineIo {
+public:
+  uint32_t nowMs() override { return millis(); }
+  bool peekCommand(Instruction &instruction) override {
+    for (;;) {
+      if (interpreter.peek(instruction)) {
+        startQueueWait();
+        return true;
+      }
+      releaseImage();
+      CommandQueue *queue = activeCommandQueue();
+      if (queue->empty()) {
+        return false;
+      }
+      instruction = queue->front();
+      if (instruction.op != OP_RUN) {
+        startQueueWait();
+        return true;
+      }
+      queue->pop(instruction); // The image takes the place of its OP_RUN
+      runningImage = &programImages[instruction.a];
+      interpreter.start(runningImage->code, runningImage->count);
+    }
+  }
+  bool commandsWaiting() override {
+    return interpreter.active() || !webCommandQueue.empty() || !serialCommandQueue.empty();
+  }
+  void popCommand() override {
+    taken++;
+    if (waiting) {
+      metrics.queueWaitUs.record(micros() - waitStartUs);
+      waiting = false;
+    }
+    if (interpreter.active()) {
+      interpreter.pop();
+      return;
+    }
+    Instruction instruction;
+    activeCommandQueue()->pop(instruction);
+  }
+  void clearCommands() override {
+    waiting = false;
+    interpreter.reset();
+    releaseImage();
+    discard(webCommandQueue); // Drop everything still waiting on both channels
+    discard(serialCommandQueue);
+  }
+  bool canQueueMotion() override { return stepperEngine.canQueue(); }
+  void queueMotion(const MotionPlan &plan) override { stepperEngine.queue(plan); }
+  bool motionBusy() override { return stepperEngine.isBusy(); }
+  void stopMotion() override { stepperEngine.stop(); }
+  uint32_t feedOverride() override { return ::feedOverride; }
+  bool motionProgress(MotionProgress &progress) override { return stepperEngine.progress(progress); }
+  bool retimeMotion(uint32_t fromStep, const MotionPlan &profile) override { return stepperEngine.retime(fromStep, profile); }
+  bool replaceQueuedMotion(const MotionPlan &plan) override { return stepperEngine.replaceQueued(plan); }
+  bool holdMotion(const MotionPlan &ramp) override { return stepperEngine.hold(ramp); }
+  bool resumeMotion(const MotionPlan &ramp) override { return stepperEngine.resume(ramp); }
+  bool motionPaused() override { return stepperEngine.isPaused(); }
+  void writeServo(int32_t angle) override {
+    servo.write(map(angle, 0, 360, 0, 180)); // Map 0-360 to 0-180 for ESP32Servo
+  }
+  void vlog(LogLevel level, const char *format, va_list args) override {
+    vlogMessage(level, format, args); // Never blocks: a full log ring drops the message
+  }
+  void commandTimed(const Instruction &instruction, uint32_t plannedMs, uint32_t actualMs) override {
+    bool servo = instruction.op == OP_SERVO;
+    (servo ? metrics.servoPlannedUs : metrics.delayPlannedUs).record(plannedMs * 1000);
+    (servo ? metrics.servoActualUs : metrics.delayActualUs).record(actualMs * 1000);
+  }
+  uint32_t commandsTaken() const { return taken; }
 
-void moveServo(int angle) {
-  if (angle >= LowAngle && angle <= HighAngle) { // Enforce soft limits
-    int mappedAngle = map(angle, 0, 360, 0, 180); // Map 0-360 to 0-180 for ESP32Servo
-    servo.write(mappedAngle); // Move servo to the specified angle
-    delay(servoStabilizationDelayMs); // Use configurable delay
-    Serial.printf("Servo moved to angle: %d\n", angle);
-  } else {
-    Serial.printf("Invalid servo angle: %d. Allowed range is %d to %d.\n", angle, LowAngle, HighAngle);
+private:
+  void startQueueWait() {
+    if (!waiting) {
+      waiting = true;
+      waitStartUs = micros();
+    }
+  }
+  void releaseImage() {
+    if (runningImage) {
+      runningImage->inUse = false;
+      runningImage = nullptr;
+    }
+  }
+  // Empty a channel, freeing the images of programs that never started
+  static void discard(CommandQueue &queue) {
+    Instruction instruction;
+    while (queue.pop(instruction)) {
+      if (instruction.op == OP_RUN) {
+        programImages[instruction.a].inUse = false;
+      }
+    }
   }
+
+  Interpreter interpreter;
+  ProgramImage *runningImage = nullptr;
+  uint32_t taken = 0; // Commands handed to the executor since boot
+  bool waiting = false; // The next command has been seen at the head of its channel since waitStartUs
+  uint32_t waitStartUs = 0;
+};
+
+FirmwareIo firmwareIo;
+Executor executor(firmwareIo, machineSettings, { LowAngle, HighAngle });
+
+// Stop from any task: the motion task decelerates the moves in flight to a standstill, then
+// drops all motion and waiting commands.
+void requestStop() {
+  stopRequested = true;
+  wakeMotionTask();
 }
 
-void moveStepperWithDelay(int steps, int pulsePin, int directionPin, int feedrate, int delayMs) {
-  delay(delayMs); // Delay before starting stepper movement
-  moveStepper(steps, pulsePin, directionPin, feedrate); // Move stepper motor
-  Serial.printf("Stepper moved %d steps with delay of %d ms\n", steps, delayMs);
+// Feed hold and resume from any task, handled by the motion task on its next pass
+void requestHold() {
+  holdRequested = true;
+  wakeMotionTask();
 }
 
-void processCommand(String command) {
-  char axis = command.charAt(0); // Extract the first character (e.g., 'S', 'Z', 'X', 'D', 'F')
-  int value = command.substring(1).toInt(); // Extract the numeric value after the axis
+void requestResume() {
+  resumeRequested = true;
+  wakeMotionTask();
+}
 
-  static int stepCounter = 0; // Counter to track the step in the program
+// Tuning mode requests from the web and serial tasks, picked up by pollTuning() in loop()
+struct TuneRequest {
+  char axis; // 'X' or 'Z', 0 when nothing is requested
+  String program;
+};
+std::mutex tuneLock; // Guards tuneRequest and tuneReport
+TuneRequest tuneRequest = { 0, "" };
+char tuneReport[128] = "No tuning run since boot.";
+
+void requestTune(char axis, const String &program) {
+  {
+    std::lock_guard<std::mutex> guard(tuneLock);
+    tuneRequest.axis = axis;
+    tuneRequest.program = program;
+  }
+  wakeLoop();
+}
 
-  setProcessingState(); // Indicate processing state
+// Progress or result of the last tuning run
+String tuneStatus() {
+  std::lock_guard<std::mutex> guard(tuneLock);
+  return String(tuneReport);
+}
 
-  switch (axis) {
-    case '\x03': // CTRL+C (ASCII code 3)
-      Serial.printf("[Step %d] CTRL+C received. Stopping all operations.\n", ++stepCounter);
-      commandQueue = std::queue<String>(); // Clear the command queue
-      setReadyState(); // Indicate ready state
-      break;
+// Set the feed override from any task; the motion task re-plans the moves in flight on its next
+// pass. Returns the percentage in force, clamped to FEED_OVERRIDE_MIN..FEED_OVERRIDE_MAX.
+uint32_t setFeedOverride(int32_t percent) {
+  percent = percent < FEED_OVERRIDE_MIN ? FEED_OVERRIDE_MIN : (percent > FEED_OVERRIDE_MAX ? FEED_OVERRIDE_MAX : percent);
+  feedOverride = percent;
+  wakeMotionTask();
+  return percent;
+}
 
-    case 'S': // Servo control
-      Serial.printf("[Step %d] Servo command received with angle: %d\n", ++stepCounter, value);
-      moveServo(value); // Move the servo
-      break;
+// Current monitoring. The sensor task judges every sample; a stall or overload stops the job
+// with a decelerated stop, like CTRL+C. The peak and trip flag are what the tuning mode reads.
+CurrentMonitor currentMonitor({ CURRENT_OVERLOAD_MA, CURRENT_OVERLOAD_MS, CURRENT_STALL_RISE_MA, CURRENT_STALL_MS, CURRENT_SETTLE_MS });
+bool currentSensing = false;             // An INA260 answered at boot
+std::atomic<uint32_t> supplyCurrentMa(0); // Latest smoothed current, for /events
+std::atomic<uint32_t> currentPeakMa(0);   // Highest smoothed current while moving since it was reset
+std::atomic<uint32_t> currentPeakRate(0); // Highest lead axis rate seen with it (steps/s)
+std::atomic<bool> currentTripped(false);  // A stall or overload stopped the machine since it was reset
+
+void onCurrentSample(uint32_t timeMs, uint32_t currentMa) {
+  bool moving = stepperEngine.isBusy() && !stepperEngine.isPaused();
+  CurrentEvent event = currentMonitor.sample(timeMs, currentMa, moving);
+  uint32_t smoothed = currentMonitor.filteredMa();
+  supplyCurrentMa = smoothed;
+  metrics.supplyCurrentMa.record(smoothed);
+  uint32_t peak = currentPeakMa;
+  while (moving && smoothed > peak && !currentPeakMa.compare_exchange_weak(peak, smoothed)) {
+  }
+  uint32_t rate = stepperEngine.rate();
+  uint32_t peakRate = currentPeakRate;
+  while (moving && rate > peakRate && !currentPeakRate.compare_exchange_weak(peakRate, rate)) {
+  }
+  if (event != CURRENT_NORMAL) {
+    currentTripped = true;
+    LOG_ERROR("%s: %u mA. Stopping all operations.\n", event == CURRENT_STALL ? "Stall detected" : "Supply overload", (unsigned)smoothed);
+    requestStop();
+  }
+}
 
-    case 'Z': // Z-axis stepper motor control
-      Serial.printf("[Step %d] Z-axis command received with value: %d\n", ++stepCounter, value);
-      moveStepperWithDelay(value, CPY, CWY, Z_FEEDRATE, globalDelayMs); // Move Z-axis stepper motor with delay
+// Real-time bytes: CTRL+C, feed hold and resume, or a grbl feed override step
+void handleRealtimeByte(uint8_t byte) {
+  switch (byte) {
+    case RealtimeStop:
+      requestStop(); // Takes effect at once, even in the middle of a move or upload
       break;
-
-    case 'X': // X-axis stepper motor control
-      Serial.printf("[Step %d] X-axis command received with value: %d\n", ++stepCounter, value);
-      moveStepperWithDelay(value, CPX, CWX, X_FEEDRATE, globalDelayMs); // Move X-axis stepper motor with delay
+    case RealtimeHold:
+      requestHold();
       break;
-
-    case 'D': // Delay in milliseconds
-      Serial.printf("[Step %d] Delay command received with value: %d ms\n", ++stepCounter, value);
-      if (value > 0) {
-        unsigned long startTime = millis();
-        while (millis() - startTime < value) {
-          // Non-blocking delay: Allow other tasks to run during the delay
-          if (Serial.available() > 0) {
-            char incomingChar = Serial.read(); // Read incoming characters
-            Serial.print("Ignoring input during delay: ");
-            Serial.println(incomingChar);
-          }
-        }
-      } else {
-        Serial.println("Invalid delay value. Please enter a positive number.");
-      }
+    case RealtimeResume:
+      requestResume();
       break;
-
-    case 'F': // Change feedrate for X-axis
-      if (value > 0) {
-        X_FEEDRATE = value;
-        Serial.printf("Feedrate for X-axis updated to %d steps per second.\n", value);
-      } else {
-        Serial.println("Invalid feedrate value for X-axis. Please enter a positive number.");
-      }
+    case RealtimeFeedReset:
+      setFeedOverride(100);
       break;
-
-    case 'G': // Change feedrate for Z-axis
-      if (value > 0) {
-        Z_FEEDRATE = value;
-        Serial.printf("Feedrate for Z-axis updated to %d steps per second.\n", value);
-      } else {
-        Serial.println("Invalid feedrate value. Please enter a positive number.");
-      }
+    case RealtimeFeedUp10:
+      setFeedOverride((int32_t)feedOverride + 10);
       break;
-
-    case 'H': // Set globalXValue
-      Serial.printf("[Step %d] H command received with value: %d\n", ++stepCounter, value);
-      globalXValue = value;
-      Serial.printf("globalXValue updated to: %d\n", globalXValue);
+    case RealtimeFeedDown10:
+      setFeedOverride((int32_t)feedOverride - 10);
       break;
-
-    case 'C': // Set globalDelayMs
-      Serial.printf("[Step %d] C command received with value: %d\n", ++stepCounter, value);
-      if (value >= 0) {
-        globalDelayMs = value;
-        Serial.printf("globalDelayMs updated to: %d ms\n", globalDelayMs);
-      } else {
-        Serial.println("Invalid delay value. Please enter a non-negative number.");
-      }
+    case RealtimeFeedUp1:
+      setFeedOverride((int32_t)feedOverride + 1);
       break;
-
-    default:
-      Serial.printf("[Step %d] Invalid command received: %s\n", ++stepCounter, command.c_str());
-      Serial.println("Invalid command. Use 'S', 'Z', 'X', 'D', 'F', 'G' or 'H' followed by a value.");
+    case RealtimeFeedDown1:
+      setFeedOverride((int32_t)feedOverride - 1);
       break;
   }
+}
+
+
+// Compile a single command and add it to the producer's queue. Invalid commands are rejected
+// here, before anything moves; the reason is printed and, if requested, returned in errorMessage.
+QueueResult queueCommand(CommandQueue &queue, const String &command, String *errorMessage = nullptr) {
+  Instruction instruction;
+  CompileError error;
+  String message;
+  QueueResult result;
+  if (!compileCommand(command.c_str(), command.length(), programLimits(), instruction, error)) {
+    message = "Invalid command '" + command + "': " + error.message;
+    result = INVALID_COMMAND;
+  } else if (instruction.op == OP_STOP) {
+    requestStop(); // CTRL+C skips the queue so it takes effect mid-move
+    return QUEUED;
+  } else if (!queue.push(instruction)) {
+    message = "Command queue full. Command '" + command + "' rejected.";
+    result = QUEUE_FULL;
+  } else {
+    wakeMotionTask();
+    return QUEUED;
+  }
+  LOG_WARN("%s\n", message.c_str());
+  if (errorMessage) {
+    *errorMessage = message;
+  }
+  return result;
+}
 
-  setReadyState(); // Indicate ready state
+void logOptimizerChange(const char *message) {
+  LOG_INFO("Optimizer: %s\n", message);
 }
 
-void processBuffer(String buffer) {
-  globalCommandBuffer = buffer; // Update the global command buffer
-  static int stepCounter = 0;   // Counter to track the step in the program
-  stepCounter = 0;              // Reset step counter for each new program
+// Shorten a freshly compiled program unless the optimizer is off for exact replay. With INFO
+// logging on, every change is logged together with the cycle time it saves; returns the new count.
+size_t optimizeCompiledProgram(Instruction *program, size_t count) {
+  if (!optimizePrograms) {
+    return count;
+  }
+  if (!logEnabled(LEVEL_INFO)) {
+    return optimizeProgram(program, count, nullptr); // The estimates below are only for the log
+  }
+  std::unique_ptr<Instruction[]> original(new Instruction[count]);
+  memcpy(original.get(), program, count * sizeof(Instruction));
+  size_t optimized = optimizeProgram(program, count, logOptimizerChange);
+  if (optimized == count) {
+    return count;
+  }
+  std::unique_ptr<uint32_t[]> commandUs(new uint32_t[count]);
+  CycleEstimate before, after;
+  estimateCycle(original.get(), count, machineSettings, programLimits(), executor.servoAngle(), commandUs.get(), before);
+  estimateCycle(program, optimized, machineSettings, programLimits(), executor.servoAngle(), commandUs.get(), after);
+  LOG_INFO("Optimizer: %d instructions instead of %d, %.3f s instead of %.3f s per cycle\n", (int)optimized, (int)count,
+           after.totalUs / 1e6, before.totalUs / 1e6);
+  return optimized;
+}
 
-  int start = 0;
-  while (start < buffer.length()) {
-    int end = buffer.indexOf(',', start); // Find the next comma
-    if (end == -1) {                      // If no more commas, process the last command
-      end = buffer.length();
+// Queue a compiled program from 'scratch', optimizing it in place first unless 'optimize' is
+// false (already done). It is published to the executor in one step, so it never sees half of
+// it. Programs with repeats or subroutines go to the channel's image slot instead.
+QueueResult queueCompiledProgram(CommandQueue &queue, ProgramSlot slot, Instruction *scratch, int count, String &errorMessage,
+                                 bool optimize = true) {
+  if (optimize) {
+    count = optimizeCompiledProgram(scratch, count);
+  }
+  if (hasControlFlow(scratch, count)) {
+    ProgramImage &image = programImages[slot];
+    Instruction run = { OP_RUN, slot, 0 };
+    if (image.inUse || queue.available() == 0) {
+      errorMessage = "A program with repeats or subroutines is still queued or running. Program rejected, retry later.";
+      LOG_WARN("%s\n", errorMessage.c_str());
+      return QUEUE_FULL;
     }
-    String command = buffer.substring(start, end); // Extract the command
-    command.trim();                                // Trim whitespace
-    commandQueue.push(command);                   // Add the command to the queue
-    start = end + 1;                               // Move to the next command
+    memcpy(image.code, scratch, count * sizeof(Instruction));
+    image.count = count;
+    image.inUse = true;
+    queue.push(run);
+  } else if (!queue.pushAll(scratch, count)) {
+    errorMessage = "Command queue busy (" + String(queue.size()) + " commands waiting). Program of " + String(count) + " commands rejected, retry later.";
+    LOG_WARN("%s\n", errorMessage.c_str());
+    return QUEUE_FULL;
   }
+  wakeMotionTask();
+  LOG_INFO("Program of %d commands queued.\n", count);
+  return QUEUED;
 }
 
-void processNextCommand() {
-  if (!commandQueue.empty()) {
-    String command = commandQueue.front(); // Get the next command
-    commandQueue.pop(); // Remove the command from the queue
-    processCommand(command); // Process the command
-    delay(globalDelayMs); // Add delay for stability
-    Serial.printf("COMMAND SENT with delay: %d ms\n", globalDelayMs); // Print command sent message with delay
-    led_on(GREEN); // Indicate ready state after program finishes
+// Compile a whole comma-separated program into 'scratch'. Every command is validated before any
+// of them is queued, so a typo late in the buffer cannot leave the machine half way through a
+// part. Returns the instruction count or -1.
+int compileBuffer(Instruction *scratch, const char *text, size_t length, String &errorMessage) {
+  CompileError error;
+  int count = compileProgram(text, length, programLimits(), scratch, COMMAND_QUEUE_SIZE, error);
+  if (count < 0) {
+    errorMessage = "Error in command " + String(error.command) + ": " + error.message;
+    LOG_WARN("%s\n", errorMessage.c_str());
   }
+  return count;
 }
 
-void loop() {
-  static String commandBuffer = ""; // Buffer to store incoming characters
+QueueResult queueProgram(CommandQueue &queue, ProgramSlot slot, Instruction *scratch, const char *text, size_t length, String &errorMessage) {
+  int count = compileBuffer(scratch, text, length, errorMessage);
+  if (count < 0) {
+    return INVALID_COMMAND;
+  }
+  return queueCompiledProgram(queue, slot, scratch, count, errorMessage);
+}
+
+// Run a program from the library: its stored instructions go straight into 'scratch'.
+QueueResult queueStoredProgram(CommandQueue &queue, ProgramSlot slot, Instruction *scratch, const char *name, String &errorMessage) {
+  int count = programLibrary.load(name, scratch, COMMAND_QUEUE_SIZE, programLimits(), errorMessage);
+  if (count < 0) {
+    LOG_WARN("%s\n", errorMessage.c_str());
+    return INVALID_COMMAND;
+  }
+  return queueCompiledProgram(queue, slot, scratch, count, errorMessage);
+}
 
-  while (Serial.available() > 0) {
-    char incomingChar = Serial.read(); // Read one character at a time
+// Compile a program into 'scratch' and store it in the library under 'name'.
+bool saveProgram(const char *name, Instruction *scratch, const char *text, size_t length, String &errorMessage) {
+  int count = compileBuffer(scratch, text, length, errorMessage);
+  return count >= 0 && programLibrary.save(name, text, length, scratch, count, errorMessage);
+}
 
-    if (incomingChar == ',') { // If a comma is received, buffer the current command
-      commandBuffer.trim(); // Remove any extra whitespace
-      if (!commandBuffer.isEmpty()) {
-        commandQueue.push(commandBuffer); // Add the command to the queue
-      }
-      commandBuffer = ""; // Clear the buffer for the next command
+// Library listing, one line per program: "<name> <commands> <source bytes>"
+String programListing() {
+  std::unique_ptr<ProgramLibrary::Entry[]> entries(new ProgramLibrary::Entry[LibrarySize]);
+  size_t count = programLibrary.list(entries.get(), LibrarySize);
+  String listing;
+  for (size_t i = 0; i < count; i++) {
+    listing += String(entries[i].name) + " " + String(entries[i].count) + " " + String(entries[i].sourceLength) + "\n";
+  }
+  return listing;
+}
+
+// Queue a program from the web UI and make it the current command buffer.
+QueueResult processBuffer(const String &buffer, String &errorMessage) {
+  QueueResult result = queueProgram(webCommandQueue, WEB_PROGRAM, compiledProgram, buffer.c_str(), buffer.length(), errorMessage);
+  if (result == QUEUED) {
+    setCommandBuffer(buffer);
+  }
+  return result;
+}
+
+// One executor pass, run by the motion task. Never blocks: waits are deadlines checked on the
+// next pass. False when the executor is idle with no deadline ahead, so the motion task can
+// sleep until a command, request or finished move wakes it.
+bool runExecutor() {
+  static bool idle = true;
+  static bool fault = false;
+  static uint32_t jobStart = 0; // commandsTaken() when the current job started
+  static bool wasActive = false; // A job held the CPU at full speed after the last pass
+  uint32_t startUs = micros();
+
+  if (stopRequested.exchange(false)) {
+    LOG_INFO("CTRL+C received. Stopping all operations.\n");
+    fault = fault || !executor.idle(); // Work was dropped
+    executor.abort();
+  }
+  if (holdRequested.exchange(false)) {
+    executor.hold();
+  }
+  if (resumeRequested.exchange(false)) {
+    executor.resume();
+  }
+  uint32_t taken = firmwareIo.commandsTaken();
+  executor.poll();
+  bool active = !idle || firmwareIo.commandsTaken() != taken;
+  if (idle && firmwareIo.commandsTaken() != taken) {
+    jobStart = taken; // First command of a new job
+    fault = false;
+  }
+  idle = executor.idle();
+
+  uint8_t state = fault ? STATE_FAULT : executor.held() ? STATE_PAUSED : idle ? STATE_IDLE : STATE_RUNNING;
+  uint8_t lastState = machineStatus.state.exchange(state);
+  machineStatus.command = firmwareIo.commandsTaken() - jobStart;
+  machineStatus.servoAngle = executor.servoAngle();
+  if (idle && active) {
+    machineStatus.jobs++; // The job has ended, with its final state published
+  }
+  if (!idle && !wasActive) {
+    holdFullSpeed(true);
+    setCurrentSampling(true);
+  } else if (idle && wasActive) {
+    holdFullSpeed(false);
+    setCurrentSampling(false);
+  }
+  wasActive = !idle;
+  if (state != lastState || (idle && active)) {
+    wakeLoop(); // LED, telemetry, tuning and fleet jobs follow the state
+  }
+  metrics.motionPollUs.record(micros() - startUs);
+  uint32_t deadlineMs;
+  return !idle || executor.nextDeadlineMs(deadlineMs);
+}
+
+// Compact JSON status frame for /events, e.g.
+// {"state":"running","cmd":12,"queue":5,"x":-4250,"z":1800,"servo":345,"feed":100,"rate":1000,"current":850}
+void formatTelemetry(char *frame, size_t size) {
+  static const char *const stateNames[] = { "idle", "running", "fault", "paused" };
+  snprintf(frame, size, "{\"state\":\"%s\",\"cmd\":%u,\"queue\":%u,\"x\":%d,\"z\":%d,\"servo\":%d,\"feed\":%u,\"rate\":%u,\"current\":%u}",
+           stateNames[machineStatus.state], (unsigned)machineStatus.command,
+           (unsigned)(webCommandQueue.size() + serialCommandQueue.size()), (int)stepperEngine.position(AxisX),
+           (int)stepperEngine.position(AxisZ), (int)machineStatus.servoAngle, (unsigned)feedOverride, (unsigned)stepperEngine.rate(),
+           (unsigned)supplyCurrentMa);
+}
+
+// Push the status to the /events clients: changes at most every TELEMETRY_MIN_INTERVAL_MS, and a
+// heartbeat every TELEMETRY_HEARTBEAT_MS. Frames are built on the stack; nothing is sent without
+// clients.
+void publishTelemetry() {
+  static char lastFrame[160];
+  static uint32_t lastSentMs = 0;
+  static uint32_t frameId = 0;
+  uint32_t now = millis();
+  if (events.count() == 0 || now - lastSentMs < TELEMETRY_MIN_INTERVAL_MS) {
+    return;
+  }
+  char frame[sizeof(lastFrame)];
+  formatTelemetry(frame, sizeof(frame));
+  if (strcmp(frame, lastFrame) == 0 && now - lastSentMs < TELEMETRY_HEARTBEAT_MS) {
+    return;
+  }
+  events.send(frame, "status", ++frameId);
+  memcpy(lastFrame, frame, sizeof(lastFrame));
+  lastSentMs = now;
+}
+
+// Nothing queued, moving or settling any more: the program in flight has finished.
+bool executorIdle() {
+  return executor.idle();
+}
+
+// Text report of the execution metrics: one histogram per line (see formatHistogram), times in
+// microseconds. Planned and actual times of the same kind can be compared by their sums.
+String metricsReport() {
+  const StepperEngine::Metrics &engine = stepperEngine.metrics();
+  const struct {
+    const char *name;
+    const Histogram &histogram;
+  } lines[] = {
+    { "move_planned_us", engine.movePlannedUs },
+    { "move_actual_us", engine.moveActualUs },
+    { "servo_planned_us", metrics.servoPlannedUs },
+    { "servo_actual_us", metrics.servoActualUs },
+    { "delay_planned_us", metrics.delayPlannedUs },
+    { "delay_actual_us", metrics.delayActualUs },
+    { "pulse_latency_us", engine.pulseLatencyUs },
+    { "queue_wait_us", metrics.queueWaitUs },
+    { "motion_poll_us", metrics.motionPollUs },
+    { "loop_us", metrics.loopUs },
+    { "heap_free_bytes", metrics.heapFreeBytes },
+    { "heap_largest_block_bytes", metrics.heapLargestBlockBytes },
+    { "supply_current_ma", metrics.supplyCurrentMa },
+  };
+  char line[160];
+  snprintf(line, sizeof(line), "uptime_ms %u\nlog_dropped %u\n", (unsigned)millis(), (unsigned)logDropped());
+  String report = line;
+  for (const auto &entry : lines) {
+    formatHistogram(entry.name, entry.histogram, line, sizeof(line));
+    report += line;
+  }
+  return report;
+}
+
+// Predict the cycle time of a program with the current settings and servo angle, without moving
+// anything. Compiles and optimizes like processBuffer(); on an error the report holds the message.
+bool estimateBuffer(const String &buffer, String &report) {
+  std::unique_ptr<Instruction[]> program(new Instruction[COMMAND_QUEUE_SIZE]); // Callers run in different tasks
+  std::unique_ptr<uint32_t[]> commandUs(new uint32_t[COMMAND_QUEUE_SIZE]);
+  CompileError error;
+  int count = compileProgram(buffer.c_str(), buffer.length(), programLimits(), program.get(), COMMAND_QUEUE_SIZE, error);
+  if (count < 0) {
+    report = "Error in command " + String(error.command) + ": " + error.message;
+    return false;
+  }
+  if (optimizePrograms) {
+    count = optimizeProgram(program.get(), count, nullptr); // Estimate what would actually run
+  }
+  CycleEstimate estimate;
+  bool finished = estimateCycle(program.get(), count, machineSettings, programLimits(), executor.servoAngle(), commandUs.get(), estimate);
+
+  char line[128];
+  report = "";
+  for (int i = 0; i < count; i++) {
+    char command[32];
+    formatInstruction(program[i], command, sizeof(command));
+    snprintf(line, sizeof(line), "%3d  %-16s %8.3f s\n", i + 1, command, commandUs[i] / 1e6);
+    report += line;
+  }
+  double totalSeconds = estimate.totalUs / 1e6;
+  snprintf(line, sizeof(line), "Total %.3f s (steppers moving %.3f s), %.1f parts/hour%s\n", totalSeconds, estimate.motionUs / 1e6,
+           totalSeconds > 0 ? 3600.0 / totalSeconds : 0.0, finished ? "" : " - stopped after one hour");
+  report += line;
+  return true;
+}
+
+// Serial protocol replies. Every command, $ line and upload is answered by exactly one line
+// starting with "ok" or "error", carrying the free slots of the serial channel. A host keeps at
+// most that many commands in flight; log lines in between never start with either word.
+void serialReplyOk() {
+  Serial.printf("ok %u\n", (unsigned)serialCommandQueue.available());
+}
+
+void serialReplyError(const char *format, ...) {
+  char message[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  Serial.printf("error %u %s\n", (unsigned)serialCommandQueue.available(), message);
+}
+
+// $ control lines: protocol requests that never reach the executor.
+void handleSerialControl(const char *line) {
+  unsigned long bytes;
+  char extra;
+  char name[SerialLineSize];
+  String error;
+  if (sscanf(line, "$UPLOAD %lu %c", &bytes, &extra) == 1) {
+    // The next 'bytes' raw bytes are one comma-separated program; the reply follows them
+    if (bytes == 0) {
+      serialReplyOk(); // Nothing to wait for
+    } else if (!serialFramer.beginUpload(bytes)) {
+      LOG_WARN("Upload of %lu bytes exceeds %d bytes, skipping it.\n", bytes, SERIAL_UPLOAD_SIZE);
+    }
+  } else if (strcmp(line, "$OPTIMIZE 0") == 0 || strcmp(line, "$OPTIMIZE 1") == 0) {
+    optimizePrograms = line[10] == '1';
+    LOG_INFO("Program optimizer %s.\n", optimizePrograms ? "on" : "off");
+    serialReplyOk();
+  } else if (sscanf(line, "$LOG %lu %c", &bytes, &extra) == 1 && bytes <= LEVEL_DEBUG) {
+    logLevel = bytes; // 0 silences the log, 4 adds the debug messages
+    serialReplyOk();
+  } else if (strcmp(line, "$METRICS") == 0) {
+    Serial.print(metricsReport());
+    serialReplyOk();
+  } else if (sscanf(line, "$SAVE %95s %lu %c", name, &bytes, &extra) == 2) {
+    // Like $UPLOAD, but the program is stored in the library instead of run
+    if (!ProgramLibrary::validName(name) || bytes == 0) {
+      serialReplyError("Usage: $SAVE <name> <bytes>, names are 1-%d letters, digits, '-' or '_'", ProgramNameSize - 1);
+    } else if (serialFramer.beginUpload(bytes)) {
+      strcpy(serialSaveName, name);
+    } else {
+      LOG_WARN("Upload of %lu bytes exceeds %d bytes, skipping it.\n", bytes, SERIAL_UPLOAD_SIZE);
+    }
+  } else if (sscanf(line, "$RUN %95s %c", name, &extra) == 1) {
+    if (queueStoredProgram(serialCommandQueue, SERIAL_PROGRAM, serialProgram, name, error) == QUEUED) {
+      serialReplyOk();
+    } else {
+      serialReplyError("%s", error.c_str());
+    }
+  } else if (sscanf(line, "$LOAD %95s %c", name, &extra) == 1) {
+    String source;
+    if (programLibrary.readSource(name, source, error)) {
+      Serial.printf("program %s %s\n", name, source.c_str());
+      serialReplyOk();
+    } else {
+      serialReplyError("%s", error.c_str());
+    }
+  } else if (sscanf(line, "$DELETE %95s %c", name, &extra) == 1) {
+    if (programLibrary.remove(name, error)) {
+      serialReplyOk();
     } else {
-      commandBuffer += incomingChar; // Append the character to the buffer
+      serialReplyError("%s", error.c_str());
     }
+  } else if (strcmp(line, "$PROGRAMS") == 0) {
+    String listing = programListing();
+    int start = 0, end;
+    while ((end = listing.indexOf('\n', start)) >= 0) {
+      Serial.print("program " + listing.substring(start, end + 1)); // Never starts with "ok" or "error"
+      start = end + 1;
+    }
+    serialReplyOk();
+  } else if (strcmp(line, "$TUNE X") == 0 || strcmp(line, "$TUNE Z") == 0) {
+    requestTune(line[6], commandBuffer()); // Trials run the current command buffer
+    serialReplyOk();
+  } else if (strcmp(line, "$TUNE") == 0) {
+    Serial.printf("tune %s\n", tuneStatus().c_str());
+    serialReplyOk();
+  } else if (strcmp(line, "$FLEET") == 0) {
+    Serial.printf("fleet %s\n", fleetLink.describe().c_str());
+    serialReplyOk();
+  } else if (strcmp(line, "$STATUS") == 0) {
+    // Only state that is safe to read from this task: the executor belongs to the motion task
+    Serial.printf("status serial=%u web=%u moving=%d\n", (unsigned)serialCommandQueue.size(), (unsigned)webCommandQueue.size(), stepperEngine.isBusy());
+    serialReplyOk();
+  } else {
+    serialReplyError("Unknown control line '%s'", line);
+  }
+}
+
+// One framed serial command: compiled straight from the line buffer, no String in the way.
+void handleSerialLine(const char *line, size_t length) {
+  if (line[0] == '$') {
+    handleSerialControl(line);
+    return;
+  }
+  if (strcmp(line, "E") == 0) { // Estimate the cycle time of the current command buffer
+    String report;
+    String buffer = commandBuffer();
+    estimateBuffer(buffer, report);
+    Serial.print("Estimate for: " + buffer + "\n" + report);
+    serialReplyOk();
+    return;
+  }
+  Instruction instruction;
+  CompileError error;
+  if (!compileCommand(line, length, programLimits(), instruction, error)) {
+    serialReplyError("Invalid command '%s': %s", line, error.message);
+  } else if (!serialCommandQueue.push(instruction)) {
+    serialReplyError("Command queue full. Command '%s' rejected.", line);
+  } else {
+    wakeMotionTask();
+    serialReplyOk();
   }
+}
 
-  // If there are no more characters to read and the buffer is not empty, process the last command
-  if (!commandBuffer.isEmpty() && commandBuffer.indexOf(',') == -1) {
-    commandBuffer.trim(); // Remove any extra whitespace
-    commandQueue.push(commandBuffer); // Add the last command to the queue
-    commandBuffer = ""; // Clear the buffer after adding the command
+// A complete $UPLOAD: compiled and queued as a whole, like a program from the web UI.
+void handleSerialUpload(const char *text, size_t length) {
+  String error;
+  bool ok;
+  if (serialSaveName[0]) {
+    ok = saveProgram(serialSaveName, serialProgram, text, length, error); // Announced by $SAVE
+    serialSaveName[0] = '\0';
+  } else {
+    ok = queueProgram(serialCommandQueue, SERIAL_PROGRAM, serialProgram, text, length, error) == QUEUED;
   }
+  if (ok) {
+    serialReplyOk();
+  } else {
+    serialReplyError("%s", error.c_str());
+  }
+}
+
+SaveResult saveValues();
+String jsonEscape(const String &text);
+bool fleetJobActive();
+
+// A tuning run, owned by loop(). Each trial queues the axis feedrate and acceleration followed
+// by the trial program on the serial channel, and is judged by the peak supply current of its
+// moves once the job has ended. At the end the best values (or, if none passed, the original
+// ones) are queued the same way, then saved.
+struct TuneRun {
+  FeedTuner tuner;
+  char axis = 0;          // 'X' or 'Z' while a run is in progress
+  String program;
+  uint32_t originalFeedrate = 0;
+  uint32_t originalAccel = 0;
+  uint32_t jobs = 0;      // machineStatus.jobs when the last program was queued
+  bool finishing = false; // The final settings are queued
+  bool save = false;      // ... and saved once they ran
+};
+TuneRun tuneRun;
+
+void setTuneReport(const char *format, ...) {
+  char report[sizeof(tuneReport)];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(report, sizeof(report), format, args);
+  va_end(args);
+  LOG_INFO("%s\n", report);
+  std::lock_guard<std::mutex> guard(tuneLock);
+  strcpy(tuneReport, report);
+}
 
-  // Execute the next command in the queue if available
-  if (!commandQueue.empty()) {
-    processNextCommand();
+// Queue the axis settings, then the program if there is one
+bool queueTuneProgram(uint32_t feedrate, uint32_t accel, const String &program) {
+  TuneRun &run = tuneRun;
+  char settings[40];
+  snprintf(settings, sizeof(settings), "%c%u, %c%u", run.axis == 'X' ? 'F' : 'G', (unsigned)feedrate, run.axis == 'X' ? 'A' : 'B',
+           (unsigned)accel);
+  String text = program.length() > 0 ? String(settings) + ", " + program : String(settings);
+  String error;
+  run.jobs = machineStatus.jobs;
+  return queueProgram(serialCommandQueue, SERIAL_PROGRAM, serialProgram, text.c_str(), text.length(), error) == QUEUED;
+}
+
+void startTuneTrial() {
+  TuneRun &run = tuneRun;
+  currentPeakMa = 0;
+  currentPeakRate = 0;
+  currentTripped = false;
+  setTuneReport("Tuning %c, trial %u: feedrate %u, accel %u", run.axis, (unsigned)run.tuner.trials() + 1, (unsigned)run.tuner.feedrate(),
+                (unsigned)run.tuner.accel());
+  if (!queueTuneProgram(run.tuner.feedrate(), run.tuner.accel(), run.program)) {
+    setTuneReport("Tuning %c cancelled: the trial program was rejected.", run.axis);
+    run.axis = 0;
   }
+}
 
-  // Indicate the system is ready if no commands are in the queue
-  if (commandQueue.empty()) {
-    setReadyState();
+void startRequestedTuning() {
+  TuneRequest request;
+  {
+    std::lock_guard<std::mutex> guard(tuneLock);
+    request = tuneRequest;
+    tuneRequest.axis = 0;
+  }
+  if (request.axis == 0) {
+    return;
   }
+  uint8_t state = machineStatus.state;
+  if (!currentSensing) {
+    setTuneReport("Tuning needs the INA260 current sensor, none was found.");
+    return;
+  }
+  if (state == STATE_RUNNING || state == STATE_PAUSED || fleetJobActive()) {
+    setTuneReport("Tuning not started: a job is running.");
+    return;
+  }
+  TuneRun &run = tuneRun;
+  run.axis = request.axis;
+  run.program = request.program;
+  run.originalFeedrate = run.axis == 'X' ? machineSettings.xFeedrate : machineSettings.zFeedrate; // Not changing while idle
+  run.originalAccel = run.axis == 'X' ? machineSettings.xAccel : machineSettings.zAccel;
+  run.finishing = false;
+  TuneLimits limits = { TUNE_MAX_FEEDRATE, TUNE_MAX_ACCEL, TUNE_STEP_PERCENT, CURRENT_OVERLOAD_MA, TUNE_MARGIN_MA };
+  run.tuner.begin(run.originalFeedrate, run.originalAccel, limits);
+  startTuneTrial();
 }
 
-void deleteConfigFile() {
-  if (SPIFFS.exists("/config.txt")) {
-    if (SPIFFS.remove("/config.txt")) {
-      Serial.println("Config file deleted successfully.");
+// Tuning mode: steps the feedrate, then the acceleration of one axis up until the current
+// margin runs out (see FeedTuner), and saves the fastest values that kept it. A CTRL+C or
+// /stop during a trial cancels the run and restores the original values.
+void pollTuning() {
+  TuneRun &run = tuneRun;
+  if (run.axis == 0) {
+    startRequestedTuning();
+    return;
+  }
+  if (machineStatus.jobs == run.jobs) {
+    return; // The queued program is still running
+  }
+  if (run.finishing) {
+    run.axis = 0;
+    if (run.save && saveValues() == CONFIG_FAILED) {
+      LOG_ERROR("Tuned values could not be saved.\n");
+    }
+    return;
+  }
+  bool tripped = currentTripped;
+  uint32_t peak = currentPeakMa;
+  uint32_t peakRate = currentPeakRate;
+  FeedTuner &tuner = run.tuner;
+  if (machineStatus.state == STATE_FAULT && !tripped) {
+    tuner.cancel();
+    setTuneReport("Tuning %c cancelled after %u trials, original values restored.", run.axis, (unsigned)tuner.trials());
+  } else {
+    LOG_INFO("Tuning %c: feedrate %u, accel %u peaked at %u mA, %u steps/s%s.\n", run.axis, (unsigned)tuner.feedrate(),
+             (unsigned)tuner.accel(), (unsigned)peak, (unsigned)peakRate, tripped ? ", stopped by the current monitor" : "");
+    tuner.report(peak, peakRate, tripped);
+    if (tuner.active()) {
+      startTuneTrial();
+      return;
+    }
+    if (tuner.passed()) {
+      setTuneReport("Tuning %c done after %u trials: feedrate %u, accel %u saved.", run.axis, (unsigned)tuner.trials(),
+                    (unsigned)tuner.bestFeedrate(), (unsigned)tuner.bestAccel());
     } else {
-      Serial.println("Failed to delete config file.");
+      setTuneReport("Tuning %c: feedrate %u, accel %u already leave less than %u mA of margin, nothing changed.", run.axis,
+                    (unsigned)run.originalFeedrate, (unsigned)run.originalAccel, (unsigned)TUNE_MARGIN_MA);
     }
+  }
+  run.save = tuner.phase() == TUNE_DONE && tuner.passed();
+  run.finishing = run.save ? queueTuneProgram(tuner.bestFeedrate(), tuner.bestAccel(), "")
+                           : queueTuneProgram(run.originalFeedrate, run.originalAccel, "");
+  if (!run.finishing) {
+    LOG_ERROR("Tuning %c: the final settings were rejected.\n", run.axis);
+    run.axis = 0;
+  }
+}
+
+bool tuningActive() {
+  return tuneRun.axis != 0;
+}
+
+// Fleet job, owned by loop(): a program from bender/<name>/job, compiled and optimized once into
+// fleetProgram and queued 'repeat' times on the serial channel, one part whenever the last one has ended.
+// Every part is reported on bender/<name>/event with its cycle time; a part that ends in the
+// fault state (stop, stall, overload) ends the job.
+struct FleetJob {
+  char id[FLEET_JOB_ID_SIZE] = ""; // Empty while there is no job
+  uint32_t repeat = 0;
+  uint32_t done = 0;          // Parts finished
+  int count = 0;              // Instructions in fleetProgram
+  uint32_t jobs = 0;          // machineStatus.jobs when the running part was queued
+  uint32_t partStartMs = 0;
+  uint32_t jobStartMs = 0;
+  bool cancelled = false;
+};
+FleetJob fleetJob;
+Instruction fleetProgram[COMMAND_QUEUE_SIZE]; // The job's program, queued as it is for every part
+uint32_t fleetParts = 0;       // Parts finished since boot
+uint32_t fleetFaults = 0;      // Jobs ended by a fault since boot
+uint32_t fleetLastCycleMs = 0; // Cycle time of the last part
+
+bool fleetJobActive() {
+  return fleetJob.id[0] != '\0';
+}
+
+void publishFleetEvent(const char *format, ...) {
+  char event[192];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(event, sizeof(event), format, args);
+  va_end(args);
+  fleetLink.publish("event", event);
+}
+
+void rejectFleetJob(const char *id, const String &reason) {
+  LOG_WARN("Fleet job %s rejected: %s\n", id, reason.c_str());
+  publishFleetEvent("{\"event\":\"rejected\",\"job\":\"%s\",\"reason\":\"%s\"}", id, jsonEscape(reason).c_str());
+}
+
+bool queueFleetPart(String &error) {
+  FleetJob &job = fleetJob;
+  job.jobs = machineStatus.jobs;
+  job.partStartMs = millis();
+  currentTripped = false;
+  return queueCompiledProgram(serialCommandQueue, SERIAL_PROGRAM, fleetProgram, job.count, error, false) == QUEUED;
+}
+
+// A job message: "<id> <repeat>" on the first line and the program text below it, or
+// "<id> <repeat> <name>" alone to run a program from the library.
+void acceptFleetJob(const char *payload, size_t length) {
+  FleetJob &job = fleetJob;
+  const char *newline = (const char *)memchr(payload, '\n', length);
+  size_t headerLength = newline ? newline - payload : length;
+  char header[FLEET_JOB_ID_SIZE + ProgramNameSize + 16];
+  char id[FLEET_JOB_ID_SIZE] = "?";
+  char name[ProgramNameSize] = "";
+  unsigned long repeat = 0;
+  char extra;
+  if (headerLength >= sizeof(header)) {
+    rejectFleetJob(id, "Header line too long");
+    return;
+  }
+  memcpy(header, payload, headerLength);
+  header[headerLength] = '\0';
+  int fields = sscanf(header, "%31s %lu %23s %c", id, &repeat, name, &extra);
+  const char *text = newline ? newline + 1 : payload + length;
+  size_t textLength = payload + length - text;
+  if (fields < 2 || fields > 3 || repeat == 0) {
+    rejectFleetJob(id, "Usage: \"<id> <repeat>\" and the program on the next lines, or \"<id> <repeat> <library name>\"");
+    return;
+  }
+  uint8_t state = machineStatus.state;
+  if (fleetJobActive() || tuningActive() || state == STATE_RUNNING || state == STATE_PAUSED) {
+    rejectFleetJob(id, "Machine busy");
+    return;
+  }
+  String error;
+  int count = fields == 3 ? programLibrary.load(name, fleetProgram, COMMAND_QUEUE_SIZE, programLimits(), error)
+                          : compileBuffer(fleetProgram, text, textLength, error);
+  if (count == 0) {
+    error = "Empty program";
+  }
+  if (count <= 0) {
+    rejectFleetJob(id, error);
+    return;
+  }
+  count = optimizeCompiledProgram(fleetProgram, count); // Once for the whole job
+  strcpy(job.id, id);
+  job.repeat = repeat;
+  job.done = 0;
+  job.count = count;
+  job.cancelled = false;
+  job.jobStartMs = millis();
+  if (!queueFleetPart(error)) {
+    job.id[0] = '\0';
+    rejectFleetJob(id, error);
+    return;
+  }
+  LOG_INFO("Fleet job %s: %u parts.\n", id, (unsigned)repeat);
+  publishFleetEvent("{\"event\":\"accepted\",\"job\":\"%s\",\"of\":%u}", id, (unsigned)repeat);
+}
+
+// Messages on the machine's topics, delivered by fleetLink.poll() in loop()
+void onFleetMessage(const char *leaf, const char *payload, size_t length) {
+  if (strcmp(leaf, "job") == 0) {
+    acceptFleetJob(payload, length);
+  } else if (strcmp(leaf, "cancel") == 0 && fleetJobActive()) {
+    // An empty payload cancels whatever job runs, otherwise only the job of that id
+    if (length == 0 || (length == strlen(fleetJob.id) && memcmp(payload, fleetJob.id, length) == 0)) {
+      fleetJob.cancelled = true;
+      requestStop();
+    }
+  }
+}
+
+// Count the part that just ended and queue the next one, or end the job
+void pollFleetJob() {
+  FleetJob &job = fleetJob;
+  if (!fleetJobActive() || machineStatus.jobs == job.jobs) {
+    return; // No job, or its part is still running
+  }
+  uint32_t cycleMs = millis() - job.partStartMs;
+  bool fault = machineStatus.state == STATE_FAULT;
+  if (!fault) {
+    job.done++;
+    fleetParts++;
+    fleetLastCycleMs = cycleMs;
+    publishFleetEvent("{\"event\":\"part\",\"job\":\"%s\",\"done\":%u,\"of\":%u,\"cycle_ms\":%u}", job.id, (unsigned)job.done,
+                      (unsigned)job.repeat, (unsigned)cycleMs);
+  }
+  String error;
+  if (fault || job.cancelled) {
+    const char *reason = job.cancelled ? "cancelled" : currentTripped ? "current" : "stopped";
+    fleetFaults += fault ? 1 : 0;
+    LOG_WARN("Fleet job %s ended after %u of %u parts: %s.\n", job.id, (unsigned)job.done, (unsigned)job.repeat, reason);
+    publishFleetEvent("{\"event\":\"%s\",\"job\":\"%s\",\"done\":%u,\"of\":%u,\"reason\":\"%s\"}", job.cancelled ? "cancelled" : "fault",
+                      job.id, (unsigned)job.done, (unsigned)job.repeat, reason);
+  } else if (job.done == job.repeat) {
+    LOG_INFO("Fleet job %s done: %u parts.\n", job.id, (unsigned)job.done);
+    publishFleetEvent("{\"event\":\"done\",\"job\":\"%s\",\"done\":%u,\"of\":%u,\"total_ms\":%u}", job.id, (unsigned)job.done,
+                      (unsigned)job.repeat, (unsigned)(millis() - job.jobStartMs));
+  } else if (queueFleetPart(error)) {
+    return;
   } else {
-    Serial.println("Config file does not exist.");
+    fleetFaults++;
+    LOG_ERROR("Fleet job %s: part %u rejected: %s\n", job.id, (unsigned)job.done + 1, error.c_str());
+    publishFleetEvent("{\"event\":\"fault\",\"job\":\"%s\",\"done\":%u,\"of\":%u,\"reason\":\"%s\"}", job.id, (unsigned)job.done,
+                      (unsigned)job.repeat, jsonEscape(error).c_str());
   }
+  job.id[0] = '\0';
+  job.done = 0;
+  job.repeat = 0;
 }
 
-void saveValues(AsyncWebServerRequest *request) {
-  File file = SPIFFS.open("/config.txt", FILE_WRITE);
-  if (!file) {
-    Serial.println("Failed to open config file for writing.");
+// Retained fleet status on bender/<name>/status, e.g.
+// {"state":"running","job":"j7","done":3,"of":10,"cycle_ms":4120,"parts":57,"faults":0}
+// A machine is free for a job when its state is "idle". Changes go out at most every
+// FLEET_STATUS_MIN_INTERVAL_MS, and at once after a reconnect.
+void publishFleetStatus() {
+  static const char *const stateNames[] = { "idle", "running", "fault", "paused" };
+  static char lastStatus[160];
+  static uint32_t lastSentMs = 0;
+  static bool wasConnected = false;
+  bool reconnected = fleetLink.connected() && !wasConnected;
+  wasConnected = fleetLink.connected();
+  uint32_t now = millis();
+  if (!wasConnected || (!reconnected && now - lastSentMs < FLEET_STATUS_MIN_INTERVAL_MS)) {
     return;
   }
-  file.printf("XSpeed:%d\n", X_FEEDRATE);
-  file.printf("ZSpeed:%d\n", Z_FEEDRATE);
-  file.printf("globalXValue:%d\n", globalXValue); // Save globalXValue
-  file.printf("globalDelayMs:%d\n", globalDelayMs); // Save globalDelayMs
-  // Save the global command buffer
-  file.printf("CommandBuffer:%s\n", globalCommandBuffer.c_str());
-  Serial.printf("CommandBuffer:%s\n", globalCommandBuffer.c_str());
+  uint8_t state = machineStatus.state;
+  if (fleetJobActive() && state != STATE_PAUSED) {
+    state = STATE_RUNNING; // Also between parts, and while a stopped part winds down
+  }
+  char status[sizeof(lastStatus)];
+  snprintf(status, sizeof(status), "{\"state\":\"%s\",\"job\":\"%s\",\"done\":%u,\"of\":%u,\"cycle_ms\":%u,\"parts\":%u,\"faults\":%u}",
+           tuningActive() ? "tuning" : stateNames[state], fleetJob.id, (unsigned)fleetJob.done, (unsigned)fleetJob.repeat,
+           (unsigned)fleetLastCycleMs, (unsigned)fleetParts, (unsigned)fleetFaults);
+  if (!reconnected && strcmp(status, lastStatus) == 0 && now - lastSentMs < FLEET_STATUS_HEARTBEAT_MS) {
+    return;
+  }
+  if (fleetLink.publish("status", status, true)) {
+    memcpy(lastStatus, status, sizeof(lastStatus));
+    lastSentMs = now;
+  }
+}
 
-  file.close();
-  Serial.println("Values saved to config file.");
+// Fleet mode: the MQTT connection, job messages, the running job and its status
+void pollFleet() {
+  if (!fleetLink.configured()) {
+    return;
+  }
+  uint8_t state = machineStatus.state;
+  fleetLink.poll(!fleetJobActive() && state != STATE_RUNNING && state != STATE_PAUSED);
+  pollFleetJob();
+  publishFleetStatus();
 }
 
-void loadValues() {
-  File file = SPIFFS.open("/config.txt", FILE_READ);
-  if (!file) {
-    Serial.println("Config file not found. Continuing with default values.");
-    return; // Continue with default values if the file does not exist
+// Status LED: green ready, red running, yellow paused, magenta after a stop. strip.show()
+// disables interrupts while it clocks the pixel out, so the LED is only written when the state
+// changes.
+void updateStatusLed() {
+  static uint8_t shown = STATE_IDLE; // setup() turned it green
+  uint8_t state = machineStatus.state;
+  if (state == shown) {
+    return;
   }
+  switch (state) {
+    case STATE_IDLE:
+      setReadyState();
+      break;
+    case STATE_RUNNING:
+      setProcessingState();
+      break;
+    case STATE_PAUSED:
+      led_on(YELLOW);
+      break;
+    default:
+      led_on(MAGENTA);
+      break;
+  }
+  shown = state;
+}
 
-  while (file.available()) {
-    String line = file.readStringUntil('\n');
-    if (line.startsWith("XSpeed:")) {
-      X_FEEDRATE = line.substring(7).toInt();
-    } else if (line.startsWith("ZSpeed:")) {
-      Z_FEEDRATE = line.substring(7).toInt();
-    } else if (line.startsWith("globalXValue:")) {
-      globalXValue = line.substring(13).toInt(); // Load globalXValue
-    } else if (line.startsWith("globalDelayMs:")) {
-      globalDelayMs = line.substring(14).toInt(); // Load globalDelayMs
-    } else if (line.startsWith("CommandBuffer:")) {
-      globalCommandBuffer = line.substring(14); // Load the command buffer into the global variable
-      globalCommandBuffer.trim(); // Remove any extra whitespace
+// The Arduino loop only reads serial input and publishes the status; commands run in the motion
+// task. Input is read in chunks and framed by serialFramer, so nothing is allocated per byte and
+// a pause from the host never splits a command. Between passes loop() sleeps until serial input
+// arrives or the machine state changes (see PowerSave.h), or at the latest LOOP_IDLE_WAIT_MS.
+void loop() {
+  static uint32_t heapSampledMs = 0;
+  uint32_t startUs = micros();
+  uint8_t chunk[64];
+  int available;
+  while ((available = Serial.available()) > 0) {
+    size_t count = Serial.readBytes(chunk, available < (int)sizeof(chunk) ? available : sizeof(chunk));
+    for (size_t i = 0; i < count; i++) {
+      switch (serialFramer.push(chunk[i])) {
+        case FRAME_REALTIME: // CTRL+C or feed override, even in the middle of a move or upload
+          handleRealtimeByte(serialFramer.realtimeByte());
+          break;
+        case FRAME_LINE:
+          handleSerialLine(serialFramer.line(), serialFramer.lineLength());
+          break;
+        case FRAME_UPLOAD:
+          handleSerialUpload(serialFramer.upload(), serialFramer.uploadLength());
+          break;
+        case FRAME_OVERFLOW:
+          serialSaveName[0] = '\0'; // An oversized $SAVE upload is skipped like any other
+          serialReplyError("Line or upload too long (lines up to %d, uploads up to %d characters)", (int)SerialLineSize, SERIAL_UPLOAD_SIZE);
+          break;
+        default:
+          break;
+      }
     }
   }
-  file.close();
 
-  Serial.println("Values loaded from config file.");
-  Serial.printf("Loaded globalXValue: %d\n", globalXValue);
-  Serial.printf("Loaded globalDelayMs: %d ms\n", globalDelayMs);
-  Serial.printf("Loaded CommandBuffer: %s\n", globalCommandBuffer.c_str());
+  updateStatusLed();
+  publishTelemetry();
+  pollTuning();
+  pollFleet();
+  if (millis() - heapSampledMs >= HEAP_SAMPLE_MS) {
+    heapSampledMs = millis();
+    metrics.heapFreeBytes.record(ESP.getFreeHeap());
+    metrics.heapLargestBlockBytes.record(ESP.getMaxAllocHeap());
+  }
+  metrics.loopUs.record(micros() - startUs);
+  waitForLoopEvent(fleetLink.configured() ? FLEET_POLL_MS : LOOP_IDLE_WAIT_MS);
+}
+
+// The settings /saveValues stores, as they are now
+ConfigValues currentValues() {
+  ConfigValues values;
+  values.xFeedrate = machineSettings.xFeedrate;
+  values.zFeedrate = machineSettings.zFeedrate;
+  values.xAccel = machineSettings.xAccel;
+  values.zAccel = machineSettings.zAccel;
+  values.xJerk = machineSettings.xJerk;
+  values.zJerk = machineSettings.zJerk;
+  values.globalXValue = machineSettings.globalXValue;
+  values.globalDelayMs = machineSettings.globalDelayMs;
+  values.servoDegPerSecond = machineSettings.servoDegPerSecond;
+  values.optimize = optimizePrograms;
+  values.commandBuffer = commandBuffer();
+  return values;
+}
+
+SaveResult saveValues() {
+  ConfigValues values = currentValues();
+  LOG_DEBUG("CommandBuffer:%s\n", values.commandBuffer.c_str());
+  SaveResult result = configStore.save(values);
+  if (result == CONFIG_UNCHANGED) {
+    LOG_INFO("Values unchanged, nothing written.\n");
+  }
+  return result;
+}
+
+// Apply the saved values at boot, before the motion task runs. They are cached in RAM, so this
+// never reads flash.
+void loadValues() {
+  if (!configStore.hasValues()) {
+    return; // Continue with default values if nothing was saved
+  }
+  ConfigValues values = configStore.values();
+  machineSettings.xFeedrate = values.xFeedrate;
+  machineSettings.zFeedrate = values.zFeedrate;
+  machineSettings.xAccel = values.xAccel;
+  machineSettings.zAccel = values.zAccel;
+  machineSettings.xJerk = values.xJerk;
+  machineSettings.zJerk = values.zJerk;
+  machineSettings.globalXValue = values.globalXValue;
+  machineSettings.globalDelayMs = values.globalDelayMs;
+  machineSettings.servoDegPerSecond = values.servoDegPerSecond;
+  optimizePrograms = values.optimize;
+  setCommandBuffer(values.commandBuffer);
+
+  LOG_INFO("Loaded globalXValue: %d\n", (int)machineSettings.globalXValue);
+  LOG_INFO("Loaded globalDelayMs: %d ms\n", (int)machineSettings.globalDelayMs);
+  LOG_DEBUG("Loaded CommandBuffer: %s\n", values.commandBuffer.c_str());
+}
+
+// Back to the saved values once the motion task runs. The executor owns machineSettings then, so
+// the settings are queued on the web channel as setting commands and take effect between two
+// commands, like an F or A in a program. 'values' gets what is loaded (the values in force when
+// nothing was saved).
+QueueResult queueSavedValues(ConfigValues &values, String &errorMessage) {
+  if (!configStore.hasValues()) {
+    values = currentValues();
+    return QUEUED; // Nothing to change
+  }
+  values = configStore.values();
+  const Instruction settings[] = {
+    { OP_X_FEEDRATE, values.xFeedrate, 0 }, { OP_Z_FEEDRATE, values.zFeedrate, 0 },
+    { OP_X_ACCEL, values.xAccel, 0 },       { OP_Z_ACCEL, values.zAccel, 0 },
+    { OP_X_JERK, values.xJerk, 0 },         { OP_Z_JERK, values.zJerk, 0 },
+    { OP_SET_X_VALUE, values.globalXValue, 0 }, { OP_SET_DELAY, values.globalDelayMs, 0 },
+    { OP_SERVO_SPEED, values.servoDegPerSecond, 0 },
+  };
+  int count = sizeof(settings) / sizeof(settings[0]);
+  memcpy(compiledProgram, settings, sizeof(settings));
+  QueueResult result = queueCompiledProgram(webCommandQueue, WEB_PROGRAM, compiledProgram, count, errorMessage, false);
+  if (result == QUEUED) {
+    optimizePrograms = values.optimize;
+    setCommandBuffer(values.commandBuffer);
+  }
+  return result;
+}
+
+// Quote a string for a JSON reply
+String jsonEscape(const String &text) {
+  String escaped;
+  escaped.reserve(text.length() + 8);
+  for (size_t i = 0; i < text.length(); i++) {
+    char c = text[i];
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if ((uint8_t)c < 0x20) {
+      char code[8];
+      snprintf(code, sizeof(code), "\\u%04x", (unsigned)(uint8_t)c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
 }
 
 void setupWiFi() {
@@ -324,204 +1365,161 @@ void setupWiFi() {
   Serial.println(apName);
   Serial.print("IP address: ");
   Serial.println(WiFi.softAPIP());
+
+  // Fleet mode: also join the network in /fleet.txt and take jobs from its MQTT broker
+  char machineName[16];
+  snprintf(machineName, sizeof(machineName), "%02X%02X%02X", mac[3], mac[4], mac[5]);
+  if (fleetLink.load(machineName)) {
+    fleetLink.begin(onFleetMessage);
+  }
 }
 
+// Serves the embedded web UI straight from flash, gzip-compressed as built, so a page load
+// allocates nothing for the content. The ETag lets browsers revalidate their cached copy and get
+// an empty 304 while the firmware has not changed.
+class WebAssetHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    if (request->method() != HTTP_GET || !find(request->url())) {
+      return false;
+    }
+    request->addInterestingHeader("If-None-Match"); // Dropped by the server unless asked for
+    return true;
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override {
+    const WebAsset *asset = find(request->url());
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == asset->etag) {
+      response = request->beginResponse(304);
+    } else {
+      response = request->beginResponse_P(200, asset->contentType, asset->data, asset->length);
+      response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Cache-Control", asset->cacheControl);
+    request->send(response);
+  }
+
+private:
+  static const WebAsset *find(const String &url) {
+    for (const WebAsset &asset : webAssets) {
+      if (url == asset.url) {
+        return &asset;
+      }
+    }
+    return nullptr;
+  }
+};
+
 void setupWebServer() {
-  // Serve the HTML page
-  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String html = R"rawliteral(
-      <!DOCTYPE html>
-      <html>
-      <head>
-        <title>ESP32-S2 Control )rawliteral" + String(VERSION) + R"rawliteral(</title>
-        <style>
-          body { font-family: Arial, sans-serif; text-align: center; margin-top: 50px; }
-          input, textarea { padding: 10px; width: 600px; } /* Buffer text box 200% wider */
-          textarea { resize: none; } /* Prevent resizing of the text area */
-          .large-button { 
-            padding: 30px 60px; /* 200% larger */
-            font-size: 24px; 
-            font-weight: bold; /* Bold text */
-            margin: 10px; 
-          }
-          .small-button { 
-            padding: 10px 20px; 
-            font-weight: bold; /* Bold text */
-            margin: 5px; 
-          }
-          .button-container { margin-top: 20px; }
-          .example-command, h2 { font-size: 16px; } /* Match size of <label> text */
-        </style>
-        <script>
-          // Removed unused variable `let isRunning = false;`
-
-          function sendCommandBuffer() {
-            const commandBuffer = document.getElementById('commandBuffer').value.trim();
-            if (!commandBuffer) {
-              document.getElementById('response').innerText = 'Error: Command buffer cannot be empty.';
-              return;
-            }
-            updateBackgroundColor('red'); // Indicate program is running
-            fetch(`/commandBuffer?buffer=${encodeURIComponent(commandBuffer)}`)
-              .then(response => response.text())
-              .then(data => {
-                document.getElementById('response').innerText = data;
-                // Removed the undefined checkStatus function call
-              })
-              .catch(err => {
-                document.getElementById('response').innerText = 'Error sending command buffer';
-                updateBackgroundColor('red'); // Indicate error
-              });
-          }
-
-          function setSpeed(axis) {
-            const value = document.getElementById(`${axis}Speed`).value.trim();
-            if (!value || isNaN(value)) {
-              document.getElementById('response').innerText = `Error: Enter a valid speed for ${axis}-axis.`;
-              return;
-            }
-            const command = axis === 'X' ? `F${value}` : `G${value}`;
-            fetch(`/command?cmd=${command}`)
-              .then(response => response.text())
-              .then(data => {
-                document.getElementById('response').innerText = data;
-              })
-              .catch(err => {
-                document.getElementById('response').innerText = `Error setting speed for ${axis}-axis.`;
-              });
-          }
-
-          function saveValues() {
-            fetch(`/saveValues`)
-              .then(response => response.text())
-              .then(data => {
-                document.getElementById('response').innerText = data;
-              })
-              .catch(err => {
-                document.getElementById('response').innerText = 'Error saving values.';
-              });
-          }
-
-          function loadValues() {
-            fetch(`/loadValues`)
-              .then(response => response.text())
-              .then(data => {
-                const values = JSON.parse(data);
-                document.getElementById('XSpeed').value = values.XSpeed;
-                document.getElementById('ZSpeed').value = values.ZSpeed;
-                document.getElementById('commandBuffer').value = values.Buffer;
-                document.getElementById('response').innerText = 'Values loaded successfully.';
-              })
-              .catch(err => {
-                document.getElementById('response').innerText = 'Error loading values.';
-              });
-          }
-
-          function deleteConfig() {
-            fetch(`/deleteConfig`)
-              .then(response => response.text())
-              .then(data => {
-                document.getElementById('response').innerText = data;
-              })
-              .catch(err => {
-                document.getElementById('response').innerText = 'Error deleting config file.';
-              });
-          }
-
-          function updateBackgroundColor(color) {
-            document.body.style.backgroundColor = color;
-          }
-
-          function loadWire() {
-            fetch(`/loadWire`)
-              .then(response => response.text())
-              .then(data => {
-                document.getElementById('response').innerText = data;
-              })
-              .catch(err => {
-                document.getElementById('response').innerText = 'Error executing LOAD WIRE command.';
-              });
-          }
-
-          function navigateToHelp() {
-            window.location.href = '/help';
-          }
-
-          
-        </script>
-      </head>
-      <body>
-        <h1>WIRE BENDER - )rawliteral" + String(VERSION) + R"rawliteral(</h1>
-        <div>
-          <textarea id="commandBuffer" rows="4" cols="50" placeholder="Enter command buffer (e.g., S90,Z100,D500)"></textarea>
-          <br>
-          <div class="button-container">
-            <button class="large-button" onclick="sendCommandBuffer()">Send Buffer</button>
-            <button class="large-button" onclick="loadWire()">LOAD WIRE</button>
-          </div>
-          <div class="button-container">
-            <button class="small-button" onclick="saveValues()">Save Values</button>
-            <button class="small-button" onclick="loadValues()">Load Values</button>
-            <button class="small-button" onclick="deleteConfig()">Delete Config File</button>
-            <button class="small-button" onclick="window.location.href='/viewConfig'">View Config File</button>
-            <button class="small-button" onclick="navigateToHelp()">HELP</button>
-          </div>
-        </div>
-        <div style="margin-top: 20px;">
-          <label for="XSpeed">X-axis Speed:</label>
-          <input type="number" id="XSpeed" placeholder="Enter speed for X">
-          <button class="small-button" onclick="setSpeed('X')">Set X Speed</button>
-          <br><br>
-          <label for="ZSpeed">Z-axis Speed:</label>
-          <input type="number" id="ZSpeed" placeholder="Enter speed for Z">
-          <button class="small-button" onclick="setSpeed('Z')">Set Z Speed</button>
-        </div>
-        <div id="response" style="margin-top: 20px; color: blue;"></div>
-      </body>
-      </html>
-    )rawliteral";
-    request->send(200, "text/html", html);
+  // The UI pages and script (web/, embedded at build time by tools/embed_web.py)
+  server.addHandler(new WebAssetHandler());
+
+  // Live status stream; a new client gets the current status at once
+  events.onConnect([](AsyncEventSourceClient *client) {
+    char frame[160];
+    formatTelemetry(frame, sizeof(frame));
+    client->send(frame, "status", 0, 1000); // Reconnect after a second if the connection drops
   });
+  server.addHandler(&events);
 
-  // Add a new endpoint for the help page
-  server.on("/help", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String helpHtml = R"rawliteral(
-      <!DOCTYPE html>
-      <html>
-      <head>
-        <title>Help - Supported Commands</title>
-        <style>
-          body { font-family: Arial, sans-serif; text-align: center; margin-top: 50px; }
-          ul { text-align: left; display: inline-block; }
-          a { text-decoration: none; color: blue; font-weight: bold; }
-        </style>
-      </head>
-      <body>
-        <h1>Supported Commands</h1>
-        <ul>
-          <li><strong>S:</strong> Servo control (e.g., S90 for 90 degrees)</li>
-          <li><strong>D:</strong> Delay in milliseconds (e.g., D500 for 500ms delay)</li>
-          <li><strong>Z:</strong> Z-axis stepper motor control (e.g., Z100 for 100 steps)</li>
-          <li><strong>X:</strong> X-axis stepper motor control (e.g., X100 for 100 steps)</li>
-          <li><strong>F:</strong> Change feedrate (speed) for X-axis (e.g., F1500 for 1500 steps/second)</li>
-          <li><strong>G:</strong> Change feedrate (speed) for Z-axis (e.g., G1200 for 1200 steps/second)</li>
-          <li><strong>H:</strong> Set globalXValue (e.g., H-1300 to set globalXValue to -1300)</li>
-          <li><strong>C:</strong> Set globalDelayMs (e.g., C100 to set delay to 100 ms)</li>
-          <li><strong>LOAD WIRE:</strong> Moves X-axis by the predefined globalXValue.</li>
-        </ul>
-        <a href="/">Back to Home</a>
-      </body>
-      </html>
-    )rawliteral";
-    request->send(200, "text/html", helpHtml);
+  server.on("/version", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", VERSION);
+  });
+
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", metricsReport());
   });
 
   // Handle command buffer input
   server.on("/commandBuffer", HTTP_GET, [](AsyncWebServerRequest *request) {
     if (request->hasParam("buffer")) {
       String buffer = request->getParam("buffer")->value();
-      processBuffer(buffer); // Update the global command buffer and process it
-      request->send(200, "text/plain", "Command buffer received: " + buffer);
+      String error;
+      QueueResult result = processBuffer(buffer, error); // Compile the program, then update the global command buffer
+      if (result == QUEUED) {
+        request->send(200, "text/plain", "Command buffer received: " + buffer);
+      } else {
+        request->send(result == QUEUE_FULL ? 503 : 400, "text/plain", error);
+      }
+    } else {
+      request->send(400, "text/plain", "Missing 'buffer' parameter");
+    }
+  });
+
+  // Program library: list, save, load (source into the command buffer), run and delete
+  server.on("/programs", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", programListing());
+  });
+
+  server.on("/saveProgram", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (!request->hasParam("name") || !request->hasParam("buffer")) {
+      request->send(400, "text/plain", "Missing 'name' or 'buffer' parameter");
+      return;
+    }
+    String name = request->getParam("name")->value();
+    String buffer = request->getParam("buffer")->value();
+    String error;
+    if (saveProgram(name.c_str(), compiledProgram, buffer.c_str(), buffer.length(), error)) {
+      request->send(200, "text/plain", "Program '" + name + "' saved.");
+    } else {
+      request->send(400, "text/plain", error);
+    }
+  });
+
+  server.on("/loadProgram", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (!request->hasParam("name")) {
+      request->send(400, "text/plain", "Missing 'name' parameter");
+      return;
+    }
+    String source, error;
+    if (programLibrary.readSource(request->getParam("name")->value().c_str(), source, error)) {
+      setCommandBuffer(source);
+      request->send(200, "text/plain", source);
+    } else {
+      request->send(404, "text/plain", error);
+    }
+  });
+
+  server.on("/runProgram", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (!request->hasParam("name")) {
+      request->send(400, "text/plain", "Missing 'name' parameter");
+      return;
+    }
+    String name = request->getParam("name")->value();
+    String error;
+    QueueResult result = queueStoredProgram(webCommandQueue, WEB_PROGRAM, compiledProgram, name.c_str(), error);
+    if (result == QUEUED) {
+      request->send(200, "text/plain", "Program '" + name + "' queued.");
+    } else {
+      request->send(result == QUEUE_FULL ? 503 : 404, "text/plain", error);
+    }
+  });
+
+  server.on("/deleteProgram", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (!request->hasParam("name")) {
+      request->send(400, "text/plain", "Missing 'name' parameter");
+      return;
+    }
+    String name = request->getParam("name")->value();
+    String error;
+    if (programLibrary.remove(name.c_str(), error)) {
+      request->send(200, "text/plain", "Program '" + name + "' deleted.");
+    } else {
+      request->send(404, "text/plain", error);
+    }
+  });
+
+  // Predict the cycle time of a command buffer without moving anything
+  server.on("/estimate", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (request->hasParam("buffer")) {
+      String report;
+      if (estimateBuffer(request->getParam("buffer")->value(), report)) {
+        request->send(200, "text/plain", report);
+      } else {
+        request->send(400, "text/plain", report);
+      }
     } else {
       request->send(400, "text/plain", "Missing 'buffer' parameter");
     }
@@ -531,61 +1529,173 @@ void setupWebServer() {
   server.on("/command", HTTP_GET, [](AsyncWebServerRequest *request) {
     if (request->hasParam("cmd")) {
       String command = request->getParam("cmd")->value();
-      commandQueue.push(command); // Add the command to the queue
-      request->send(200, "text/plain", "Command received: " + command);
+      String error;
+      QueueResult result = queueCommand(webCommandQueue, command, &error); // Compile the command and add it to the queue
+      if (result == QUEUED) {
+        request->send(200, "text/plain", "Command received: " + command);
+      } else {
+        request->send(result == QUEUE_FULL ? 503 : 400, "text/plain", error);
+      }
     } else {
       request->send(400, "text/plain", "Missing 'cmd' parameter");
     }
   });
 
   server.on("/saveValues", HTTP_GET, [](AsyncWebServerRequest *request) {
-      saveValues(request);
-    request->send(200, "text/plain", "Values saved successfully.");
+    switch (saveValues()) {
+      case CONFIG_SAVED:
+        request->send(200, "text/plain", "Values saved successfully.");
+        break;
+      case CONFIG_UNCHANGED:
+        request->send(200, "text/plain", "No changes to save.");
+        break;
+      default:
+        request->send(500, "text/plain", "Failed to save values.");
+        break;
+    }
   });
 
   server.on("/loadValues", HTTP_GET, [](AsyncWebServerRequest *request) {
-    loadValues(); // Reload values from the config file
-    String json = "{\"XSpeed\":" + String(X_FEEDRATE) + 
-                  ",\"ZSpeed\":" + String(Z_FEEDRATE) + 
-                  ",\"globalXValue\":" + String(globalXValue) + 
-                  ",\"globalDelayMs\":" + String(globalDelayMs) + 
-                  ",\"Buffer\":\"" + globalCommandBuffer + "\"}";
+    uint8_t state = machineStatus.state;
+    if (state == STATE_RUNNING || state == STATE_PAUSED) {
+      request->send(409, "text/plain", "Machine busy. Load the values once it is idle.");
+      return;
+    }
+    ConfigValues values;
+    String error;
+    if (queueSavedValues(values, error) != QUEUED) {
+      request->send(503, "text/plain", error);
+      return;
+    }
+    String json = "{\"XSpeed\":" + String(values.xFeedrate) + 
+                  ",\"ZSpeed\":" + String(values.zFeedrate) + 
+                  ",\"XAccel\":" + String(values.xAccel) +
+                  ",\"ZAccel\":" + String(values.zAccel) +
+                  ",\"XJerk\":" + String(values.xJerk) +
+                  ",\"ZJerk\":" + String(values.zJerk) +
+                  ",\"globalXValue\":" + String(values.globalXValue) + 
+                  ",\"globalDelayMs\":" + String(values.globalDelayMs) + 
+                  ",\"ServoSpeed\":" + String(values.servoDegPerSecond) +
+                  ",\"Optimize\":" + String(values.optimize ? "true" : "false") +
+                  ",\"Buffer\":\"" + jsonEscape(values.commandBuffer) + "\"}";
     request->send(200, "application/json", json);
   });
 
+  // Out-of-band stop, feed hold and resume, the same as the CTRL+C, '!' and '~' serial bytes
+  server.on("/stop", HTTP_GET, [](AsyncWebServerRequest *request) {
+    requestStop();
+    request->send(200, "text/plain", "Stopping.");
+  });
+
+  server.on("/pause", HTTP_GET, [](AsyncWebServerRequest *request) {
+    requestHold();
+    request->send(200, "text/plain", "Feed hold.");
+  });
+
+  server.on("/resume", HTTP_GET, [](AsyncWebServerRequest *request) {
+    requestResume();
+    request->send(200, "text/plain", "Resumed.");
+  });
+
+  // Tuning mode: /tune?axis=X or Z runs trials of a program (buffer=, default the command buffer)
+  // and saves the fastest safe feedrate and acceleration; /tune alone reports the progress
+  server.on("/tune", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (!request->hasParam("axis")) {
+      request->send(200, "text/plain", tuneStatus());
+      return;
+    }
+    String axis = request->getParam("axis")->value();
+    axis.toUpperCase();
+    if (axis != "X" && axis != "Z") {
+      request->send(400, "text/plain", "Axis must be X or Z");
+      return;
+    }
+    requestTune(axis[0], request->hasParam("buffer") ? request->getParam("buffer")->value() : commandBuffer());
+    request->send(200, "text/plain", "Tuning " + axis + " requested.");
+  });
+
+  // Fleet mode settings: /fleet reports them, /setFleet?ssid=&password=&broker=&port=&name=
+  // stores them for the next boot (an empty ssid or broker turns fleet mode off)
+  server.on("/fleet", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", fleetLink.describe());
+  });
+
+  server.on("/setFleet", HTTP_GET, [](AsyncWebServerRequest *request) {
+    FleetSettings settings = fleetLink.settings();
+    if (request->hasParam("ssid")) {
+      settings.ssid = request->getParam("ssid")->value();
+    }
+    if (request->hasParam("password")) {
+      settings.password = request->getParam("password")->value();
+    }
+    if (request->hasParam("broker")) {
+      settings.broker = request->getParam("broker")->value();
+    }
+    if (request->hasParam("port")) {
+      settings.port = request->getParam("port")->value().toInt() > 0 ? request->getParam("port")->value().toInt() : FLEET_DEFAULT_PORT;
+    }
+    if (request->hasParam("name")) {
+      settings.name = request->getParam("name")->value();
+    }
+    String error;
+    if (fleetLink.save(settings, error)) {
+      request->send(200, "text/plain", "Fleet settings saved, they take effect after a restart.");
+    } else {
+      request->send(400, "text/plain", error);
+    }
+  });
+
+  // Feed override in percent of the programmed feedrates; takes effect within the running move
+  server.on("/feedOverride", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (request->hasParam("value")) {
+      uint32_t percent = setFeedOverride(request->getParam("value")->value().toInt());
+      request->send(200, "text/plain", "Feed override " + String(percent) + "%.");
+    } else {
+      request->send(400, "text/plain", "Missing 'value' parameter");
+    }
+  });
+
+  // Turn the peephole optimizer on or off (off replays programs exactly as written)
+  server.on("/setOptimize", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (request->hasParam("value")) {
+      optimizePrograms = request->getParam("value")->value().toInt() != 0;
+      request->send(200, "text/plain", optimizePrograms ? "Program optimizer on." : "Program optimizer off, programs run exactly as written.");
+    } else {
+      request->send(400, "text/plain", "Missing 'value' parameter");
+    }
+  });
+
   server.on("/deleteConfig", HTTP_GET, [](AsyncWebServerRequest *request) {
-    deleteConfigFile();
-    request->send(200, "text/plain", "Config file deleted.");
+    if (configStore.erase()) {
+      request->send(200, "text/plain", "Config file deleted.");
+    } else {
+      request->send(500, "text/plain", "Failed to delete config file.");
+    }
   });
 
-  // Serve the config file contents
+  // Show the saved values
   server.on("/viewConfig", HTTP_GET, [](AsyncWebServerRequest *request) {
-    if (SPIFFS.exists("/config.txt")) {
-      File file = SPIFFS.open("/config.txt", FILE_READ);
-      if (file) {
-        String content = "";
-        while (file.available()) {
-          content += char(file.read()); // Read the entire file content
-        }
-        file.close();
-        String html = "<!DOCTYPE html><html><head><title>Config File</title></head><body>";
-        html += "<h1>Config File Contents</h1><pre>" + content + "</pre>";
-        html += "<a href='/'>Back to Home</a></body></html>";
-        request->send(200, "text/html", html);
-      } else {
-        request->send(500, "text/plain", "Failed to open config file.");
-      }
-    } else {
+    if (!configStore.hasValues()) {
       request->send(404, "text/plain", "Config file not found.");
+      return;
     }
+    String html = "<!DOCTYPE html><html><head><title>Config File</title></head><body>";
+    html += "<h1>Config File Contents</h1><pre>" + configStore.describe() + "</pre>";
+    html += "<a href='/'>Back to Home</a></body></html>";
+    request->send(200, "text/html", html);
   });
 
   // Add a new endpoint to handle the LOAD WIRE command
   server.on("/loadWire", HTTP_GET, [](AsyncWebServerRequest *request) {
-    if (globalXValue != 0) {
-      String command = "X" + String(globalXValue);
-      commandQueue.push(command); // Add the command to the queue
-      request->send(200, "text/plain", "LOAD WIRE command executed: " + command);
+    if (machineSettings.globalXValue != 0) {
+      String command = "X" + String(machineSettings.globalXValue);
+      Instruction instruction = { OP_MOVE, machineSettings.globalXValue, 0 };
+      if (webCommandQueue.push(instruction)) { // Add the command to the queue
+        wakeMotionTask();
+        request->send(200, "text/plain", "LOAD WIRE command executed: " + command);
+      } else {
+        request->send(503, "text/plain", "Command queue full. LOAD WIRE rejected, retry later.");
+      }
     } else {
       request->send(400, "text/plain", "Error: globalXValue is not set.");
     }
@@ -602,6 +1712,7 @@ void setup() {
     // Wait for the serial connection to be established for up to 5 seconds
     delay(100);
   }
+  startLogTask(); // Boot messages below are written directly, everything later through the log ring
 
   Serial.println("Initializing...");
   Serial.print("Servo attached to pin: ");
@@ -610,14 +1721,13 @@ void setup() {
   strip.begin();  // Initialize the NeoPixel library
   strip.show();   // Turn off all pixels initially
 
-  pinMode(CPX, OUTPUT); // Set CPX as output
-  pinMode(CWX, OUTPUT); // Set CWX as output
-  pinMode(CPY, OUTPUT); // Set CPY as output
-  pinMode(CWY, OUTPUT); // Set CWY as output
+  stepperEngine.begin(); // Configure the stepper pins (XAxis, ZAxis) and the step timer
+  stepperEngine.onComplete(wakeMotionTaskFromISR); // Plan the next move as soon as one ends
 
   servo.setPeriodHertz(50); // Set the PWM frequency to 50Hz
   servo.attach(SERVO_PIN, 500, 2500); // Attach the servo with min/max pulse widths
   servo.write(map(LowAngle, 0, 360, 0, 180)); // Set the servo to the minimum allowed angle (LowAngle)
+  executor.setServoAngle(LowAngle);
 
   led_on(GREEN); // Turn LED to GREEN to indicate ready state
   Serial.print("READY "); // Output READY message to serial
@@ -627,9 +1737,18 @@ void setup() {
   if (!SPIFFS.begin(true)) {
     Serial.println("An error occurred while mounting SPIFFS. Continuing without file system.");
   } else {
-    loadValues(); // Attempt to load values from the config file
+    configStore.begin(currentValues()); // Read the config journal into RAM
+    loadValues();
+    programLibrary.begin();
+  }
+
+  currentSensing = startCurrentSensor(onCurrentSample);
+  if (!currentSensing) {
+    Serial.println("No INA260 found: stall detection and tuning are off.");
   }
 
+  startPowerSave(); // Clock scaling between jobs, and loop() wake-ups on serial input
   setupWiFi(); // Set up the WiFi access point
   setupWebServer(); // Set up the web server
+  startMotionTask(runExecutor); // Start executing queued commands
 }
\ No newline at end of file
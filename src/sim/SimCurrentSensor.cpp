@@ -0,0 +1,111 @@
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include "CurrentSensor.h"
+#include "SimHardware.h"
+#include "Simulator.h"
+#include "StepperEngine.h"
+
+// Stand-in for the INA260 task. Like a machine without the sensor it is missing unless
+// simAttachCurrentSensor() was called, so plain runs are never stopped by the model. Samples are delivered by simCurrentPoll() every
+// CURRENT_SAMPLE_MS of machine time, either replayed from a recorded trace or from a simple
+// model of the drivers: a standstill current, a share per step/s of the lead axis rate, a share
+// per step/s^2 of acceleration, and a stall jump above a set rate.
+
+#define SIM_CURRENT_IDLE_MA 300      // Drivers holding the motors
+#define SIM_CURRENT_PER_RATE 0.3     // mA per step/s of the lead axis
+#define SIM_CURRENT_PER_ACCEL 0.01   // mA per step/s^2 of the lead axis
+#define SIM_CURRENT_STALL_MA 900     // Added while the lead axis runs above the stall rate
+#define SIM_CURRENT_BACKLOG_MS 100   // Samples delivered at most for a gap between polls
+
+struct TracePoint {
+  uint32_t timeMs;
+  uint32_t currentMa;
+};
+
+static bool attached = false;
+static CurrentHandler currentHandler = nullptr;
+static std::vector<TracePoint> trace;
+static uint32_t stallRate = 0;
+static uint64_t startUs = 0;
+static uint64_t nextSampleUs = 0;
+static uint32_t lastRate = 0;
+
+void simAttachCurrentSensor() {
+  attached = true;
+}
+
+bool startCurrentSensor(CurrentHandler handler) {
+  if (!attached) {
+    return false;
+  }
+  currentHandler = handler;
+  return true;
+}
+
+// Samples are delivered by simCurrentPoll() while a program runs, always at CURRENT_SAMPLE_MS
+void setCurrentSampling(bool) {}
+
+bool simLoadCurrentTrace(const char *path) {
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    unsigned timeMs, currentMa;
+    if (sscanf(line.c_str(), "%u,%u", &timeMs, &currentMa) == 2) { // A header line does not parse
+      trace.push_back({ timeMs, currentMa });
+    }
+  }
+  return !trace.empty();
+}
+
+void simSetStallRate(uint32_t rate) {
+  stallRate = rate;
+}
+
+// A trace starts at its own standstill current: the filters get that long enough to settle
+void simCurrentStart() {
+  startUs = simNowUs();
+  for (uint32_t ms = 0; currentHandler && !trace.empty() && ms < SIM_CURRENT_BACKLOG_MS; ms += CURRENT_SAMPLE_MS) {
+    currentHandler(startUs / 1000, trace.front().currentMa);
+  }
+}
+
+static uint32_t modelCurrentMa() {
+  uint32_t rate = stepperEngine.rate();
+  double accel = ((double)rate - lastRate) * 1000.0 / CURRENT_SAMPLE_MS;
+  lastRate = rate;
+  double currentMa = SIM_CURRENT_IDLE_MA + SIM_CURRENT_PER_RATE * rate + SIM_CURRENT_PER_ACCEL * (accel > 0 ? accel : -accel);
+  if (stallRate > 0 && rate > stallRate) {
+    currentMa += SIM_CURRENT_STALL_MA;
+  }
+  return (uint32_t)currentMa;
+}
+
+// The last trace point at or before the time into the program; the trace repeats its end
+static uint32_t traceCurrentMa(uint32_t timeMs) {
+  uint32_t currentMa = trace.front().currentMa;
+  for (const TracePoint &point : trace) {
+    if (point.timeMs > timeMs) {
+      break;
+    }
+    currentMa = point.currentMa;
+  }
+  return currentMa;
+}
+
+void simCurrentPoll() {
+  if (!currentHandler) {
+    return;
+  }
+  uint64_t now = simNowUs();
+  if (nextSampleUs + SIM_CURRENT_BACKLOG_MS * 1000ULL < now) {
+    nextSampleUs = now - SIM_CURRENT_BACKLOG_MS * 1000ULL; // Nothing was polled between programs: settle at their start
+  }
+  while (nextSampleUs <= now) {
+    uint32_t timeMs = nextSampleUs / 1000;
+    uint32_t intoMs = nextSampleUs > startUs ? (nextSampleUs - startUs) / 1000 : 0;
+    uint32_t currentMa = trace.empty() ? modelCurrentMa() : traceCurrentMa(intoMs);
+    currentHandler(timeMs, currentMa);
+    nextSampleUs += CURRENT_SAMPLE_MS * 1000ULL;
+  }
+}
@@ -0,0 +1,27 @@
+#include "Logger.h"
+
+// The simulator is single threaded and its serial port never stalls, so messages are written
+// at once instead of going through the ring and a drain task. Levels work as on the machine.
+
+std::atomic<uint8_t> logLevel(LEVEL_INFO);
+
+void startLogTask() {}
+
+void vlogMessage(LogLevel level, const char *format, va_list args) {
+  if (level <= logLevel.load(std::memory_order_relaxed)) {
+    char line[LOG_LINE_SIZE];
+    vsnprintf(line, sizeof(line), format, args);
+    Serial.print(line);
+  }
+}
+
+void logMessage(LogLevel level, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  vlogMessage(level, format, args);
+  va_end(args);
+}
+
+uint32_t logDropped() {
+  return 0;
+}
@@ -0,0 +1,51 @@
+#include "Simulator.h"
+#include "SimHardware.h"
+#include "StepperEngine.h"
+
+SimMachine simMachine;
+
+void SimMachine::begin() {
+  simOnPinWrite(onPinWrite);
+  simOnServoWrite(onServoWrite);
+}
+
+void SimMachine::resetCounters() {
+  for (AxisTrace &axis : axes) {
+    axis.steps = 0;
+    axis.shortestPeriodUs = 0;
+  }
+  moves = 0;
+}
+
+void SimMachine::onPinWrite(uint8_t pin, uint8_t level, uint64_t timeUs) {
+  SimMachine &machine = simMachine;
+  for (int axis = 0; axis < AxisCount; axis++) {
+    AxisTrace &trace = machine.axes[axis];
+    if (pin == stepperEngine.pulsePin(axis) && level == HIGH) { // The driver steps on the rising edge
+      if (trace.steps > 0) {
+        uint32_t period = timeUs - trace.lastStepUs;
+        if (trace.shortestPeriodUs == 0 || period < trace.shortestPeriodUs) {
+          trace.shortestPeriodUs = period;
+        }
+      }
+      trace.lastStepUs = timeUs;
+      trace.position += digitalRead(stepperEngine.directionPin(axis)) == stepperEngine.forwardLevel(axis) ? 1 : -1;
+      trace.steps++;
+      if (machine.timeline) {
+        fprintf(machine.timeline, "%llu,%c,%lld\n", (unsigned long long)timeUs, axis == AxisX ? 'X' : 'Z', (long long)trace.position);
+      }
+    }
+  }
+}
+
+void SimMachine::onServoWrite(int servoDegrees, uint64_t timeUs) {
+  SimMachine &machine = simMachine;
+  int angle = map(servoDegrees, 0, 180, 0, 360); // Back to the 0-360 scale of the S command
+  if (angle != machine.angle) {
+    machine.moves++;
+  }
+  machine.angle = angle;
+  if (machine.timeline) {
+    fprintf(machine.timeline, "%llu,S,%d\n", (unsigned long long)timeUs, angle);
+  }
+}
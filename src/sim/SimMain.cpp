@@ -0,0 +1,309 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <SPIFFS.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "MotionProfile.h"
+#include "MotionTask.h"
+#include "SimHardware.h"
+#include "Simulator.h"
+
+// Native simulator: runs the real firmware (main.cpp, the step engine interrupt, planner and
+// profiles) against the mocked hardware in virtual time and reports what the machine did.
+//
+//   .pio/build/native/program [options] [program ...]
+//
+// Programs are comma-separated command buffers as sent to /commandBuffer; without arguments
+// they are read from stdin, one per line. --serial replays a recorded host session on the
+// serial port instead and prints the firmware's replies.
+
+#define SIM_TIMEOUT_US (3600ULL * 1000000ULL) // Give up on a program after an hour of machine time
+
+static void usage() {
+  fprintf(stderr,
+          "usage: program [-v] [--config FILE] [--timeline FILE] [--serial FILE] [PROGRAM ...]\n"
+          "  -v               print the firmware's serial log\n"
+          "  --config FILE    load FILE as /config.txt before setup() (feedrates, delays, ...)\n"
+          "  --timeline FILE  write every step and servo move as CSV: time_us,channel,value\n"
+          "  --serial FILE    send FILE to the serial port as one burst and run until idle\n"
+          "  --feed P@MS      set the feed override to P percent MS milliseconds into each program\n"
+          "  --pause MS:FOR   pause each program MS milliseconds in and resume it FOR milliseconds later\n"
+          "  --stop MS        stop each program MS milliseconds in\n"
+          "  --current FILE   replay FILE (time_ms,current_ma lines) as the motor supply current of each program\n"
+          "  --stall-rate R   without --current, model a motor that stalls above R steps/s\n"
+          "  --tune AXIS      tune the X or Z feedrate and acceleration on each program instead of running it\n"
+          "  --fleet NAME@HOST[:PORT]  join the MQTT broker at HOST as fleet machine NAME and run its jobs until killed\n");
+}
+
+static std::string readFile(const char *path, bool &ok) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  ok = file.good() || file.eof();
+  return contents.str();
+}
+
+// Feed override change requested with --feed, made through /feedOverride like the web UI does
+static String feedPercent;
+static uint64_t feedAtUs = 0;
+static bool feedPending = false;
+
+// Pause, resume and stop requested with --pause and --stop, made through the web endpoints
+struct SimControl {
+  const char *path;
+  uint64_t atUs;
+  bool enabled;
+  bool pending;
+};
+static SimControl controls[] = { { "/pause", 0, false, false }, { "/resume", 0, false, false }, { "/stop", 0, false, false } };
+
+// Run executor passes the way the motion task does: every poll period, and straight after a
+// wake-up from the step engine. Between passes the clock jumps to the next timer interrupt.
+static bool runUntilIdle(uint64_t startUs) {
+  for (;;) {
+    if (feedPending && simNowUs() - startUs >= feedAtUs) {
+      feedPending = false;
+      simHttpGet("/feedOverride", { { "value", feedPercent } });
+    }
+    for (SimControl &control : controls) {
+      if (control.pending && simNowUs() - startUs >= control.atUs) {
+        control.pending = false;
+        simHttpGet(control.path, {});
+      }
+    }
+    simCurrentPoll();
+    if (!simRunExecutor()) {
+      return true;
+    }
+    if (simNowUs() - startUs > SIM_TIMEOUT_US) {
+      return false;
+    }
+    uint64_t pollAt = (simNowUs() / 1000 + MOTION_TASK_POLL_MS) * 1000;
+    uint64_t alarmAt;
+    bool woken = false;
+    while (!woken && simTimerNextAlarm(alarmAt) && alarmAt <= pollAt) {
+      simTimerFire();
+      woken = simTakeWake();
+    }
+    if (!woken) {
+      simAdvanceTo(pollAt);
+    }
+  }
+}
+
+static bool runProgram(int number, const String &program) {
+  SimHttpResponse estimate = simHttpGet("/estimate", { { "buffer", program } });
+  simMachine.resetCounters();
+  if (feedPercent.length() > 0) {
+    simHttpGet("/feedOverride", { { "value", "100" } }); // Every program starts at the programmed rates
+    feedPending = true;
+  }
+  for (SimControl &control : controls) {
+    control.pending = control.enabled;
+  }
+  uint64_t startUs = simNowUs();
+  simCurrentStart();
+  SimHttpResponse response = simHttpGet("/commandBuffer", { { "buffer", program } });
+  if (response.code != 200) {
+    printf("Program %d rejected (%d): %s\n", number, response.code, response.body.c_str());
+    return false;
+  }
+  if (!runUntilIdle(startUs)) {
+    printf("Program %d did not finish within %llu s of machine time\n", number, SIM_TIMEOUT_US / 1000000ULL);
+    return false;
+  }
+
+  double seconds = (simNowUs() - startUs) / 1e6;
+  printf("Program %d: %s\n", number, program.c_str());
+  printf("  cycle time  %.3f s (%.1f parts/hour)\n", seconds, seconds > 0 ? 3600.0 / seconds : 0.0);
+  int total = estimate.body.indexOf("Total ");
+  printf("  estimate    %s", total >= 0 ? estimate.body.substring(total + 6).c_str() : "unavailable\n");
+  const char *names[AxisCount] = { "X", "Z" };
+  for (int axis = 0; axis < AxisCount; axis++) {
+    printf("  %s axis      %u steps, position %lld, peak %u steps/s\n", names[axis], (unsigned)simMachine.steps(axis),
+           (long long)simMachine.position(axis), (unsigned)simMachine.peakRate(axis));
+  }
+  printf("  servo       %u moves, angle %d\n", (unsigned)simMachine.servoMoves(), simMachine.servoAngle());
+  return true;
+}
+
+// Tuning mode on one program: loop() runs the tuner, which queues a trial whenever the
+// previous one has ended, so the two take turns until it is done.
+static bool tuneProgram(int number, char axis, const String &program) {
+  uint64_t startUs = simNowUs();
+  simHttpGet("/tune", { { "axis", String(axis) }, { "buffer", program } });
+  for (;;) {
+    loop();
+    if (!tuningActive()) {
+      break;
+    }
+    if (!executorIdle()) {
+      simCurrentStart(); // A trial or the final settings were queued
+    }
+    if (!runUntilIdle(simNowUs())) {
+      printf("Tuning of program %d did not finish within %llu s of machine time\n", number, SIM_TIMEOUT_US / 1000000ULL);
+      return false;
+    }
+  }
+  printf("Program %d: %s\n", number, program.c_str());
+  printf("  tuning      %.3f s: %s\n", (simNowUs() - startUs) / 1e6, simHttpGet("/tune").body.c_str());
+  return true;
+}
+
+// Fleet machine: loop() keeps the broker connection and queues the parts of a job, which then
+// run off in virtual time. While idle the clock follows the host's, so the broker sees a
+// machine that answers in real time; parts take no longer than their simulation.
+static void serveFleet() {
+  for (;;) {
+    loop();
+    if (!executorIdle()) {
+      simCurrentStart();
+      if (!runUntilIdle(simNowUs())) {
+        printf("Fleet part did not finish within %llu s of machine time\n", SIM_TIMEOUT_US / 1000000ULL);
+      }
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1)); // loop() already moved the clock on by its delay(1)
+    }
+  }
+}
+
+// Hand a host session to the serial port in one burst, the way a host streams at full USB
+// speed: loop() frames and queues all of it, then the machine runs it off.
+static bool runSerial(const std::string &input) {
+  Serial.echo = true; // The replies are the point here
+  Serial.inject(input.c_str());
+  uint64_t startUs = simNowUs();
+  loop();
+  if (!runUntilIdle(startUs)) {
+    printf("Serial session did not finish within %llu s of machine time\n", SIM_TIMEOUT_US / 1000000ULL);
+    return false;
+  }
+  printf("Serial session ran for %.3f s\n", (simNowUs() - startUs) / 1e6);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  std::vector<String> programs;
+  std::string serialInput;
+  bool serialSession = false;
+  char tuneAxis = 0;
+  bool fleetMode = false;
+  FILE *timeline = nullptr;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-v") {
+      Serial.echo = true;
+    } else if (arg == "--config" && i + 1 < argc) {
+      bool ok;
+      std::string config = readFile(argv[++i], ok);
+      if (!ok) {
+        fprintf(stderr, "cannot read %s\n", argv[i]);
+        return 2;
+      }
+      SPIFFS.preload("/config.txt", config);
+    } else if (arg == "--timeline" && i + 1 < argc) {
+      timeline = fopen(argv[++i], "w");
+      if (!timeline) {
+        fprintf(stderr, "cannot write %s\n", argv[i]);
+        return 2;
+      }
+      fprintf(timeline, "time_us,channel,value\n");
+    } else if (arg == "--serial" && i + 1 < argc) {
+      bool ok;
+      serialInput = readFile(argv[++i], ok);
+      if (!ok) {
+        fprintf(stderr, "cannot read %s\n", argv[i]);
+        return 2;
+      }
+      serialSession = true;
+    } else if (arg == "--feed" && i + 1 < argc) {
+      String feed(argv[++i]);
+      int at = feed.indexOf('@');
+      if (at <= 0) {
+        usage();
+        return 2;
+      }
+      feedPercent = feed.substring(0, at);
+      feedAtUs = (uint64_t)feed.substring(at + 1).toInt() * 1000;
+    } else if (arg == "--pause" && i + 1 < argc) {
+      String pause(argv[++i]);
+      int colon = pause.indexOf(':');
+      if (colon <= 0) {
+        usage();
+        return 2;
+      }
+      controls[0] = { "/pause", (uint64_t)pause.substring(0, colon).toInt() * 1000, true, false };
+      controls[1] = { "/resume", controls[0].atUs + (uint64_t)pause.substring(colon + 1).toInt() * 1000, true, false };
+    } else if (arg == "--current" && i + 1 < argc) {
+      if (!simLoadCurrentTrace(argv[++i])) {
+        fprintf(stderr, "cannot read a current trace from %s\n", argv[i]);
+        return 2;
+      }
+      simAttachCurrentSensor();
+    } else if (arg == "--stall-rate" && i + 1 < argc) {
+      simSetStallRate(atoi(argv[++i]));
+      simAttachCurrentSensor();
+    } else if (arg == "--tune" && i + 1 < argc) {
+      tuneAxis = toupper(argv[++i][0]);
+      if (tuneAxis != 'X' && tuneAxis != 'Z') {
+        usage();
+        return 2;
+      }
+      simAttachCurrentSensor();
+    } else if (arg == "--fleet" && i + 1 < argc) {
+      String fleet(argv[++i]);
+      int at = fleet.indexOf('@');
+      int colon = fleet.indexOf(':', at);
+      if (at <= 0) {
+        usage();
+        return 2;
+      }
+      String host = colon > at ? fleet.substring(at + 1, colon) : fleet.substring(at + 1);
+      String port = colon > at ? fleet.substring(colon + 1) : String("1883");
+      SPIFFS.preload("/fleet.txt", std::string("ssid:sim\nbroker:") + host.c_str() + "\nport:" + port.c_str() + "\nname:" +
+                                       fleet.substring(0, at).c_str() + "\n");
+      fleetMode = true;
+      setvbuf(stdout, nullptr, _IOLBF, 0); // It runs until killed: the log is read while it runs
+    } else if (arg == "--stop" && i + 1 < argc) {
+      controls[2] = { "/stop", (uint64_t)atoll(argv[++i]) * 1000, true, false };
+    } else if (arg[0] == '-') {
+      usage();
+      return 2;
+    } else {
+      programs.push_back(String(arg));
+    }
+  }
+  if (programs.empty() && !serialSession && !fleetMode) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      String program(line);
+      program.trim();
+      if (!program.isEmpty()) {
+        programs.push_back(program);
+      }
+    }
+  }
+
+  simMachine.begin();
+  simMachine.setTimeline(timeline);
+  setup();
+  if (!runUntilIdle(simNowUs())) {
+    return 1;
+  }
+
+  if (fleetMode) {
+    serveFleet();
+  }
+  bool ok = !serialSession || runSerial(serialInput);
+  for (size_t i = 0; i < programs.size(); i++) {
+    ok = (tuneAxis ? tuneProgram(i + 1, tuneAxis, programs[i]) : runProgram(i + 1, programs[i])) && ok;
+  }
+  if (timeline) {
+    fclose(timeline);
+  }
+  return ok ? 0 : 1;
+}
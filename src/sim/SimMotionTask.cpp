@@ -0,0 +1,30 @@
+#include "MotionTask.h"
+#include "Simulator.h"
+
+// The simulator is single threaded: instead of a FreeRTOS task it calls the executor itself,
+// once per poll period and right after every wake-up, until the executor has nothing left to do.
+
+static bool (*motionExecutor)() = nullptr;
+static bool wakePending = false;
+
+void startMotionTask(bool (*executor)()) {
+  motionExecutor = executor;
+}
+
+void wakeMotionTask() {
+  wakePending = true;
+}
+
+void wakeMotionTaskFromISR() {
+  wakePending = true;
+}
+
+bool simRunExecutor() {
+  return motionExecutor && motionExecutor();
+}
+
+bool simTakeWake() {
+  bool woken = wakePending;
+  wakePending = false;
+  return woken;
+}
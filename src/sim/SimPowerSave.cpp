@@ -0,0 +1,15 @@
+#include "PowerSave.h"
+
+// The simulator calls loop() itself whenever there is something to do, so there is nothing to
+// wait for and no clock to scale. A wait moves the virtual clock on by one millisecond, so
+// loop() passes stay apart the way they do on the machine.
+
+void startPowerSave() {}
+
+void waitForLoopEvent(uint32_t) {
+  delay(1);
+}
+
+void wakeLoop() {}
+
+void holdFullSpeed(bool) {}
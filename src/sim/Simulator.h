@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Firmware entry points the simulator drives (main.cpp)
+void setup();
+void loop();
+bool executorIdle();
+bool tuningActive();
+
+// INA260 stand-in (SimCurrentSensor.cpp), only present once attached before setup(): motor
+// supply current from a recorded trace of "time_ms,current_ma" lines (times from the start of
+// each program), or else from a model of the drivers that stalls above 'rate' steps/s (0: never).
+void simAttachCurrentSensor();
+bool simLoadCurrentTrace(const char *path);
+void simSetStallRate(uint32_t rate);
+void simCurrentStart(); // Time 0 of the trace
+void simCurrentPoll();  // Deliver the samples due up to now
+
+// Motion task stand-in (SimMotionTask.cpp): the simulator runs executor passes itself
+bool simRunExecutor(); // False once the motion task would sleep until woken
+bool simTakeWake(); // True once after wakeMotionTask() was called
+
+// Records what the machine does from the pin and servo writes of the real firmware code.
+class SimMachine {
+public:
+  void begin();              // Start recording; call before setup() to see the initial servo angle
+  void resetCounters();      // Start counting steps and servo moves for a new program
+  void setTimeline(FILE *file) { timeline = file; }
+
+  int64_t position(int axis) const { return axes[axis].position; }
+  uint32_t steps(int axis) const { return axes[axis].steps; }
+  uint32_t peakRate(int axis) const { return axes[axis].shortestPeriodUs ? 1000000UL / axes[axis].shortestPeriodUs : 0; }
+  int servoAngle() const { return angle; }
+  uint32_t servoMoves() const { return moves; }
+
+private:
+  static void onPinWrite(uint8_t pin, uint8_t level, uint64_t timeUs);
+  static void onServoWrite(int servoDegrees, uint64_t timeUs);
+
+  struct AxisTrace {
+    int64_t position = 0;
+    uint32_t steps = 0;
+    uint64_t lastStepUs = 0;
+    uint32_t shortestPeriodUs = 0;
+  };
+
+  AxisTrace axes[2];
+  int angle = -1;
+  uint32_t moves = 0;
+  FILE *timeline = nullptr;
+};
+
+extern SimMachine simMachine;
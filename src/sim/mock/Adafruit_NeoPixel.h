@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel {
+public:
+  Adafruit_NeoPixel(uint16_t, int16_t, uint16_t) {}
+  void begin() {}
+  void show() {}
+  void fill(uint32_t c) { color = c; }
+  uint32_t getPixelColor(uint16_t) const { return color; }
+
+private:
+  uint32_t color = 0;
+};
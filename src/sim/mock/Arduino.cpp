@@ -0,0 +1,142 @@
+#include <Arduino.h>
+#include "SimHardware.h"
+
+SimSerial Serial;
+EspClass ESP;
+
+static uint64_t nowUs = 0;
+static uint8_t pinLevels[64];
+static SimPinListener pinListener = nullptr;
+static SimServoListener servoListener = nullptr;
+
+struct hw_timer_s {
+  uint64_t alarm = 0;      // Alarm value in ticks
+  uint64_t zeroAtUs = 0;   // Clock time the counter was last zero
+  bool enabled = false;
+  bool autoreload = false;
+  void (*handler)() = nullptr;
+};
+
+static hw_timer_t stepTimer;
+
+uint64_t simNowUs() {
+  return nowUs;
+}
+
+void simAdvanceTo(uint64_t timeUs) {
+  if (timeUs > nowUs) {
+    nowUs = timeUs;
+  }
+}
+
+bool simTimerNextAlarm(uint64_t &timeUs) {
+  if (!stepTimer.enabled) {
+    return false;
+  }
+  timeUs = stepTimer.zeroAtUs + stepTimer.alarm;
+  return true;
+}
+
+void simTimerFire() {
+  uint64_t at;
+  if (!simTimerNextAlarm(at)) {
+    return;
+  }
+  simAdvanceTo(at);
+  stepTimer.zeroAtUs = at; // Autoreload restarts the counter; a new alarm value applies from here
+  if (!stepTimer.autoreload) {
+    stepTimer.enabled = false;
+  }
+  if (stepTimer.handler) {
+    stepTimer.handler();
+  }
+}
+
+void simOnPinWrite(SimPinListener listener) {
+  pinListener = listener;
+}
+
+void simOnServoWrite(SimServoListener listener) {
+  servoListener = listener;
+}
+
+void simServoWrite(int angle) {
+  if (servoListener) {
+    servoListener(angle, nowUs);
+  }
+}
+
+unsigned long millis() {
+  return nowUs / 1000;
+}
+
+unsigned long micros() {
+  return nowUs;
+}
+
+void delay(unsigned long ms) {
+  nowUs += ms * 1000ULL;
+}
+
+void delayMicroseconds(unsigned int us) {
+  nowUs += us;
+}
+
+void yield() {
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= sizeof(pinLevels)) {
+    return;
+  }
+  level = level ? HIGH : LOW;
+  if (pinLevels[pin] != level) {
+    pinLevels[pin] = level;
+    if (pinListener) {
+      pinListener(pin, level, nowUs);
+    }
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+hw_timer_t *timerBegin(uint8_t, uint16_t divider, bool) {
+  if (divider != 80) {
+    fprintf(stderr, "sim: only a 1 MHz step timer (divider 80) is modelled\n");
+  }
+  return &stepTimer;
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*handler)(), bool) {
+  timer->handler = handler;
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarmValue, bool autoreload) {
+  timer->alarm = alarmValue;
+  timer->autoreload = autoreload;
+}
+
+void timerAlarmEnable(hw_timer_t *timer) {
+  timer->enabled = true;
+}
+
+void timerAlarmDisable(hw_timer_t *timer) {
+  timer->enabled = false;
+}
+
+void timerWrite(hw_timer_t *timer, uint64_t value) {
+  timer->zeroAtUs = nowUs - value;
+}
+
+uint64_t timerRead(hw_timer_t *timer) {
+  return nowUs - timer->zeroAtUs;
+}
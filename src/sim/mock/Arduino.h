@@ -0,0 +1,228 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino-ESP32 core the firmware uses. Time is virtual:
+// millis()/micros() return the simulated clock, which only moves when the simulator advances it
+// (see SimHardware.h), so programs run as fast as the host allows.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define PROGMEM
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define IRAM_ATTR
+
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+class String {
+public:
+  String() {}
+  String(const char *text) : text(text ? text : "") {}
+  String(const std::string &text) : text(text) {}
+  explicit String(char c) : text(1, c) {}
+  String(int value) : text(std::to_string(value)) {}
+  String(unsigned int value) : text(std::to_string(value)) {}
+  String(long value) : text(std::to_string(value)) {}
+  String(unsigned long value) : text(std::to_string(value)) {}
+  String(long long value) : text(std::to_string(value)) {}
+  String(unsigned long long value) : text(std::to_string(value)) {}
+  String(float value, unsigned int decimals = 2) : String((double)value, decimals) {}
+  String(double value, unsigned int decimals = 2) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+    text = buffer;
+  }
+
+  unsigned int length() const { return text.size(); }
+  bool isEmpty() const { return text.empty(); }
+  const char *c_str() const { return text.c_str(); }
+  char charAt(unsigned int i) const { return i < text.size() ? text[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  void reserve(unsigned int size) { text.reserve(size); }
+
+  String substring(unsigned int from) const { return from < text.size() ? String(text.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (to > text.size()) {
+      to = text.size();
+    }
+    return from < to ? String(text.substr(from, to - from)) : String();
+  }
+  int indexOf(char c, unsigned int from = 0) const { return position(text.find(c, from)); }
+  int indexOf(const String &s, unsigned int from = 0) const { return position(text.find(s.text, from)); }
+  int lastIndexOf(char c) const { return position(text.rfind(c)); }
+  bool startsWith(const String &s) const { return text.compare(0, s.text.size(), s.text) == 0; }
+  bool endsWith(const String &s) const {
+    return text.size() >= s.text.size() && text.compare(text.size() - s.text.size(), s.text.size(), s.text) == 0;
+  }
+  bool equals(const String &s) const { return text == s.text; }
+  long toInt() const { return atol(text.c_str()); }
+  float toFloat() const { return atof(text.c_str()); }
+
+  void trim() {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+      text.clear();
+      return;
+    }
+    text = text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+  }
+  void toUpperCase() {
+    for (char &c : text) {
+      c = toupper(c);
+    }
+  }
+  void replace(const String &from, const String &to) {
+    if (from.text.empty()) {
+      return;
+    }
+    for (size_t at = text.find(from.text); at != std::string::npos; at = text.find(from.text, at + to.text.size())) {
+      text.replace(at, from.text.size(), to.text);
+    }
+  }
+
+  String &operator+=(const String &s) { text += s.text; return *this; }
+  String &operator+=(const char *s) { text += s; return *this; }
+  String &operator+=(char c) { text += c; return *this; }
+  bool operator==(const String &s) const { return text == s.text; }
+  bool operator!=(const String &s) const { return text != s.text; }
+  bool operator<(const String &s) const { return text < s.text; }
+
+  friend String operator+(const String &a, const String &b) { return String(a.text + b.text); }
+  friend String operator+(const String &a, const char *b) { return String(a.text + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b.text); }
+  friend String operator+(const String &a, char b) { return String(a.text + b); }
+
+private:
+  static int position(size_t at) { return at == std::string::npos ? -1 : (int)at; }
+  std::string text;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      write(buffer[i]);
+    }
+    return size;
+  }
+  size_t print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t print(const String &text) { return print(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value) { return print(String(value)); }
+  size_t print(unsigned int value) { return print(String(value)); }
+  size_t print(long value) { return print(String(value)); }
+  size_t print(unsigned long value) { return print(String(value)); }
+  template <typename T>
+  size_t println(const T &value) { return print(value) + print("\n"); }
+  size_t println() { return print("\n"); }
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    print(buffer);
+    return length;
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  size_t readBytes(uint8_t *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && available() > 0) {
+      buffer[count++] = (uint8_t)read();
+    }
+    return count;
+  }
+  String readStringUntil(char terminator) {
+    String result;
+    while (available() > 0) {
+      int c = read();
+      if (c < 0 || c == terminator) {
+        break;
+      }
+      result += (char)c;
+    }
+    return result;
+  }
+};
+
+// USB CDC serial port. Output goes to stdout when echo is on; input is whatever the simulator
+// injected with SimSerial::inject().
+class SimSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  operator bool() const { return true; }
+  int available() override { return input.size() - readPos; }
+  int read() override { return readPos < input.size() ? (uint8_t)input[readPos++] : -1; }
+  int peek() override { return readPos < input.size() ? (uint8_t)input[readPos] : -1; }
+  size_t write(uint8_t c) override {
+    if (echo) {
+      fputc(c, stdout);
+    }
+    return 1;
+  }
+  using Print::write;
+
+  void inject(const char *text) { input += text; }
+  bool echo = false;
+
+private:
+  std::string input;
+  size_t readPos = 0;
+};
+
+extern SimSerial Serial;
+
+// Chip information; the heap figures are fixed, the host heap has nothing comparable
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+};
+
+extern EspClass ESP;
+
+// Hardware timer, advanced by the simulator clock (one tick per microsecond at divider 80)
+typedef struct hw_timer_s hw_timer_t;
+hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp);
+void timerAttachInterrupt(hw_timer_t *timer, void (*handler)(), bool edge);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarmValue, bool autoreload);
+void timerAlarmEnable(hw_timer_t *timer);
+void timerAlarmDisable(hw_timer_t *timer);
+void timerWrite(hw_timer_t *timer, uint64_t value);
+uint64_t timerRead(hw_timer_t *timer);
+
+// The simulator is single threaded, so critical sections are no-ops
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux) (void)(mux)
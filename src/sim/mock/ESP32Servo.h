@@ -0,0 +1,11 @@
+#pragma once
+
+#include <Arduino.h>
+#include "SimHardware.h"
+
+class Servo {
+public:
+  void setPeriodHertz(int) {}
+  int attach(int pin, int, int) { return pin; }
+  void write(int angle) { simServoWrite(angle); }
+};
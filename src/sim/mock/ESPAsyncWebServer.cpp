@@ -0,0 +1,37 @@
+#include "ESPAsyncWebServer.h"
+
+static std::map<String, ArRequestHandlerFunction> &routes() {
+  static std::map<String, ArRequestHandlerFunction> handlers;
+  return handlers;
+}
+
+static std::vector<AsyncWebHandler *> &handlers() {
+  static std::vector<AsyncWebHandler *> added;
+  return added;
+}
+
+AsyncWebHandler &AsyncWebServer::addHandler(AsyncWebHandler *handler) {
+  handlers().push_back(handler);
+  return *handler;
+}
+
+void AsyncWebServer::on(const char *uri, WebRequestMethodComposite, ArRequestHandlerFunction handler) {
+  routes()[uri] = handler;
+}
+
+SimHttpResponse simHttpGet(const String &url, const std::map<String, String> &params, const std::map<String, String> &headers) {
+  AsyncWebServerRequest request(url, params, headers);
+  auto route = routes().find(url);
+  if (route != routes().end()) {
+    route->second(&request);
+    return request.response;
+  }
+  for (AsyncWebHandler *handler : handlers()) {
+    if (handler->canHandle(&request)) {
+      handler->handleRequest(&request);
+      return request.response;
+    }
+  }
+  request.send(404, "text/plain", "Not found");
+  return request.response;
+}
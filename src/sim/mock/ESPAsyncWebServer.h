@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include <vector>
+
+// Routes registered with server.on() are kept so the simulator can call the real handlers with
+// simHttpGet() instead of going through a network stack.
+
+enum WebRequestMethod { HTTP_GET = 0b00000001, HTTP_POST = 0b00000010, HTTP_ANY = 0b01111111 };
+typedef int WebRequestMethodComposite;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String &name, const String &value) : paramName(name), paramValue(value) {}
+  const String &name() const { return paramName; }
+  const String &value() const { return paramValue; }
+
+private:
+  String paramName;
+  String paramValue;
+};
+
+struct SimHttpResponse {
+  int code = 0;
+  String contentType;
+  String body; // Raw bytes, e.g. still gzip-compressed for embedded assets
+  std::map<String, String> headers;
+};
+
+class AsyncWebServerResponse {
+public:
+  void addHeader(const String &name, const String &value) { response.headers[name] = value; }
+
+  SimHttpResponse response;
+};
+
+class AsyncWebServerRequest {
+public:
+  AsyncWebServerRequest(const String &url, const std::map<String, String> &params, const std::map<String, String> &headers)
+      : requestUrl(url), requestHeaders(headers) {
+    for (const auto &param : params) {
+      parameters.emplace_back(param.first, param.second);
+    }
+  }
+
+  const String &url() const { return requestUrl; }
+  WebRequestMethodComposite method() const { return HTTP_GET; }
+  void addInterestingHeader(const String &) {}
+  bool hasHeader(const String &name) const { return requestHeaders.count(name) > 0; }
+  const String &header(const char *name) const { return requestHeaders.at(name); }
+  bool hasParam(const String &name, bool = false) const { return findParam(name) != nullptr; }
+  AsyncWebParameter *getParam(const String &name, bool = false) { return const_cast<AsyncWebParameter *>(findParam(name)); }
+  void send(int code, const String &contentType = String(), const String &content = String()) {
+    response.code = code;
+    response.contentType = contentType;
+    response.body = content;
+  }
+  AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String()) {
+    AsyncWebServerResponse *built = new AsyncWebServerResponse();
+    built->response.code = code;
+    built->response.contentType = contentType;
+    built->response.body = content;
+    return built;
+  }
+  AsyncWebServerResponse *beginResponse_P(int code, const String &contentType, const uint8_t *content, size_t length) {
+    return beginResponse(code, contentType, String(std::string((const char *)content, length)));
+  }
+  void send(AsyncWebServerResponse *built) {
+    response = built->response;
+    delete built;
+  }
+
+  SimHttpResponse response;
+
+private:
+  const AsyncWebParameter *findParam(const String &name) const {
+    for (const auto &param : parameters) {
+      if (param.name() == name) {
+        return &param;
+      }
+    }
+    return nullptr;
+  }
+
+  String requestUrl;
+  std::map<String, String> requestHeaders;
+  std::vector<AsyncWebParameter> parameters;
+};
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() {}
+  virtual bool canHandle(AsyncWebServerRequest *) { return false; }
+  virtual void handleRequest(AsyncWebServerRequest *) {}
+};
+
+class AsyncEventSourceClient {
+public:
+  void send(const char *, const char * = nullptr, uint32_t = 0, uint32_t = 0) {}
+};
+
+// Server-Sent Events endpoint. The simulator has no clients, so nothing is ever sent.
+class AsyncEventSource : public AsyncWebHandler {
+public:
+  explicit AsyncEventSource(const char *) {}
+  void onConnect(std::function<void(AsyncEventSourceClient *client)>) {}
+  void send(const char *, const char * = nullptr, uint32_t = 0, uint32_t = 0) {}
+  size_t count() const { return 0; }
+};
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t) {}
+  void on(const char *uri, WebRequestMethodComposite, ArRequestHandlerFunction handler);
+  AsyncWebHandler &addHandler(AsyncWebHandler *handler);
+  void begin() {}
+};
+
+// Call a registered GET handler. Unknown URLs answer 404 like the real server.
+SimHttpResponse simHttpGet(const String &url, const std::map<String, String> &params = {},
+                           const std::map<String, String> &headers = {});
@@ -0,0 +1,5 @@
+#include <SPIFFS.h>
+#include <WiFi.h>
+
+SPIFFSClass SPIFFS;
+WiFiClass WiFi;
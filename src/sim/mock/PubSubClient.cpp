@@ -0,0 +1,192 @@
+#include "PubSubClient.h"
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+enum { CONNECT = 0x10, CONNACK = 0x20, PUBLISH = 0x30, SUBSCRIBE = 0x82, PINGREQ = 0xC0, DISCONNECT = 0xE0 };
+
+static uint64_t hostMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void appendString(std::string &out, const char *text) {
+  size_t length = strlen(text);
+  out += (char)(length >> 8);
+  out += (char)(length & 0xFF);
+  out.append(text, length);
+}
+
+PubSubClient &PubSubClient::setServer(const char *serverHost, uint16_t serverPort) {
+  host = serverHost;
+  port = serverPort;
+  return *this;
+}
+
+PubSubClient &PubSubClient::setCallback(Callback handler) {
+  callback = handler;
+  return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+  bufferSize = size;
+  return true;
+}
+
+PubSubClient &PubSubClient::setKeepAlive(uint16_t seconds) {
+  keepAliveS = seconds;
+  return *this;
+}
+
+PubSubClient &PubSubClient::setSocketTimeout(uint16_t seconds) {
+  timeoutS = seconds;
+  return *this;
+}
+
+bool PubSubClient::connect(const char *id, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage) {
+  disconnect();
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addresses = nullptr;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+    lastState = MQTT_CONNECT_FAILED;
+    return false;
+  }
+  for (addrinfo *address = addresses; address && socket < 0; address = address->ai_next) {
+    socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (socket >= 0 && ::connect(socket, address->ai_addr, address->ai_addrlen) != 0) {
+      close(socket);
+      socket = -1;
+    }
+  }
+  freeaddrinfo(addresses);
+  if (socket < 0) {
+    lastState = MQTT_CONNECT_FAILED;
+    return false;
+  }
+
+  std::string body;
+  appendString(body, "MQTT");
+  body += (char)4; // Protocol level 3.1.1
+  body += (char)(0x02 | 0x04 | ((willQos & 3) << 3) | (willRetain ? 0x20 : 0)); // Clean session, will
+  body += (char)(keepAliveS >> 8);
+  body += (char)(keepAliveS & 0xFF);
+  appendString(body, id);
+  appendString(body, willTopic);
+  appendString(body, willMessage);
+  uint8_t ack[4];
+  pollfd wait = { socket, POLLIN, 0 };
+  if (!sendPacket(CONNECT, body) || poll(&wait, 1, timeoutS * 1000) != 1 || recv(socket, ack, sizeof(ack), MSG_WAITALL) != sizeof(ack) ||
+      ack[0] != CONNACK || ack[3] != 0) {
+    disconnect();
+    lastState = MQTT_CONNECTION_TIMEOUT;
+    return false;
+  }
+  fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+  lastState = MQTT_CONNECTED;
+  return true;
+}
+
+void PubSubClient::disconnect() {
+  if (socket >= 0) {
+    sendPacket(DISCONNECT, "");
+    close(socket);
+    socket = -1;
+  }
+  received.clear();
+  lastState = MQTT_DISCONNECTED;
+}
+
+void PubSubClient::lost() {
+  close(socket);
+  socket = -1;
+  received.clear();
+  lastState = MQTT_CONNECTION_LOST;
+}
+
+bool PubSubClient::sendPacket(uint8_t type, const std::string &body) {
+  std::string packet(1, (char)type);
+  size_t length = body.size();
+  do {
+    uint8_t digit = length % 128;
+    length /= 128;
+    packet += (char)(digit | (length ? 0x80 : 0));
+  } while (length);
+  packet += body;
+  if (send(socket, packet.data(), packet.size(), MSG_NOSIGNAL) != (ssize_t)packet.size()) {
+    return false; // The next loop() finds the connection gone
+  }
+  lastSentMs = hostMs();
+  return true;
+}
+
+bool PubSubClient::loop() {
+  if (socket < 0) {
+    return false;
+  }
+  char chunk[1024];
+  ssize_t count;
+  while ((count = recv(socket, chunk, sizeof(chunk), 0)) > 0) {
+    received.append(chunk, count);
+  }
+  if (count == 0 || (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    lost();
+    return false;
+  }
+  for (;;) {
+    // Fixed header: type byte and up to four bytes of remaining length
+    size_t length = 0, header = 1;
+    bool complete = false;
+    while (!complete && header < received.size() && header <= 4) {
+      uint8_t digit = received[header];
+      length |= (size_t)(digit & 0x7F) << (7 * (header - 1));
+      complete = !(digit & 0x80);
+      header++;
+    }
+    if (!complete || received.size() < header + length) {
+      break; // Not all of the packet is in yet
+    }
+    uint8_t type = received[0];
+    std::string body = received.substr(header, length);
+    received.erase(0, header + length);
+    if ((type & 0xF0) == PUBLISH && body.size() >= 2 && callback && header + length <= bufferSize) {
+      size_t topicLength = ((uint8_t)body[0] << 8) | (uint8_t)body[1];
+      size_t payloadStart = 2 + topicLength + ((type & 0x06) ? 2 : 0); // Packet id only above QoS 0
+      if (payloadStart <= body.size()) {
+        std::string topic = body.substr(2, topicLength);
+        callback(&topic[0], (uint8_t *)&body[payloadStart], body.size() - payloadStart);
+      }
+    }
+  }
+  if (hostMs() - lastSentMs >= keepAliveS * 1000ULL) {
+    sendPacket(PINGREQ, "");
+  }
+  return true;
+}
+
+bool PubSubClient::subscribe(const char *topic) {
+  if (socket < 0) {
+    return false;
+  }
+  std::string body;
+  packetId = packetId == 0xFFFF ? 1 : packetId + 1;
+  body += (char)(packetId >> 8);
+  body += (char)(packetId & 0xFF);
+  appendString(body, topic);
+  body += (char)0; // QoS 0; the SUBACK is skipped by loop()
+  return sendPacket(SUBSCRIBE, body);
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained) {
+  if (socket < 0) {
+    return false;
+  }
+  std::string body;
+  appendString(body, topic);
+  body += payload;
+  return body.size() + 5 <= bufferSize && sendPacket(PUBLISH | (retained ? 1 : 0), body);
+}
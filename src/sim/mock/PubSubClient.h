@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <string>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+// The subset of PubSubClient the firmware uses, speaking MQTT 3.1.1 (QoS 0) to a real broker
+// over a host socket, so simulated machines can join a fleet on a local Mosquitto. The
+// keepalive runs on the host clock, since the simulated one jumps.
+class PubSubClient {
+public:
+  typedef void (*Callback)(char *topic, uint8_t *payload, unsigned int length);
+
+  explicit PubSubClient(WiFiClient &) {}
+  ~PubSubClient() { disconnect(); }
+
+  PubSubClient &setServer(const char *host, uint16_t port);
+  PubSubClient &setCallback(Callback handler);
+  bool setBufferSize(uint16_t size);
+  PubSubClient &setKeepAlive(uint16_t seconds);
+  PubSubClient &setSocketTimeout(uint16_t seconds);
+
+  bool connect(const char *id, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage);
+  void disconnect();
+  bool connected() const { return socket >= 0; }
+  bool loop();
+  bool subscribe(const char *topic);
+  bool publish(const char *topic, const char *payload, bool retained = false);
+  int state() const { return lastState; }
+
+private:
+  bool sendPacket(uint8_t type, const std::string &body);
+  void lost();
+
+  std::string host;
+  uint16_t port = 1883;
+  Callback callback = nullptr;
+  size_t bufferSize = 256;
+  uint16_t keepAliveS = 15;
+  uint16_t timeoutS = 15;
+  int socket = -1;
+  int lastState = MQTT_DISCONNECTED;
+  uint16_t packetId = 0;
+  std::string received; // Bytes of packets not complete yet
+  uint64_t lastSentMs = 0;
+};
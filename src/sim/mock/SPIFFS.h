@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+// In-memory file system. Every simulator run starts empty unless files are preloaded with
+// SPIFFSClass::preload().
+class File : public Stream {
+public:
+  File() {}
+  File(std::shared_ptr<std::string> data, size_t position) : data(data), pos(position) {}
+
+  operator bool() const { return data != nullptr; }
+  int available() override { return data ? (int)(data->size() - pos) : 0; }
+  int read() override { return available() > 0 ? (uint8_t)(*data)[pos++] : -1; }
+  int peek() override { return available() > 0 ? (uint8_t)(*data)[pos] : -1; }
+  size_t read(uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (n < size && available() > 0) {
+      buffer[n++] = (uint8_t)read();
+    }
+    return n;
+  }
+  size_t write(uint8_t c) override {
+    if (!data) {
+      return 0;
+    }
+    if (pos < data->size()) {
+      (*data)[pos] = (char)c;
+    } else {
+      data->push_back((char)c);
+    }
+    pos++;
+    return 1;
+  }
+  using Print::write;
+  bool seek(size_t position) {
+    if (!data || position > data->size()) {
+      return false;
+    }
+    pos = position;
+    return true;
+  }
+  size_t position() const { return pos; }
+  size_t size() const { return data ? data->size() : 0; }
+  void flush() {}
+  void close() { data.reset(); }
+
+private:
+  std::shared_ptr<std::string> data;
+  size_t pos = 0;
+};
+
+class SPIFFSClass {
+public:
+  bool begin(bool = false) { return true; }
+  bool format() {
+    files.clear();
+    return true;
+  }
+  bool exists(const String &path) const { return files.count(path.c_str()) > 0; }
+  bool remove(const String &path) { return files.erase(path.c_str()) > 0; }
+  bool rename(const String &from, const String &to) {
+    auto it = files.find(from.c_str());
+    if (it == files.end()) {
+      return false;
+    }
+    files[to.c_str()] = it->second;
+    files.erase(it);
+    return true;
+  }
+  File open(const String &path, const char *mode = FILE_READ) {
+    auto it = files.find(path.c_str());
+    if (mode[0] == 'r') {
+      return it == files.end() ? File() : File(it->second, 0);
+    }
+    if (it == files.end() || mode[0] == 'w') {
+      files[path.c_str()] = std::make_shared<std::string>(); // Writing truncates, like SPIFFS
+    }
+    std::shared_ptr<std::string> data = files[path.c_str()];
+    return File(data, mode[0] == 'a' ? data->size() : 0);
+  }
+  size_t totalBytes() const { return 1441792; } // no_ota.csv SPIFFS partition
+  size_t usedBytes() const {
+    size_t used = 0;
+    for (const auto &file : files) {
+      used += file.second->size();
+    }
+    return used;
+  }
+
+  void preload(const String &path, const std::string &contents) { files[path.c_str()] = std::make_shared<std::string>(contents); }
+
+private:
+  std::map<std::string, std::shared_ptr<std::string>> files;
+};
+
+extern SPIFFSClass SPIFFS;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Simulator side of the mocked hardware: the virtual clock, the step timer and pin writes.
+
+typedef void (*SimPinListener)(uint8_t pin, uint8_t level, uint64_t timeUs);
+typedef void (*SimServoListener)(int angle, uint64_t timeUs);
+
+uint64_t simNowUs();
+void simAdvanceTo(uint64_t timeUs); // Never moves the clock backwards
+
+// Time the step timer alarm fires next; false while the alarm is disabled.
+bool simTimerNextAlarm(uint64_t &timeUs);
+// Advance the clock to the next alarm and run the interrupt handler.
+void simTimerFire();
+
+// Called for every digitalWrite() that changes a pin level.
+void simOnPinWrite(SimPinListener listener);
+
+// Called for every Servo::write() with the angle in servo degrees (0-180).
+void simOnServoWrite(SimServoListener listener);
+void simServoWrite(int angle);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum WiFiMode { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+enum WiFiStatus { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+
+// The host is always on the network: begin() joins at once, and the MQTT client connects
+// through the host's own sockets (see PubSubClient.h).
+class WiFiClass {
+public:
+  void macAddress(uint8_t *mac) { memset(mac, 0, 6); }
+  bool softAP(const char *, const char *) { return true; }
+  String softAPIP() { return "192.168.4.1"; }
+  bool mode(WiFiMode) { return true; }
+  void begin(const char *, const char *) { joined = true; }
+  int status() const { return joined ? WL_CONNECTED : WL_DISCONNECTED; }
+
+private:
+  bool joined = false;
+};
+
+class WiFiClient {};
+
+extern WiFiClass WiFi;
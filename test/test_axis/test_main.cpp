@@ -0,0 +1,84 @@
+#include <unity.h>
+#include "Axis.h"
+
+// The host GpioBank writes through digitalWrite(); record the calls instead of the simulator
+struct PinWrite {
+  uint8_t pin;
+  uint8_t level;
+};
+PinWrite writes[64];
+int writeCount = 0;
+uint8_t modes[32];
+
+void pinMode(uint8_t pin, uint8_t mode) { modes[pin] = mode; }
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (writeCount < 64) {
+    writes[writeCount] = { pin, level };
+  }
+  writeCount++;
+}
+
+void setUp() {
+  writeCount = 0;
+  memset(modes, 0xFF, sizeof(modes));
+}
+void tearDown() {}
+
+typedef Axis<18, 17> X;
+typedef Axis<9, 8, true> InvertedZ;
+
+void test_masks() {
+  TEST_ASSERT_EQUAL_UINT32(1UL << 18, X::pulseMask);
+  TEST_ASSERT_EQUAL_UINT32(1UL << 17, X::directionMask);
+  TEST_ASSERT_EQUAL_UINT32(1UL << 9, InvertedZ::pulseMask);
+  TEST_ASSERT_EQUAL_UINT32(1UL << 8, InvertedZ::directionMask);
+  TEST_ASSERT_EQUAL(HIGH, X::forwardLevel);
+  TEST_ASSERT_EQUAL(LOW, InvertedZ::forwardLevel);
+}
+
+void test_direction_bits() {
+  TEST_ASSERT_EQUAL_UINT32(X::directionMask, X::directionBits(true));
+  TEST_ASSERT_EQUAL_UINT32(0, X::directionBits(false));
+  TEST_ASSERT_EQUAL_UINT32(0, InvertedZ::directionBits(true));
+  TEST_ASSERT_EQUAL_UINT32(InvertedZ::directionMask, InvertedZ::directionBits(false));
+}
+
+void test_begin_drives_pulse_low() {
+  X::begin();
+  TEST_ASSERT_EQUAL(OUTPUT, modes[18]);
+  TEST_ASSERT_EQUAL(OUTPUT, modes[17]);
+  TEST_ASSERT_EQUAL(1, writeCount);
+  TEST_ASSERT_EQUAL(18, writes[0].pin);
+  TEST_ASSERT_EQUAL(LOW, writes[0].level);
+}
+
+// Set and clear masks touch only their own pins, once each; a pin in both goes high
+void test_bank_set_and_clear() {
+  GpioBank::write(X::pulseMask | InvertedZ::directionBits(false), X::directionMask | InvertedZ::pulseMask);
+  TEST_ASSERT_EQUAL(4, writeCount);
+  const PinWrite expected[] = { { 8, HIGH }, { 9, LOW }, { 17, LOW }, { 18, HIGH } };
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(expected[i].pin, writes[i].pin);
+    TEST_ASSERT_EQUAL(expected[i].level, writes[i].level);
+  }
+
+  writeCount = 0;
+  GpioBank::write(0, 0);
+  TEST_ASSERT_EQUAL(0, writeCount);
+
+  GpioBank::write(1UL << 31, (1UL << 31) | 1);
+  TEST_ASSERT_EQUAL(2, writeCount);
+  TEST_ASSERT_EQUAL(0, writes[0].pin);
+  TEST_ASSERT_EQUAL(LOW, writes[0].level);
+  TEST_ASSERT_EQUAL(31, writes[1].pin);
+  TEST_ASSERT_EQUAL(HIGH, writes[1].level);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_masks);
+  RUN_TEST(test_direction_bits);
+  RUN_TEST(test_begin_drives_pulse_low);
+  RUN_TEST(test_bank_set_and_clear);
+  return UNITY_END();
+}
@@ -0,0 +1,154 @@
+#include <unity.h>
+#include "CurrentMonitor.h"
+#include "FeedTuner.h"
+
+// The firmware's limits (main.cpp)
+const CurrentLimits Limits = { 2500, 50, 400, 10, 40 };
+const uint32_t SampleMs = 2;
+
+// A piece of a synthetic trace: 'currentMa' for 'ms', moving or not
+struct Segment {
+  uint32_t ms;
+  uint32_t currentMa;
+  bool moving;
+};
+
+struct TraceResult {
+  CurrentEvent event; // First event reported
+  uint32_t atMs;      // ... and when
+  uint32_t events;    // Events reported in all
+};
+
+TraceResult play(CurrentMonitor &monitor, const Segment *segments, size_t count) {
+  TraceResult result = { CURRENT_NORMAL, 0, 0 };
+  uint32_t timeMs = 0;
+  for (size_t i = 0; i < count; i++) {
+    for (uint32_t end = timeMs + segments[i].ms; timeMs < end; timeMs += SampleMs) {
+      CurrentEvent event = monitor.sample(timeMs, segments[i].currentMa, segments[i].moving);
+      if (event != CURRENT_NORMAL) {
+        if (result.events++ == 0) {
+          result.event = event;
+          result.atMs = timeMs;
+        }
+      }
+    }
+  }
+  return result;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Standstill current, then a move that draws much more but steadily: not a stall
+void test_running_current_step_is_not_a_stall() {
+  CurrentMonitor monitor(Limits);
+  const Segment trace[] = { { 200, 300, false }, { 1000, 900, true }, { 200, 300, false }, { 1000, 1400, true } };
+  TraceResult result = play(monitor, trace, 4);
+  TEST_ASSERT_EQUAL(0, result.events);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1390, monitor.peakMa()); // The smoothed current levels off just below
+}
+
+void test_current_jump_while_running_is_a_stall() {
+  CurrentMonitor monitor(Limits);
+  const Segment trace[] = { { 200, 300, false }, { 300, 900, true }, { 100, 1600, true } };
+  TraceResult result = play(monitor, trace, 3);
+  TEST_ASSERT_EQUAL(CURRENT_STALL, result.event);
+  TEST_ASSERT_EQUAL(1, result.events); // Reported once per motion
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(500 + Limits.stallMs, result.atMs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(500 + 30, result.atMs);
+}
+
+// Shorter than stallMs: a chopper or step transient
+void test_short_spike_is_ignored() {
+  CurrentMonitor monitor(Limits);
+  const Segment trace[] = { { 300, 900, true }, { 4, 2000, true }, { 300, 900, true } };
+  TEST_ASSERT_EQUAL(0, play(monitor, trace, 3).events);
+}
+
+// A slow climb with the speed is followed by the running average
+void test_ramp_is_followed() {
+  CurrentMonitor monitor(Limits);
+  TraceResult result = { CURRENT_NORMAL, 0, 0 };
+  for (uint32_t timeMs = 0; timeMs < 2000; timeMs += SampleMs) {
+    result.events += monitor.sample(timeMs, 300 + timeMs / 2, true) != CURRENT_NORMAL;
+  }
+  TEST_ASSERT_EQUAL(0, result.events);
+}
+
+void test_overload() {
+  CurrentMonitor monitor(Limits);
+  const Segment trace[] = { { 100, 300, false }, { 200, 2800, true } };
+  TraceResult result = play(monitor, trace, 2);
+  TEST_ASSERT_EQUAL(CURRENT_OVERLOAD, result.event);
+  TEST_ASSERT_EQUAL(1, result.events);
+  // Above the limit for overloadMs, judged from the first sample of the motion on
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(100 + Limits.overloadMs + 20, result.atMs);
+}
+
+// After the motion stops, the next one is judged afresh
+void test_event_reported_again_after_stop() {
+  CurrentMonitor monitor(Limits);
+  const Segment trace[] = { { 300, 900, true }, { 100, 1600, true }, { 100, 300, false }, { 300, 900, true }, { 100, 1600, true } };
+  TEST_ASSERT_EQUAL(2, play(monitor, trace, 5).events);
+}
+
+// Trials of a synthetic motor: current by feedrate and acceleration, stalling above a rate
+struct Motor {
+  uint32_t stallRate;
+  uint32_t programRate; // Fastest the trial program gets to (its moves are this short), 0: any
+};
+
+void runTuner(FeedTuner &tuner, const Motor &motor) {
+  for (int trial = 0; tuner.active() && trial < 200; trial++) {
+    uint32_t rate = motor.programRate && tuner.feedrate() > motor.programRate ? motor.programRate : tuner.feedrate();
+    uint32_t peakMa = 300 + rate * 3 / 10 + tuner.accel() / 100;
+    tuner.report(peakMa, rate, rate > motor.stallRate);
+  }
+}
+
+const TuneLimits Tune = { 20000, 200000, 10, 2500, 300 };
+
+void test_tuner_stops_below_the_stall() {
+  FeedTuner tuner;
+  tuner.begin(1500, 5000, Tune);
+  runTuner(tuner, { 4000, 0 });
+  TEST_ASSERT_EQUAL(TUNE_DONE, tuner.phase());
+  TEST_ASSERT_TRUE(tuner.passed());
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(4000, tuner.bestFeedrate());
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(4000 * 100 / 110, tuner.bestFeedrate());
+  // The acceleration is then raised until the current margin runs out:
+  // 300 + 0.3 * feedrate + accel / 100 <= 2200
+  uint32_t peakMa = 300 + tuner.bestFeedrate() * 3 / 10 + tuner.bestAccel() / 100;
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2200, peakMa);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(2200 - 220, peakMa);
+}
+
+void test_tuner_keeps_to_what_the_program_tested() {
+  FeedTuner tuner;
+  tuner.begin(1500, 5000, Tune);
+  runTuner(tuner, { 20000, 2500 });
+  TEST_ASSERT_TRUE(tuner.passed());
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2500 * 110 / 100, tuner.bestFeedrate());
+}
+
+void test_tuner_fails_without_margin() {
+  FeedTuner tuner;
+  tuner.begin(1500, 5000, Tune);
+  tuner.report(2300, 1500, false);
+  TEST_ASSERT_EQUAL(TUNE_DONE, tuner.phase());
+  TEST_ASSERT_FALSE(tuner.passed());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_running_current_step_is_not_a_stall);
+  RUN_TEST(test_current_jump_while_running_is_a_stall);
+  RUN_TEST(test_short_spike_is_ignored);
+  RUN_TEST(test_ramp_is_followed);
+  RUN_TEST(test_overload);
+  RUN_TEST(test_event_reported_again_after_stop);
+  RUN_TEST(test_tuner_stops_below_the_stall);
+  RUN_TEST(test_tuner_keeps_to_what_the_program_tested);
+  RUN_TEST(test_tuner_fails_without_margin);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include <unity.h>
+#include <string.h>
+#include "Interpreter.h"
+#include "Optimizer.h"
+
+const ProgramLimits Limits = { 170, 345 }; // The firmware's servo range (main.cpp)
+const size_t Capacity = 256;               // COMMAND_QUEUE_SIZE
+const int SettingCount = OP_SERVO_SPEED - OP_X_FEEDRATE + 1;
+const size_t MaxTrace = 4096;
+
+// A command as the machine sees it: a servo, delay or move with the settings in force for it
+struct Effect {
+  uint8_t op;
+  int32_t a;
+  int32_t b;
+  int32_t settings[SettingCount];
+};
+
+struct Trace {
+  Instruction commands[MaxTrace]; // What the interpreter hands out, settings included
+  size_t count;
+  Effect effects[MaxTrace];       // The same reduced to what it does
+  size_t effectCount;
+  int32_t settings[SettingCount]; // In force at the end
+  bool overflow;
+};
+
+Trace original;
+Trace optimized;
+Instruction program[Capacity];
+size_t programLength; // Of 'program' once optimized
+
+// Back-to-back moves along one axis in one direction, or delays, with the same settings
+bool sameRun(const Effect &last, const Effect &next) {
+  if (last.op != next.op || memcmp(last.settings, next.settings, sizeof(last.settings)) != 0) {
+    return false;
+  }
+  if (next.op == OP_DELAY) {
+    return true;
+  }
+  if (next.op != OP_MOVE) {
+    return false;
+  }
+  bool xOnly = last.b == 0 && next.b == 0;
+  bool zOnly = last.a == 0 && next.a == 0;
+  int32_t first = xOnly ? last.a : last.b;
+  int32_t second = xOnly ? next.a : next.b;
+  return (xOnly || zOnly) && ((first > 0) == (second > 0));
+}
+
+// Run a program through the interpreter. Settings only count through the commands they apply
+// to, a servo command that leaves the angle alone and a zero-length move do nothing, and runs
+// of moves or delays count as their sum, so this is the same for every rewrite the optimizer may
+// make and changes with any it must not.
+void run(const Instruction *image, size_t count, Trace &trace) {
+  memset(&trace, 0, sizeof(trace));
+  for (int setting = 0; setting < SettingCount; setting++) {
+    trace.settings[setting] = INT32_MIN; // Whatever the machine had before
+  }
+  int32_t servoAngle = -1;
+  Interpreter interpreter;
+  interpreter.start(image, count);
+  Instruction command;
+  while (interpreter.peek(command)) {
+    interpreter.pop();
+    if (trace.count == MaxTrace) {
+      trace.overflow = true;
+      return;
+    }
+    trace.commands[trace.count++] = command;
+    if (command.op >= OP_X_FEEDRATE && command.op <= OP_SERVO_SPEED) {
+      trace.settings[command.op - OP_X_FEEDRATE] = command.a;
+      continue;
+    }
+    if ((command.op == OP_MOVE && command.a == 0 && command.b == 0) || (command.op == OP_SERVO && command.a == servoAngle)) {
+      continue;
+    }
+    if (command.op == OP_SERVO) {
+      servoAngle = command.a;
+    }
+    Effect effect = { command.op, command.a, command.b, {} };
+    memcpy(effect.settings, trace.settings, sizeof(effect.settings));
+    if (trace.effectCount > 0 && sameRun(trace.effects[trace.effectCount - 1], effect)) {
+      trace.effects[trace.effectCount - 1].a += effect.a;
+      trace.effects[trace.effectCount - 1].b += effect.b;
+      continue;
+    }
+    trace.effects[trace.effectCount++] = effect;
+  }
+}
+
+// Every block keeps a command, and the jump targets still land on their blocks
+void checkStructure(const Instruction *image, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    const Instruction &instruction = image[i];
+    if (instruction.op == OP_END_REPEAT) {
+      TEST_ASSERT_TRUE(instruction.a >= 0 && (size_t)instruction.a + 1 < i);
+      TEST_ASSERT_EQUAL(OP_REPEAT, image[instruction.a].op);
+    } else if (instruction.op == OP_SUBROUTINE) {
+      TEST_ASSERT_TRUE((size_t)instruction.a > i + 2 && (size_t)instruction.a <= count);
+      TEST_ASSERT_EQUAL(OP_RETURN, image[instruction.a - 1].op);
+    } else if (instruction.op == OP_CALL) {
+      TEST_ASSERT_TRUE(instruction.a >= 1 && (size_t)instruction.a < count);
+      TEST_ASSERT_EQUAL(OP_SUBROUTINE, image[instruction.a - 1].op);
+    }
+  }
+}
+
+// Compile 'text' into 'program', optimize it and check both run the same
+void checkProgram(const char *text) {
+  CompileError error;
+  int count = compileProgram(text, strlen(text), Limits, program, Capacity, error);
+  if (count <= 0) {
+    printf("%s: %s\n", text, error.message);
+  }
+  TEST_ASSERT_TRUE(count > 0);
+  run(program, count, original);
+  programLength = optimizeProgram(program, count, nullptr);
+  TEST_ASSERT_LESS_OR_EQUAL((size_t)count, programLength);
+  checkStructure(program, programLength);
+  run(program, programLength, optimized);
+
+  TEST_ASSERT_FALSE(original.overflow);
+  TEST_ASSERT_FALSE(optimized.overflow);
+  TEST_ASSERT_LESS_OR_EQUAL(original.count, optimized.count);
+  TEST_ASSERT_EQUAL(original.effectCount, optimized.effectCount);
+  for (size_t i = 0; i < original.effectCount; i++) {
+    const Effect &expected = original.effects[i];
+    const Effect &actual = optimized.effects[i];
+    TEST_ASSERT_EQUAL(expected.op, actual.op);
+    TEST_ASSERT_EQUAL(expected.a, actual.a);
+    TEST_ASSERT_EQUAL(expected.b, actual.b);
+    TEST_ASSERT_EQUAL(0, memcmp(expected.settings, actual.settings, sizeof(expected.settings)));
+  }
+  TEST_ASSERT_EQUAL(0, memcmp(original.settings, optimized.settings, sizeof(original.settings)));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_straight_program() {
+  checkProgram("F1500, F1500, S170, X-100, X-200, X0, D50, D50, S170, S345, G900, Z10, C20, C30");
+  TEST_ASSERT_EQUAL(8, programLength);
+  checkProgram("S170, X-100, S345, X100, Z20, D10"); // Nothing to drop
+  TEST_ASSERT_EQUAL(6, programLength);
+}
+
+void test_nested_repeats() {
+  checkProgram("F1500, R3{S170, D50, D50, Z0, R2{X10, X20}, S345}, X-4250");
+  checkProgram("R2{F1000, R2{F1000, X-10, X-10, R3{D5, D5}, X-10}, F1000}, F1000, X-10");
+  checkProgram("S170, R2{S170, X-100}, S170, R3{R2{R2{Z5, Z5}}}");
+}
+
+void test_subroutines_and_calls() {
+  checkProgram(":hook{G900, G900, X5, X5}, @hook, R2{@hook, D10, D10}, @hook");
+  checkProgram("@bend, :bend{S170, S345, S345, X-10, X-20}, R3{@bend, X-4250}, X-2000, @bend");
+  checkProgram(":a{R2{F100, X1, X1}}, :b{@a, D5, D5, @a}, R2{@b, S170, S170}, @a, @b");
+}
+
+// A block of nothing but redundancies keeps one command, the jumps around it stay right
+void test_no_block_left_empty() {
+  checkProgram("R2{X0, X0}, :idle{Z0}, @idle, R3{D10, D10}");
+  TEST_ASSERT_EQUAL(10, programLength);
+  checkProgram("F100, R2{F100}, :again{F100, F100}, @again, S170, R2{S170, S170}, X-10");
+  checkProgram("R2{R2{X0}, X0, R2{G5, G5}}, :z{Z0, Z0, Z0}, R2{@z}");
+}
+
+// Small deterministic generator so many shapes get tried, not only the ones above
+uint32_t seed;
+
+uint32_t next(uint32_t range) {
+  seed = seed * 1664525 + 1013904223;
+  return (seed >> 16) % range;
+}
+
+void appendCommand(char *text, size_t size) {
+  static const char *const Commands[] = { "X0", "X-10", "X-20", "X10", "Z0", "Z5", "Z-5", "M X5 Z5", "S170", "S345",
+    "D10", "D5", "F1000", "F2000", "G900", "A5000", "C20", "V300", "H0" };
+  strncat(text, Commands[next(sizeof(Commands) / sizeof(Commands[0]))], size - strlen(text) - 1);
+}
+
+void appendBlock(char *text, size_t size, int depth, int subroutines) {
+  int items = 1 + next(4);
+  for (int i = 0; i < items; i++) {
+    if (i > 0) {
+      strncat(text, ", ", size - strlen(text) - 1);
+    }
+    uint32_t kind = next(8);
+    char head[16];
+    if (kind == 0 && depth < 3) {
+      snprintf(head, sizeof(head), "R%d{", (int)(1 + next(3)));
+      strncat(text, head, size - strlen(text) - 1);
+      appendBlock(text, size, depth + 1, subroutines);
+      strncat(text, "}", size - strlen(text) - 1);
+    } else if (kind == 1 && subroutines > 0) {
+      snprintf(head, sizeof(head), "@s%d", (int)next(subroutines));
+      strncat(text, head, size - strlen(text) - 1);
+    } else {
+      appendCommand(text, size);
+    }
+  }
+}
+
+void test_generated_programs() {
+  seed = 42;
+  for (int round = 0; round < 300; round++) {
+    char text[1024] = "";
+    int subroutines = next(3);
+    for (int s = 0; s < subroutines; s++) {
+      char head[16];
+      snprintf(head, sizeof(head), ":s%d{", s);
+      strncat(text, head, sizeof(text) - strlen(text) - 1);
+      appendBlock(text, sizeof(text), 1, s); // Calls only the ones before it, no recursion
+      strncat(text, "}, ", sizeof(text) - strlen(text) - 1);
+    }
+    appendBlock(text, sizeof(text), 0, subroutines);
+    checkProgram(text);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_straight_program);
+  RUN_TEST(test_nested_repeats);
+  RUN_TEST(test_subroutines_and_calls);
+  RUN_TEST(test_no_block_left_empty);
+  RUN_TEST(test_generated_programs);
+  return UNITY_END();
+}
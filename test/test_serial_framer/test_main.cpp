@@ -0,0 +1,119 @@
+#include <unity.h>
+#include <string.h>
+#include "SerialFramer.h"
+
+char uploadBuffer[64];
+
+// Events of a byte string, one per byte, and what the framer reported with them
+struct Framed {
+  int lines;
+  int uploads;
+  int realtime;
+  int overflows;
+  char lastLine[SerialLineSize + 1];
+  char lastUpload[sizeof(uploadBuffer) + 1];
+  uint8_t lastRealtime;
+};
+
+Framed feed(SerialFramer &framer, const char *bytes, size_t count) {
+  Framed framed = {};
+  for (size_t i = 0; i < count; i++) {
+    switch (framer.push((uint8_t)bytes[i])) {
+      case FRAME_LINE:
+        framed.lines++;
+        memcpy(framed.lastLine, framer.line(), framer.lineLength() + 1);
+        break;
+      case FRAME_UPLOAD:
+        framed.uploads++;
+        memcpy(framed.lastUpload, framer.upload(), framer.uploadLength());
+        framed.lastUpload[framer.uploadLength()] = '\0';
+        break;
+      case FRAME_REALTIME:
+        framed.realtime++;
+        framed.lastRealtime = framer.realtimeByte();
+        break;
+      case FRAME_OVERFLOW:
+        framed.overflows++;
+        break;
+      default:
+        break;
+    }
+  }
+  return framed;
+}
+
+Framed feed(SerialFramer &framer, const char *text) {
+  return feed(framer, text, strlen(text));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_lines_and_whitespace() {
+  SerialFramer framer(uploadBuffer, sizeof(uploadBuffer));
+  Framed framed = feed(framer, "  S170 ,X-4250\r\n,,Z100\n");
+  TEST_ASSERT_EQUAL(3, framed.lines);
+  TEST_ASSERT_EQUAL_STRING("Z100", framed.lastLine);
+}
+
+// Real-time bytes inside a line are taken out of it
+void test_realtime_bytes_inside_a_line() {
+  SerialFramer framer(uploadBuffer, sizeof(uploadBuffer));
+  const char bytes[] = { 'X', '-', '!', '4', '2', '~', '5', '0', (char)0x91, '\n' };
+  Framed framed = feed(framer, bytes, sizeof(bytes));
+  TEST_ASSERT_EQUAL(3, framed.realtime);
+  TEST_ASSERT_EQUAL_HEX8(0x91, framed.lastRealtime);
+  TEST_ASSERT_EQUAL(1, framed.lines);
+  TEST_ASSERT_EQUAL_STRING("X-4250", framed.lastLine);
+}
+
+// Inside an upload only CTRL+C is real-time: '!', '~' and the feed override bytes are payload
+// and count towards its length, so the command after it is framed whole
+void test_upload_keeps_realtime_lookalikes() {
+  SerialFramer framer(uploadBuffer, sizeof(uploadBuffer));
+  const char payload[] = { 'S', '!', '~', (char)0x90, (char)0x94, ',', 'D' };
+  TEST_ASSERT_TRUE(framer.beginUpload(sizeof(payload)));
+  Framed framed = feed(framer, payload, sizeof(payload));
+  TEST_ASSERT_EQUAL(0, framed.realtime);
+  TEST_ASSERT_EQUAL(1, framed.uploads);
+  TEST_ASSERT_EQUAL(sizeof(payload), framer.uploadLength());
+  TEST_ASSERT_EQUAL(0, memcmp(payload, framer.upload(), sizeof(payload)));
+
+  framed = feed(framer, "X100\n");
+  TEST_ASSERT_EQUAL(1, framed.lines);
+  TEST_ASSERT_EQUAL_STRING("X100", framed.lastLine);
+  framed = feed(framer, "!");
+  TEST_ASSERT_EQUAL(1, framed.realtime); // Real-time again after the upload
+}
+
+void test_stop_inside_an_upload() {
+  SerialFramer framer(uploadBuffer, sizeof(uploadBuffer));
+  TEST_ASSERT_TRUE(framer.beginUpload(4));
+  const char bytes[] = { 'S', '1', (char)RealtimeStop, '7', '0' };
+  Framed framed = feed(framer, bytes, sizeof(bytes));
+  TEST_ASSERT_EQUAL(1, framed.realtime);
+  TEST_ASSERT_EQUAL_HEX8(RealtimeStop, framed.lastRealtime);
+  TEST_ASSERT_EQUAL(1, framed.uploads);
+  TEST_ASSERT_EQUAL_STRING("S170", framed.lastUpload);
+}
+
+void test_oversized_upload_is_skipped() {
+  SerialFramer framer(uploadBuffer, sizeof(uploadBuffer));
+  char payload[100];
+  memset(payload, '!', sizeof(payload));
+  TEST_ASSERT_FALSE(framer.beginUpload(sizeof(payload)));
+  Framed framed = feed(framer, payload, sizeof(payload));
+  TEST_ASSERT_EQUAL(0, framed.realtime);
+  TEST_ASSERT_EQUAL(1, framed.overflows);
+  TEST_ASSERT_EQUAL(1, feed(framer, "S345\n").lines);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lines_and_whitespace);
+  RUN_TEST(test_realtime_bytes_inside_a_line);
+  RUN_TEST(test_upload_keeps_realtime_lookalikes);
+  RUN_TEST(test_stop_inside_an_upload);
+  RUN_TEST(test_oversized_upload_is_skipped);
+  return UNITY_END();
+}
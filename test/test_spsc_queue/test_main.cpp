@@ -0,0 +1,117 @@
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "SpscQueue.h"
+
+// Small enough that the stress test wraps and fills the queue constantly
+typedef SpscQueue<uint32_t, 64> Queue;
+
+const uint32_t StressItems = 4000000;
+
+void setUp() {}
+void tearDown() {}
+
+void test_push_pop_in_order() {
+  Queue queue;
+  uint32_t item;
+  TEST_ASSERT_TRUE(queue.empty());
+  TEST_ASSERT_FALSE(queue.pop(item));
+  for (uint32_t i = 0; i < Queue::capacity(); i++) {
+    TEST_ASSERT_TRUE(queue.push(i));
+  }
+  TEST_ASSERT_FALSE(queue.push(99)); // Full
+  TEST_ASSERT_EQUAL(Queue::capacity(), queue.size());
+  TEST_ASSERT_EQUAL(0, queue.available());
+  for (uint32_t i = 0; i < Queue::capacity(); i++) {
+    TEST_ASSERT_EQUAL(i, queue.front());
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL(i, item);
+  }
+  TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_push_all_is_all_or_nothing() {
+  Queue queue;
+  uint32_t block[40];
+  for (uint32_t i = 0; i < 40; i++) {
+    block[i] = i;
+  }
+  TEST_ASSERT_TRUE(queue.pushAll(block, 40));
+  TEST_ASSERT_FALSE(queue.pushAll(block, 40)); // 24 slots left
+  TEST_ASSERT_EQUAL(40, queue.size());
+  TEST_ASSERT_TRUE(queue.pushAll(block, 24));
+  TEST_ASSERT_EQUAL(0, queue.available());
+  queue.clear();
+  TEST_ASSERT_TRUE(queue.empty());
+  TEST_ASSERT_TRUE(queue.pushAll(block, 40)); // Wraps around the end of the storage
+  uint32_t item;
+  TEST_ASSERT_TRUE(queue.pop(item));
+  TEST_ASSERT_EQUAL(0, item);
+}
+
+// A producer and a consumer thread over millions of items, pushed one by one and in blocks of
+// varying size: every item must arrive, once and in order. A third thread reads size() the
+// whole time, which must stay within the capacity.
+void test_threads_lose_nothing() {
+  static Queue queue;
+  std::atomic<bool> done{false};
+  std::atomic<size_t> largestSize{0};
+
+  std::thread producer([] {
+    uint32_t next = 0;
+    uint32_t block[16];
+    while (next < StressItems) {
+      uint32_t n = next % 3 == 0 ? 1 : 1 + next % 16;
+      if (n > StressItems - next) {
+        n = StressItems - next;
+      }
+      for (uint32_t i = 0; i < n; i++) {
+        block[i] = next + i;
+      }
+      if (n == 1 ? queue.push(block[0]) : queue.pushAll(block, n)) {
+        next += n;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  std::thread observer([&] {
+    while (!done.load()) {
+      size_t size = queue.size();
+      if (size > largestSize.load()) {
+        largestSize.store(size);
+      }
+      std::this_thread::yield();
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t item;
+  while (expected < StressItems) {
+    if (!queue.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (item != expected) {
+      outOfOrder++;
+      expected = item; // Count each gap once
+    }
+    expected++;
+  }
+  producer.join();
+  done.store(true);
+  observer.join();
+
+  TEST_ASSERT_EQUAL(0, outOfOrder);
+  TEST_ASSERT_TRUE(queue.empty());
+  TEST_ASSERT_LESS_OR_EQUAL(Queue::capacity(), largestSize.load());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_push_pop_in_order);
+  RUN_TEST(test_push_all_is_all_or_nothing);
+  RUN_TEST(test_threads_lose_nothing);
+  return UNITY_END();
+}
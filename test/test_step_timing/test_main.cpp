@@ -0,0 +1,144 @@
+#include <unity.h>
+#include "StepGenerator.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Plan with no ramps: every step at 'halfPeriod'
+MotionPlan cruisePlan(int32_t xSteps, int32_t zSteps, uint32_t halfPeriod) {
+  MotionPlan plan = {};
+  plan.axisSteps[0] = xSteps;
+  plan.axisSteps[1] = zSteps;
+  uint32_t x = xSteps < 0 ? -xSteps : xSteps;
+  uint32_t z = zSteps < 0 ? -zSteps : zSteps;
+  plan.steps = x > z ? x : z;
+  plan.cruiseHalfPeriod = halfPeriod;
+  return plan;
+}
+
+struct Pulses {
+  uint32_t count[AxisCount];
+  uint32_t alarms;
+  uint32_t ticks;
+  uint32_t longestGap[AxisCount];  // Most lead steps between two pulses of an axis
+  uint32_t shortestGap[AxisCount];
+};
+
+// Run the generator the way the timer interrupt does, counting the rising edges per axis
+Pulses run(StepGenerator &generator) {
+  Pulses pulses = {};
+  uint32_t last[AxisCount] = {};
+  bool seen[AxisCount] = {};
+  for (int axis = 0; axis < AxisCount; axis++) {
+    pulses.shortestGap[axis] = UINT32_MAX;
+  }
+  uint32_t leadStep = 0;
+  uint8_t high = 0;
+  for (;;) {
+    uint8_t mask;
+    uint32_t ticks = generator.onAlarm(mask);
+    if (ticks == 0) {
+      break;
+    }
+    pulses.alarms++;
+    pulses.ticks += ticks;
+    if (mask) {
+      for (int axis = 0; axis < AxisCount; axis++) {
+        if (mask & (1 << axis)) {
+          pulses.count[axis]++;
+          if (seen[axis]) {
+            uint32_t gap = leadStep - last[axis];
+            pulses.longestGap[axis] = gap > pulses.longestGap[axis] ? gap : pulses.longestGap[axis];
+            pulses.shortestGap[axis] = gap < pulses.shortestGap[axis] ? gap : pulses.shortestGap[axis];
+          }
+          seen[axis] = true;
+          last[axis] = leadStep;
+        }
+      }
+      leadStep++;
+    }
+    if (high && mask) {
+      pulses.alarms = UINT32_MAX; // Two rising edges without a falling one
+      break;
+    }
+    high = mask;
+  }
+  return pulses;
+}
+
+void test_half_period_at_the_limits() {
+  TEST_ASSERT_EQUAL_UINT32(500000, halfPeriodTicks(0)); // Treated as the slowest rate
+  TEST_ASSERT_EQUAL_UINT32(500000, halfPeriodTicks(1));
+  TEST_ASSERT_EQUAL_UINT32(250000, halfPeriodTicks(2));
+  TEST_ASSERT_EQUAL_UINT32(2500, halfPeriodTicks(200));
+  TEST_ASSERT_EQUAL_UINT32(333, halfPeriodTicks(1500)); // Rounds down
+  TEST_ASSERT_EQUAL_UINT32(MinHalfPeriodTicks, halfPeriodTicks(50000));
+  TEST_ASSERT_EQUAL_UINT32(MinHalfPeriodTicks + 1, halfPeriodTicks(45000));
+}
+
+void test_half_period_clamps_fast_rates() {
+  TEST_ASSERT_EQUAL_UINT32(MinHalfPeriodTicks, halfPeriodTicks(50001));
+  TEST_ASSERT_EQUAL_UINT32(MinHalfPeriodTicks, halfPeriodTicks(1000000));
+  TEST_ASSERT_EQUAL_UINT32(MinHalfPeriodTicks, halfPeriodTicks(0x80000000UL)); // 2 * rate overflows
+  TEST_ASSERT_EQUAL_UINT32(MinHalfPeriodTicks, halfPeriodTicks(UINT32_MAX));
+}
+
+void test_single_axis_move() {
+  MotionPlan plan = cruisePlan(-250, 0, 100);
+  StepGenerator generator;
+  generator.begin(plan);
+  TEST_ASSERT_TRUE(generator.busy());
+  TEST_ASSERT_EQUAL_HEX8(0x01, generator.axisMask());
+  TEST_ASSERT_EQUAL_HEX8(0x00, generator.forwardMask());
+  Pulses pulses = run(generator);
+  TEST_ASSERT_EQUAL_UINT32(250, pulses.count[0]);
+  TEST_ASSERT_EQUAL_UINT32(0, pulses.count[1]);
+  TEST_ASSERT_EQUAL_UINT32(500, pulses.alarms); // A rising and a falling edge per step
+  TEST_ASSERT_EQUAL_UINT32(500 * 100, pulses.ticks);
+  TEST_ASSERT_EQUAL_UINT32(250, generator.stepsDone());
+  TEST_ASSERT_FALSE(generator.busy());
+}
+
+// Both axes finish together with their exact step counts, the minor axis pulses evenly spread
+// over the lead axis steps
+void test_bresenham_counts() {
+  const int32_t moves[][2] = { { 1000, 371 }, { 371, -1000 }, { -4250, -1800 }, { 7, 1 }, { 999, 998 }, { 500, 500 }, { 1, 1 } };
+  for (const int32_t *move : moves) {
+    MotionPlan plan = cruisePlan(move[0], move[1], 50);
+    StepGenerator generator;
+    generator.begin(plan);
+    TEST_ASSERT_EQUAL_HEX8(0x03, generator.axisMask());
+    TEST_ASSERT_EQUAL_HEX8((move[0] > 0 ? 1 : 0) | (move[1] > 0 ? 2 : 0), generator.forwardMask());
+    Pulses pulses = run(generator);
+    for (int axis = 0; axis < AxisCount; axis++) {
+      uint32_t steps = move[axis] < 0 ? -move[axis] : move[axis];
+      TEST_ASSERT_EQUAL_UINT32(steps, pulses.count[axis]);
+      if (steps > 1) {
+        uint32_t gap = plan.steps / steps;
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(gap, pulses.shortestGap[axis]);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(gap + 1, pulses.longestGap[axis]);
+      }
+    }
+    TEST_ASSERT_EQUAL_UINT32(2 * plan.steps, pulses.alarms);
+    TEST_ASSERT_EQUAL_UINT32(plan.steps, generator.stepsDone());
+  }
+}
+
+void test_empty_move_does_not_run() {
+  MotionPlan plan = cruisePlan(0, 0, 50);
+  StepGenerator generator;
+  generator.begin(plan);
+  TEST_ASSERT_FALSE(generator.busy());
+  uint8_t mask;
+  TEST_ASSERT_EQUAL_UINT32(0, generator.onAlarm(mask));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_half_period_at_the_limits);
+  RUN_TEST(test_half_period_clamps_fast_rates);
+  RUN_TEST(test_single_axis_move);
+  RUN_TEST(test_bresenham_counts);
+  RUN_TEST(test_empty_move_does_not_run);
+  return UNITY_END();
+}
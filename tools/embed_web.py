@@ -0,0 +1,93 @@
+"""Embed the web UI (web/) into the firmware as gzip-compressed assets.
+
+Runs as a PlatformIO pre-build script (extra_scripts = pre:tools/embed_web.py) and writes
+include/WebAssets.h, which main.cpp serves straight from flash. It can also be run by hand:
+
+    python3 tools/embed_web.py
+
+Each asset gets an ETag from its compressed content. index.html refers to app.js as
+/app.js?v=@APP_JS_HASH@; the placeholder is replaced by the script's hash, so the script can be
+cached for good and still changes with every firmware that changes it.
+"""
+
+import gzip
+import hashlib
+import os
+
+ASSETS = [
+    # (file in web/, URL, content type, Cache-Control)
+    ("app.js", "/app.js", "application/javascript", "public, max-age=31536000, immutable"),
+    ("index.html", "/", "text/html", "no-cache"),
+    ("help.html", "/help", "text/html", "no-cache"),
+]
+
+
+def compress(data):
+    # mtime=0 keeps the output, and so the ETag, identical between builds
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def symbol(name):
+    return "web_" + name.replace(".", "_")
+
+
+def generate(project_dir):
+    web_dir = os.path.join(project_dir, "web")
+    output = os.path.join(project_dir, "include", "WebAssets.h")
+    hashes = {}
+    blobs = []
+    for name, url, content_type, cache in ASSETS:
+        with open(os.path.join(web_dir, name), "rb") as f:
+            data = f.read()
+        for other, digest in hashes.items():
+            data = data.replace(("@%s_HASH@" % other.upper().replace(".", "_")).encode(), digest.encode())
+        packed = compress(data)
+        digest = hashlib.sha1(packed).hexdigest()[:12]
+        hashes[name] = digest
+        blobs.append((name, url, content_type, cache, packed, digest, len(data)))
+
+    lines = [
+        "// Generated by tools/embed_web.py from web/ - do not edit",
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "struct WebAsset {",
+        "  const char *url;",
+        "  const char *contentType;",
+        "  const char *cacheControl;",
+        "  const char *etag;        // Quoted, as sent in the ETag header",
+        "  const uint8_t *data;     // gzip-compressed",
+        "  size_t length;",
+        "};",
+        "",
+    ]
+    for name, url, content_type, cache, packed, digest, size in blobs:
+        lines.append("// %s: %d bytes, %d gzipped" % (name, size, len(packed)))
+        lines.append("static const uint8_t %s[] PROGMEM = {" % symbol(name))
+        for i in range(0, len(packed), 20):
+            lines.append("  " + ", ".join("0x%02x" % b for b in packed[i:i + 20]) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append("static const WebAsset webAssets[] = {")
+    for name, url, content_type, cache, packed, digest, size in blobs:
+        lines.append('  { "%s", "%s", "%s", "\\"%s\\"", %s, sizeof(%s) },' % (url, content_type, cache, digest, symbol(name), symbol(name)))
+    lines.append("};")
+    lines.append("")
+    text = "\n".join(lines)
+
+    if os.path.exists(output):
+        with open(output) as f:
+            if f.read() == text:
+                return  # Unchanged: keep the timestamp so nothing rebuilds
+    with open(output, "w") as f:
+        f.write(text)
+    print("embed_web: wrote %s" % os.path.relpath(output, project_dir))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    generate(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
@@ -0,0 +1,234 @@
+"""Spread a part count over the idle benders of a fleet through their MQTT broker.
+
+Every machine in fleet mode (see README, "Fleet mode") keeps a retained status on
+bender/<name>/status, takes jobs on bender/<name>/job and reports every part on
+bender/<name>/event. This script finds the machines, hands each idle one a batch of parts and
+hands out the next batch whenever a machine is done, so faster machines make more parts. Parts
+of a job that faults, is cancelled or whose machine drops off the broker go back into the pool;
+the machine only gets work again once it reports idle (a faulted machine stays in the fault
+state until someone runs a job on it by hand).
+
+    python3 tools/fleet_dispatch.py --parts 40 --program "S170,X-4250,S345"
+    python3 tools/fleet_dispatch.py --parts 40 --library hook --broker 192.168.1.10
+
+No packages needed: it speaks MQTT 3.1.1 (QoS 0) itself. Try it without machines against a
+local Mosquitto and a few simulators (.pio/build/native/program --fleet b1@localhost).
+"""
+
+import argparse
+import json
+import math
+import select
+import socket
+import struct
+import sys
+import time
+
+CONNECT, CONNACK, PUBLISH, SUBSCRIBE, SUBACK, PINGREQ, PINGRESP = 0x10, 0x20, 0x30, 0x82, 0x90, 0xC0, 0xD0
+KEEPALIVE_S = 30
+ROOT = "bender"
+
+
+class MqttClient:
+    """The little of MQTT the dispatcher needs: connect, subscribe, publish, receive."""
+
+    def __init__(self, host, port, client_id):
+        self.sock = socket.create_connection((host, port), timeout=5)
+        self.buffer = b""
+        body = self._string("MQTT") + bytes([4, 0x02]) + struct.pack(">H", KEEPALIVE_S) + self._string(client_id)
+        self._send(CONNECT, body)
+        packet = self._read_packet(5)
+        if packet is None or packet[0] != CONNACK or packet[1][1] != 0:
+            raise ConnectionError("broker refused the connection")
+        self.packet_id = 0
+
+    @staticmethod
+    def _string(text):
+        data = text.encode()
+        return struct.pack(">H", len(data)) + data
+
+    def _send(self, kind, body):
+        length = len(body)
+        header = bytearray([kind])
+        while True:
+            digit, length = length % 128, length // 128
+            header.append(digit | (0x80 if length else 0))
+            if not length:
+                break
+        self.sock.sendall(bytes(header) + body)
+        self.last_sent = time.monotonic()
+
+    def subscribe(self, topic):
+        self.packet_id += 1
+        self._send(SUBSCRIBE, struct.pack(">H", self.packet_id) + self._string(topic) + b"\x00")
+
+    def publish(self, topic, payload):
+        self._send(PUBLISH, self._string(topic) + payload.encode())
+
+    def _read_packet(self, timeout):
+        """Next complete packet as (type, body), or None when none arrives within 'timeout'."""
+        deadline = time.monotonic() + timeout
+        while True:
+            if len(self.buffer) >= 2:
+                length, shift, i = 0, 0, 1
+                while i < len(self.buffer) and i <= 4:
+                    digit = self.buffer[i]
+                    length |= (digit & 0x7F) << shift
+                    shift += 7
+                    i += 1
+                    if not digit & 0x80:
+                        if len(self.buffer) >= i + length:
+                            packet = (self.buffer[0], self.buffer[i:i + length])
+                            self.buffer = self.buffer[i + length:]
+                            return packet
+                        break
+            left = deadline - time.monotonic()
+            if left <= 0 or not select.select([self.sock], [], [], left)[0]:
+                return None
+            data = self.sock.recv(65536)
+            if not data:
+                raise ConnectionError("broker closed the connection")
+            self.buffer += data
+
+    def messages(self, timeout):
+        """Yield (topic, payload) of the messages received within 'timeout' seconds."""
+        deadline = time.monotonic() + timeout
+        while True:
+            if time.monotonic() - self.last_sent >= KEEPALIVE_S / 2:
+                self._send(PINGREQ, b"")
+            packet = self._read_packet(max(0.0, deadline - time.monotonic()))
+            if packet is None:
+                return
+            kind, body = packet
+            if kind & 0xF0 == PUBLISH:
+                topic_length = struct.unpack(">H", body[:2])[0]
+                start = 2 + topic_length + (2 if kind & 0x06 else 0)
+                yield body[2:2 + topic_length].decode(), body[start:].decode(errors="replace")
+
+
+class Machine:
+    def __init__(self, name):
+        self.name = name
+        self.state = "offline"
+        self.job = None       # Job id we handed it and that has not ended yet
+        self.parts = 0        # Parts in that job
+        self.done = 0         # ... of which are made
+        self.waiting = False  # Job sent, no answer yet
+        self.made = 0
+        self.cycle_ms = []
+        self.faults = 0
+        self.refused = False  # Rejected a job: left out for the rest of the run
+
+    def free(self):
+        return self.state == "idle" and self.job is None and not self.waiting and not self.refused
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Balance a part count over the idle machines of a bender fleet.")
+    parser.add_argument("--broker", default="localhost", help="MQTT broker, HOST or HOST:PORT (default localhost:1883)")
+    parser.add_argument("--parts", type=int, required=True, help="parts to make")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--program", help="program text, or @FILE to read it from a file")
+    source.add_argument("--library", help="name of a program every machine has in its library")
+    parser.add_argument("--batch", type=int, default=10, help="most parts per job (default 10)")
+    parser.add_argument("--machines", help="comma-separated machine names to use (default: all that report)")
+    parser.add_argument("--discover", type=float, default=2.0, help="seconds to wait for machines before starting")
+    parser.add_argument("--timeout", type=float, default=60.0, help="give up after this long with no machine working")
+    args = parser.parse_args()
+
+    host, _, port = args.broker.partition(":")
+    program = args.program
+    if program is not None and program.startswith("@"):
+        with open(program[1:]) as f:
+            program = f.read().strip()
+    allowed = set(args.machines.split(",")) if args.machines else None
+
+    client = MqttClient(host, int(port or 1883), "dispatch-%d" % int(time.time()))
+    client.subscribe(ROOT + "/+/status")
+    client.subscribe(ROOT + "/+/event")
+
+    machines = {}
+    pool = args.parts  # Parts nobody works on
+    made = 0
+    jobs = 0
+    run = "%x" % int(time.time())
+    started = time.monotonic()
+    last_activity = started
+
+    def handle(topic, payload):
+        nonlocal pool, made
+        parts = topic.split("/")
+        if len(parts) != 3 or (allowed and parts[1] not in allowed):
+            return
+        try:
+            message = json.loads(payload)
+        except ValueError:
+            return
+        machine = machines.setdefault(parts[1], Machine(parts[1]))
+        if parts[2] == "status":
+            machine.state = message.get("state", "offline")
+            if machine.state == "offline" and machine.job:
+                print("%s: went offline during %s, %d parts back in the pool" % (machine.name, machine.job, machine.parts - machine.done))
+                pool += machine.parts - machine.done
+                machine.job, machine.waiting = None, False
+            return
+        if message.get("job") != machine.job:
+            return  # Someone else's job
+        event = message.get("event")
+        if event == "accepted":
+            machine.waiting = False
+        elif event == "part":
+            machine.done = message["done"]
+            machine.made += 1
+            machine.cycle_ms.append(message["cycle_ms"])
+            made += 1
+            print("%s: part %d/%d of %s in %.2f s (%d/%d made)" % (machine.name, machine.done, machine.parts, machine.job,
+                                                                   message["cycle_ms"] / 1000, made, args.parts))
+        elif event in ("done", "fault", "cancelled", "rejected"):
+            if event != "done":
+                left = machine.parts - machine.done
+                pool += left
+                machine.faults += event == "fault"
+                machine.refused = event == "rejected"
+                print("%s: %s %s (%s), %d parts back in the pool" % (machine.name, machine.job, event, message.get("reason", ""), left))
+            machine.job, machine.waiting = None, False
+
+    for topic, payload in client.messages(args.discover):
+        handle(topic, payload)
+    if not machines:
+        print("No machines found on %s." % args.broker)
+        return 1
+    print("Machines: " + ", ".join("%s (%s)" % (m.name, m.state) for m in machines.values()))
+
+    while made < args.parts:
+        online = [m for m in machines.values() if m.state != "offline"]
+        for machine in sorted(machines.values(), key=lambda m: m.name):
+            if pool == 0 or not machine.free():
+                continue
+            # Even shares of what is left, so the last parts do not all wait for one machine
+            count = min(pool, args.batch, max(1, math.ceil(pool / max(1, len(online)))))
+            jobs += 1
+            machine.job = "%s-%d" % (run, jobs)
+            machine.parts, machine.done, machine.waiting = count, 0, True
+            pool -= count
+            header = "%s %d" % (machine.job, count)
+            client.publish("%s/%s/job" % (ROOT, machine.name), header + " " + args.library if args.library else header + "\n" + program)
+            print("%s: %s, %d parts" % (machine.name, machine.job, count))
+        if any(m.job for m in machines.values()):
+            last_activity = time.monotonic()
+        elif time.monotonic() - last_activity > args.timeout:
+            print("No machine took work for %.0f s, %d of %d parts made." % (args.timeout, made, args.parts))
+            break
+        for topic, payload in client.messages(0.5):
+            handle(topic, payload)
+
+    elapsed = time.monotonic() - started
+    for machine in sorted(machines.values(), key=lambda m: m.name):
+        mean = sum(machine.cycle_ms) / len(machine.cycle_ms) / 1000 if machine.cycle_ms else 0
+        print("%-12s %4d parts, mean cycle %.2f s, %d faults" % (machine.name, machine.made, mean, machine.faults))
+    print("%d of %d parts in %.1f s" % (made, args.parts, elapsed))
+    return 0 if made >= args.parts else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
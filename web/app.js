@@ -0,0 +1,279 @@
+function sendCommandBuffer() {
+  const commandBuffer = document.getElementById('commandBuffer').value.trim();
+  if (!commandBuffer) {
+    document.getElementById('response').innerText = 'Error: Command buffer cannot be empty.';
+    return;
+  }
+  updateBackgroundColor('red'); // Indicate program is running
+  fetch(`/commandBuffer?buffer=${encodeURIComponent(commandBuffer)}`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error sending command buffer';
+      updateBackgroundColor('red'); // Indicate error
+    });
+}
+
+function setSpeed(axis) {
+  const value = document.getElementById(`${axis}Speed`).value.trim();
+  if (!value || isNaN(value)) {
+    document.getElementById('response').innerText = `Error: Enter a valid speed for ${axis}-axis.`;
+    return;
+  }
+  const command = axis === 'X' ? `F${value}` : `G${value}`;
+  fetch(`/command?cmd=${command}`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = `Error setting speed for ${axis}-axis.`;
+    });
+}
+
+function setLimit(inputId, letter, label) {
+  const value = document.getElementById(inputId).value.trim();
+  if (!value || isNaN(value) || Number(value) < 0) {
+    document.getElementById('response').innerText = `Error: Enter a valid ${label}.`;
+    return;
+  }
+  fetch(`/command?cmd=${letter}${value}`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = `Error setting ${label}.`;
+    });
+}
+
+function saveValues() {
+  fetch(`/saveValues`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error saving values.';
+    });
+}
+
+function loadValues() {
+  fetch(`/loadValues`)
+    .then(response => response.text().then(data => ({ ok: response.ok, data })))
+    .then(({ ok, data }) => {
+      if (!ok) {
+        document.getElementById('response').innerText = data; // Busy: the machine must be idle
+        return;
+      }
+      const values = JSON.parse(data);
+      document.getElementById('XSpeed').value = values.XSpeed;
+      document.getElementById('ZSpeed').value = values.ZSpeed;
+      document.getElementById('XAccel').value = values.XAccel;
+      document.getElementById('ZAccel').value = values.ZAccel;
+      document.getElementById('XJerk').value = values.XJerk;
+      document.getElementById('ZJerk').value = values.ZJerk;
+      document.getElementById('ServoSpeed').value = values.ServoSpeed;
+      document.getElementById('Optimize').checked = values.Optimize;
+      document.getElementById('commandBuffer').value = values.Buffer;
+      document.getElementById('response').innerText = 'Values loaded successfully.';
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error loading values.';
+    });
+}
+
+function setOptimize() {
+  const value = document.getElementById('Optimize').checked ? 1 : 0;
+  fetch(`/setOptimize?value=${value}`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error setting the program optimizer.';
+    });
+}
+
+function setFeedOverride() {
+  const value = document.getElementById('FeedOverride').value;
+  fetch(`/feedOverride?value=${value}`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error setting the feed override.';
+    });
+}
+
+// Stop, pause or resume the running job; handled at once, not behind the queued commands
+function machineControl(action) {
+  fetch(`/${action}`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = `Error sending ${action}.`;
+    });
+}
+
+// Start tuning an axis on the command buffer, or with no axis show how the last run went
+function tune(axis) {
+  fetch(axis ? `/tune?axis=${axis}` : '/tune')
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error starting the tuning.';
+    });
+}
+
+function deleteConfig() {
+  fetch(`/deleteConfig`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error deleting config file.';
+    });
+}
+
+// Program library: names come from the list or the name box, and the list is refreshed after
+// every change.
+function programName() {
+  const name = document.getElementById('programName').value.trim();
+  if (!name) {
+    document.getElementById('response').innerText = 'Error: Enter or pick a program name.';
+  }
+  return name;
+}
+
+function libraryRequest(path, refresh) {
+  return fetch(path)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+      if (refresh) {
+        listPrograms();
+      }
+      return data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error talking to the program library.';
+    });
+}
+
+function listPrograms() {
+  fetch(`/programs`)
+    .then(response => response.text())
+    .then(data => {
+      const list = document.getElementById('programList');
+      list.innerHTML = '<option value="">Saved programs</option>';
+      data.split('\n').filter(line => line).forEach(line => {
+        const [name, commands] = line.split(' ');
+        list.add(new Option(`${name} (${commands} commands)`, name));
+      });
+    });
+}
+
+function pickProgram() {
+  document.getElementById('programName').value = document.getElementById('programList').value;
+}
+
+function saveProgram() {
+  const name = programName();
+  const commandBuffer = document.getElementById('commandBuffer').value.trim();
+  if (name) {
+    libraryRequest(`/saveProgram?name=${encodeURIComponent(name)}&buffer=${encodeURIComponent(commandBuffer)}`, true);
+  }
+}
+
+function loadProgram() {
+  const name = programName();
+  if (name) {
+    fetch(`/loadProgram?name=${encodeURIComponent(name)}`)
+      .then(response => response.text().then(data => {
+        if (response.ok) {
+          document.getElementById('commandBuffer').value = data;
+          data = `Program '${name}' loaded.`;
+        }
+        document.getElementById('response').innerText = data;
+      }));
+  }
+}
+
+function runProgram() {
+  const name = programName();
+  if (name) {
+    libraryRequest(`/runProgram?name=${encodeURIComponent(name)}`, false);
+  }
+}
+
+function deleteProgram() {
+  const name = programName();
+  if (name && confirm(`Delete program '${name}'?`)) {
+    libraryRequest(`/deleteProgram?name=${encodeURIComponent(name)}`, true);
+  }
+}
+
+function updateBackgroundColor(color) {
+  document.body.style.backgroundColor = color;
+}
+
+function loadWire() {
+  fetch(`/loadWire`)
+    .then(response => response.text())
+    .then(data => {
+      document.getElementById('response').innerText = data;
+    })
+    .catch(err => {
+      document.getElementById('response').innerText = 'Error executing LOAD WIRE command.';
+    });
+}
+
+function navigateToHelp() {
+  window.location.href = '/help';
+}
+
+// The version is not baked into the cached page; ask the firmware for it
+function showVersion() {
+  fetch(`/version`)
+    .then(response => response.text())
+    .then(version => {
+      document.title = `ESP32-S2 Control ${version}`;
+      document.getElementById('title').innerText = `WIRE BENDER - ${version}`;
+    });
+}
+
+// Live status from /events. The send button stays disabled while a job runs, so a program is
+// not queued twice while the operator waits for it.
+function watchStatus() {
+  const events = new EventSource('/events');
+  events.addEventListener('status', event => {
+    const status = JSON.parse(event.data);
+    const running = status.state === 'running' || status.state === 'paused';
+    const texts = {
+      idle: 'Idle',
+      running: `Running command ${status.cmd}, ${status.queue} queued`,
+      fault: `Stopped at command ${status.cmd}`,
+      paused: `Paused at command ${status.cmd}, ${status.queue} queued`,
+    };
+    document.getElementById('status').innerText =
+      `${texts[status.state]} - X ${status.x}, Z ${status.z}, servo ${status.servo}, feed ${status.feed}% (${status.rate} steps/s), ${status.current} mA`;
+    document.getElementById('sendBuffer').disabled = running;
+    updateBackgroundColor(running ? 'red' : status.state === 'fault' ? 'orange' : status.state === 'paused' ? 'yellow' : '');
+  });
+  events.onerror = () => {
+    document.getElementById('status').innerText = 'No connection to the machine';
+  };
+}
+
+showVersion();
+watchStatus();
+listPrograms();